@@ -0,0 +1,103 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+/* A minimal harness for the microbenchmarks: each benchmark is a
+ * function that is called repeatedly, and whose results are
+ * printed in a fixed, whitespace separated format. */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+
+
+namespace vka2::bench {
+
+	using bench_clock = std::chrono::steady_clock;
+
+	struct Result {
+		size_t iterations;
+		double nsPerIteration; // The median of all samples
+	};
+
+
+	/** Prevents the compiler from optimizing away the computation
+	 * of the given value. */
+	template<typename T>
+	inline void doNotOptimize(T& value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+
+	/** Calls `fn` once to warm up, then repeatedly in batches until at least
+	 * `minTime` has passed; the batch size is grown until a single batch
+	 * lasts long enough to be measured reliably. */
+	template<typename Fn>
+	Result measure(Fn&& fn, std::chrono::milliseconds minTime = std::chrono::milliseconds(250)) {
+		using namespace std::chrono;
+		constexpr auto minBatchTime = microseconds(500);
+		std::vector<double> samples;
+		size_t batch = 1;
+		size_t iterations = 0;
+		fn();
+		auto beg = bench_clock::now();
+		while(bench_clock::now() - beg < minTime) {
+			auto batchBeg = bench_clock::now();
+			for(size_t i=0; i < batch; ++i) fn();
+			auto batchTime = bench_clock::now() - batchBeg;
+			iterations += batch;
+			if(batchTime < minBatchTime) {
+				batch *= 2;
+			} else {
+				samples.push_back(double(duration_cast<nanoseconds>(batchTime).count()) / batch);
+			}
+		}
+		if(samples.empty()) {
+			samples.push_back(double(duration_cast<nanoseconds>(bench_clock::now() - beg).count()) / iterations); }
+		auto median = samples.begin() + (samples.size() / 2);
+		std::nth_element(samples.begin(), median, samples.end());
+		return Result { .iterations = iterations, .nsPerIteration = *median };
+	}
+
+
+	/** Prints a result to the standard output, as
+	 * `<name> <iterations> <ns/iteration> <items/s> <item name>/s`. */
+	void report(const std::string& name, const Result&, double itemsPerIteration, const char* itemName);
+
+	/** Prints a measured quantity that isn't a time, in the same
+	 * columns as `report`: `<name> - - <value> <unit>`. */
+	void reportCount(const std::string& name, size_t value, const char* unit);
+
+
+	void runTransformBenchmarks();
+	void runInstanceBenchmarks();
+	void runMeshBenchmarks();
+	void runDescriptorPoolBenchmarks();
+	void runSceneBenchmarks();
+	void runUtilBenchmarks();
+
+}
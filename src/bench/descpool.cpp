@@ -0,0 +1,91 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "bench/bench.hpp"
+
+#include "vkapp2/dyndescriptorpool.hpp"
+
+#include <random>
+
+
+
+namespace {
+
+	/** Stands in for a descriptor pool: handles are never dereferenced,
+	 * so the pool only has to keep track of how many sets it has. */
+	vka2::DynDescriptorPool mk_stub_pool() {
+		auto constructor = [](size_t) {
+			static uint64_t lastPool = 0;
+			return vk::DescriptorPool(reinterpret_cast<VkDescriptorPool>(++ lastPool));
+		};
+		auto destructor = [](vk::DescriptorPool) { };
+		auto allocator = [](vk::DescriptorPool, size_t sets) {
+			std::vector<vk::DescriptorSet> r;
+			r.reserve(sets);
+			for(size_t i=0; i < sets; ++i) {
+				r.push_back(vk::DescriptorSet(reinterpret_cast<VkDescriptorSet>(i + 1))); }
+			return r;
+		};
+		return vka2::DynDescriptorPool(nullptr, constructor, destructor, allocator);
+	}
+
+}
+
+
+
+namespace vka2::bench {
+
+	void runDescriptorPoolBenchmarks() {
+		constexpr size_t counts[] = { 64, 4096 };
+		for(size_t count : counts) {
+			std::string suffix = "/" + std::to_string(count);
+			{ // Grow a new pool up to `count` sets, then release them
+				std::vector<DynDescriptorPool::SetHandle> handles;
+				handles.reserve(count);
+				report("descpool.grow" + suffix, measure([&]() {
+					auto pool = mk_stub_pool();
+					for(size_t i=0; i < count; ++i) handles.push_back(pool.request());
+					for(auto& handle : handles) pool.release(handle);
+					handles.clear();
+				}), count, "sets");
+			} { // Release and request random sets of a pool that is already large enough
+				auto pool = mk_stub_pool();
+				std::vector<DynDescriptorPool::SetHandle> handles;
+				for(size_t i=0; i < count; ++i) handles.push_back(pool.request());
+				std::minstd_rand rng = std::minstd_rand(count);
+				std::uniform_int_distribution<size_t> idx(0, count - 1);
+				report("descpool.churn" + suffix, measure([&]() {
+					for(size_t i=0; i < count; ++i) {
+						auto& handle = handles[idx(rng)];
+						pool.release(handle);
+						handle = pool.request();
+					}
+				}), count, "sets");
+				for(auto& handle : handles) pool.release(handle);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,85 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "bench/bench.hpp"
+
+#include "vkapp2/transforms.hpp"
+
+#include <random>
+
+
+
+namespace vka2::bench {
+
+	void runInstanceBenchmarks() {
+		constexpr size_t count = 100'000;
+		constexpr size_t maxGap = 16;
+		TransformStore transforms;
+		std::vector<Instance> instances;
+		{ // Generate deterministic random transformations
+			std::minstd_rand rng = std::minstd_rand(count);
+			std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+			transforms.reserve(count);
+			for(size_t i=0; i < count; ++i) {
+				transforms.push_back(
+					glm::vec3(pos(rng), pos(rng), pos(rng)),
+					glm::vec3(0.0f), glm::vec3(1.0f) );
+			}
+			instances.resize(count);
+		}
+		auto fill = [](size_t i, Instance& inst) {
+			inst.colorMul = glm::vec4(1.0f);
+			inst.rnd = float(i);
+		};
+
+		/* Each pattern is a list of dirty indices, which is copied for every
+		 * iteration since assembling the instances consumes it. */
+		std::vector<size_t> all, sparse, clustered;
+		{
+			all.reserve(count);
+			for(size_t i=0; i < count; ++i) all.push_back(i);
+			std::minstd_rand rng = std::minstd_rand(1);
+			std::uniform_int_distribution<size_t> idx(0, count - 1);
+			for(size_t i=0; i < count / 100; ++i) sparse.push_back(idx(rng));
+			for(size_t i=0; i < 10; ++i) {
+				size_t beg = idx(rng) % (count - 100);
+				for(size_t j=0; j < 100; ++j) clustered.push_back(beg + j);
+			}
+		}
+		auto run = [&](const char* name, const std::vector<size_t>& pattern) {
+			std::vector<size_t> dirty;
+			dirty.reserve(pattern.size());
+			report(std::string("instances.assemble.") + name + "/" + std::to_string(count), measure([&]() {
+				dirty.assign(pattern.begin(), pattern.end());
+				auto ranges = assembleInstances(transforms, dirty, maxGap, instances.data(), fill);
+				doNotOptimize(ranges);
+			}), pattern.size(), "instances");
+		};
+		run("all", all);
+		run("sparse", sparse);
+		run("clustered", clustered);
+	}
+
+}
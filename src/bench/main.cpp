@@ -0,0 +1,58 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+#include "bench/bench.hpp"
+
+#include <cstdio>
+
+
+
+namespace vka2::bench {
+
+	void report(const std::string& name, const Result& r, double itemsPerIteration, const char* itemName) {
+		double itemsPerSecond = itemsPerIteration * 1.0e9 / r.nsPerIteration;
+		std::printf("%-40s %12zu %16.1f %16.0f %s/s\n",
+			name.c_str(), r.iterations, r.nsPerIteration, itemsPerSecond, itemName);
+	}
+
+	void reportCount(const std::string& name, size_t value, const char* unit) {
+		std::printf("%-40s %12s %16s %16zu %s\n",
+			name.c_str(), "-", "-", value, unit);
+	}
+
+}
+
+
+
+int main() {
+	using namespace vka2::bench;
+	std::printf("%-40s %12s %16s %16s\n", "benchmark", "iterations", "ns/iteration", "throughput");
+	runTransformBenchmarks();
+	runInstanceBenchmarks();
+	runMeshBenchmarks();
+	runDescriptorPoolBenchmarks();
+	runSceneBenchmarks();
+	runUtilBenchmarks();
+	return 0;
+}
@@ -0,0 +1,126 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "bench/bench.hpp"
+
+#include "vkapp2/graphics.hpp"
+
+#include <cmath>
+#include <sstream>
+
+
+
+namespace {
+
+	/** An OBJ model of a UV sphere, with `rings` horizontal and
+	 * `segments` vertical slices; vertices on the seam and at the
+	 * poles are shared by several positions in the file. */
+	std::string mk_sphere_obj(unsigned rings, unsigned segments) {
+		constexpr float pi = 3.14159265358979f;
+		std::ostringstream r;
+		for(unsigned ring = 0; ring <= rings; ++ring) {
+			float theta = pi * float(ring) / float(rings);
+			for(unsigned seg = 0; seg <= segments; ++seg) {
+				float phi = 2.0f * pi * float(seg) / float(segments);
+				float x = std::sin(theta) * std::cos(phi);
+				float y = std::cos(theta);
+				float z = std::sin(theta) * std::sin(phi);
+				r << "v " << x << ' ' << y << ' ' << z << '\n';
+				r << "vn " << x << ' ' << y << ' ' << z << '\n';
+				r << "vt " << (float(seg) / float(segments)) << ' ' << (float(ring) / float(rings)) << '\n';
+			}
+		}
+		auto vtx = [&](unsigned ring, unsigned seg) { return (ring * (segments + 1)) + seg + 1; };
+		auto face = [&](unsigned a, unsigned b, unsigned c) {
+			r << "f " << a << '/' << a << '/' << a << ' ' << b << '/' << b << '/' << b << ' ' << c << '/' << c << '/' << c << '\n';
+		};
+		for(unsigned ring = 0; ring < rings; ++ring) {
+			for(unsigned seg = 0; seg < segments; ++seg) {
+				// Triangles that would touch a pole with two vertices are degenerate
+				if(ring+1 < rings)  face(vtx(ring, seg), vtx(ring+1, seg), vtx(ring+1, seg+1));
+				if(ring > 0)        face(vtx(ring, seg), vtx(ring+1, seg+1), vtx(ring, seg+1));
+			}
+		}
+		return r.str();
+	}
+
+
+	/** An OBJ model of a flat `size`x`size` grid of unit quads, at integer
+	 * coordinates: the worst case for a hash that XORs the coordinates,
+	 * since (x, y) and (y, x) always collide. */
+	std::string mk_grid_obj(unsigned size) {
+		std::ostringstream r;
+		for(unsigned y = 0; y <= size; ++y) {
+			for(unsigned x = 0; x <= size; ++x) {
+				r << "v " << x << ' ' << y << " 0\n";
+				r << "vt " << (float(x) / float(size)) << ' ' << (float(y) / float(size)) << '\n';
+			}
+		}
+		r << "vn 0 0 1\n";
+		auto vtx = [&](unsigned y, unsigned x) { return (y * (size + 1)) + x + 1; };
+		auto face = [&](unsigned a, unsigned b, unsigned c) {
+			r << "f " << a << '/' << a << "/1 " << b << '/' << b << "/1 " << c << '/' << c << "/1\n";
+		};
+		for(unsigned y = 0; y < size; ++y) {
+			for(unsigned x = 0; x < size; ++x) {
+				face(vtx(y, x), vtx(y, x+1), vtx(y+1, x+1));
+				face(vtx(y, x), vtx(y+1, x+1), vtx(y+1, x));
+			}
+		}
+		return r.str();
+	}
+
+
+	void run_obj_benchmark(const std::string& name, const std::string& objData) {
+		using namespace vka2;
+		using namespace vka2::bench;
+		MeshInstance::AssemblyStats stats;
+		{ // Report how well VertexHash spreads the positions of the model
+			Vertices vtx;  Indices idx;
+			MeshInstance::assembleObj(objData, true, vtx, idx, &stats);
+			reportCount(name + ".positions", stats.uniquePositions, "positions");
+			reportCount(name + ".hashes", stats.uniqueHashes, "hashes");
+		}
+		for(bool merge : { false, true }) {
+			report(name + (merge? ".assemble.merged" : ".assemble"), measure([&]() {
+				Vertices vtx;  Indices idx;
+				MeshInstance::assembleObj(objData, merge, vtx, idx);
+				doNotOptimize(vtx.back());
+			}), stats.vertices, "vertices");
+		}
+	}
+
+}
+
+
+
+namespace vka2::bench {
+
+	void runMeshBenchmarks() {
+		run_obj_benchmark("mesh.sphere/64x128", mk_sphere_obj(64, 128));
+		run_obj_benchmark("mesh.grid/256", mk_grid_obj(256));
+	}
+
+}
@@ -0,0 +1,88 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "bench/bench.hpp"
+
+#include "vkapp2/settings/scene.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+
+
+namespace {
+
+	/** Writes a scene file with `objects` objects, spread among a
+	 * handful of materials; returns its path. */
+	std::string mk_scene_cfg(size_t objects) {
+		constexpr size_t materials = 8;
+		auto path = std::filesystem::temp_directory_path() / ("vkapp2-bench-scene-" + std::to_string(objects) + ".cfg");
+		std::ofstream out = std::ofstream(path, std::ios::trunc);
+		std::minstd_rand rng = std::minstd_rand(objects);
+		std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+		// libconfig doesn't convert integers to floats, so every float needs a decimal point
+		auto flt = [&](float f) { return std::to_string(f); };
+		out << "pointLight = [ 0.0, 10.0, 0.0, 1.0 ];\n";
+		out << "materials = (\n";
+		for(size_t i=0; i < materials; ++i) {
+			out << ((i == 0)? "  " : ", ")
+				<< "{ name = \"mtl" << i << "\"; ambient = 0.1; diffuse = 0.6; specular = 0.3;"
+				<< " shininess = 16.0; celLevels = 6; mergeVertices = " << ((i % 2 == 0)? "true" : "false") << "; }\n";
+		}
+		out << ");\nobjects = (\n";
+		for(size_t i=0; i < objects; ++i) {
+			out << ((i == 0)? "  " : ", ")
+				<< "{ meshName = \"mesh" << (i % materials) << "\"; materialName = \"mtl" << (i % materials) << "\";"
+				<< " position = [ " << flt(pos(rng)) << ", " << flt(pos(rng)) << ", " << flt(pos(rng)) << " ];"
+				<< " orientation = [ 0.0, 90.0, 0.0 ]; scale = [ 1.0, 1.0, 1.0 ];"
+				<< " color = [ 1.0, 0.5, 0.25, 1.0 ]; }\n";
+		}
+		out << ");\n";
+		if(! out) {
+			throw std::runtime_error("failed to write the scene \"" + path.string() + "\""); }
+		return path.string();
+	}
+
+}
+
+
+
+namespace vka2::bench {
+
+	void runSceneBenchmarks() {
+		constexpr size_t counts[] = { 100, 10'000 };
+		for(size_t count : counts) {
+			std::string path = mk_scene_cfg(count);
+			report("scene.fromCfg/" + std::to_string(count), measure([&]() {
+				auto scene = Scene::fromCfg(path);
+				doNotOptimize(scene.objects.back());
+			}), count, "objects");
+			std::filesystem::remove(path);
+		}
+	}
+
+}
@@ -0,0 +1,66 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+#include "bench/bench.hpp"
+
+#include "vkapp2/transforms.hpp"
+
+#include <random>
+
+
+
+namespace vka2::bench {
+
+	void runTransformBenchmarks() {
+		constexpr size_t counts[] = { 10'000, 100'000, 1'000'000 };
+		for(size_t count : counts) {
+			TransformStore transforms;
+			std::vector<Instance> instances;
+			{ // Generate deterministic random transformations
+				std::minstd_rand rng = std::minstd_rand(count);
+				std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+				std::uniform_real_distribution<float> rot(-180.0f, 180.0f);
+				std::uniform_real_distribution<float> scl(0.5f, 2.0f);
+				transforms.reserve(count);
+				for(size_t i=0; i < count; ++i) {
+					transforms.push_back(
+						glm::vec3(pos(rng), pos(rng), pos(rng)),
+						glm::vec3(rot(rng), rot(rng), rot(rng)),
+						glm::vec3(scl(rng), scl(rng), scl(rng)) );
+				}
+				instances.resize(count);
+			}
+			std::string suffix = "/" + std::to_string(count);
+			report("transforms.composeMatricesSt" + suffix, measure([&]() {
+				transforms.composeMatricesSt(0, count, instances.data());
+				doNotOptimize(instances.back());
+			}), count, "matrices");
+			report("transforms.composeMatrices" + suffix, measure([&]() {
+				transforms.composeMatrices(0, count, instances.data());
+				doNotOptimize(instances.back());
+			}), count, "matrices");
+		}
+	}
+
+}
@@ -0,0 +1,73 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "bench/bench.hpp"
+
+#include "util/perftracker.hpp"
+#include "util/perfcollector.hpp"
+#include "util/util.hpp"
+
+#include <sstream>
+
+
+
+namespace vka2::bench {
+
+	void runUtilBenchmarks() {
+		{ // PerfTracker timers, started with a string or with an interned ID
+			util::PerfTracker tracker;
+			const char* ids[] = { "bench.a", "bench.b", "bench.c", "bench.d", "bench.e", "bench.f", "bench.g", "bench.h" };
+			for(const char* id : ids) tracker.record(id, 0); // Records found near the end are the slow path's worst case
+			report("perf.timer.string", measure([&]() {
+				auto timer = tracker.startTimer("bench.h");
+				auto ns = tracker.stopTimer(timer);
+				doNotOptimize(ns);
+			}), 1, "timers");
+			report("perf.timer.id", measure([&]() {
+				auto timer = tracker.startTimer(PERF_ID("bench.h"));
+				auto ns = tracker.stopTimer(timer);
+				doNotOptimize(ns);
+			}), 1, "timers");
+			report("perf.scope", measure([&]() {
+				PERF_SCOPE("bench.scope")
+				PERF_SCOPE("bench.nested")
+			}), 2, "timers");
+			perf::collector().reset();
+		} { // Log formatting, with an enabled and a disabled level
+			std::ostringstream out;
+			util::Log log = util::Log(out);
+			log.setLevel(util::LOG_DEBUG, true);
+			log.setLevel(util::LOG_ALLOC, false);
+			report("log.enabled", measure([&]() {
+				log(util::LOG_DEBUG) << "frame " << 1234u << " took " << 16.67f << "ms" << util::endl;
+				if(out.tellp() > (1 << 20)) out.str({ });
+			}), 1, "lines");
+			report("log.disabled", measure([&]() {
+				log(util::LOG_ALLOC) << "frame " << 1234u << " took " << 16.67f << "ms" << util::endl;
+			}), 1, "lines");
+		}
+	}
+
+}
@@ -10,8 +10,9 @@ unset _dirname
 
 export VKA2_SHADER_PATH=./shaders
 export VKA2_ASSET_PATH=./assets
+export VKA2_NULL_DEVICE_ICD=./nulldev/vkapp2_nulldev.json
 
 unset pre_command
 [ "$1" = '-d' ] && pre_command='valgrind' && shift
 [ "$1" = '-l' ] && pre_command='valgrind --leak-check=full --show-leak-kinds=all' && shift
-exec $pre_command vkapp2/vkapp2
+exec $pre_command vkapp2/vkapp2 "$@"
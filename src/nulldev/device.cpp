@@ -0,0 +1,573 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "nulldev/nulldev.hpp"
+
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+
+
+using namespace nulldev;
+
+
+
+namespace {
+
+	constexpr uint32_t API_VERSION = VK_API_VERSION_1_2;
+	constexpr uint32_t LOADER_INTERFACE_VERSION = 5;
+	constexpr const char* DEVICE_NAME = "vkapp2 null device";
+
+
+	ns_t env_ns(const char* name) {
+		const char* value = std::getenv(name);
+		if(value == nullptr)  return 0;
+		return std::strtoull(value, nullptr, 10);
+	}
+
+
+	/** Succeeds with the given count if `dst` is null, and otherwise
+	 * copies as many elements as fit, as every enumeration does. */
+	template<typename T>
+	VkResult enumerate(const T* src, uint32_t srcCount, uint32_t* pCount, T* dst) {
+		if(dst == nullptr) {
+			*pCount = srcCount;
+			return VK_SUCCESS;
+		}
+		uint32_t count = std::min(*pCount, srcCount);
+		std::copy(src, src + count, dst);
+		*pCount = count;
+		return (count < srcCount)? VK_INCOMPLETE : VK_SUCCESS;
+	}
+
+
+	VkPhysicalDeviceLimits mk_limits() {
+		VkPhysicalDeviceLimits r = { };
+		r.maxImageDimension1D = 16384;
+		r.maxImageDimension2D = 16384;
+		r.maxImageDimension3D = 2048;
+		r.maxImageDimensionCube = 16384;
+		r.maxImageArrayLayers = 2048;
+		r.maxTexelBufferElements = 1 << 27;
+		r.maxUniformBufferRange = 1 << 16;
+		r.maxStorageBufferRange = 1u << 31;
+		r.maxPushConstantsSize = 256;
+		r.maxMemoryAllocationCount = 4096;
+		r.maxSamplerAllocationCount = 4000;
+		r.bufferImageGranularity = 1;
+		r.sparseAddressSpaceSize = 0;
+		r.maxBoundDescriptorSets = 8;
+		r.maxPerStageDescriptorSamplers = 1 << 20;
+		r.maxPerStageDescriptorUniformBuffers = 1 << 20;
+		r.maxPerStageDescriptorStorageBuffers = 1 << 20;
+		r.maxPerStageDescriptorSampledImages = 1 << 20;
+		r.maxPerStageDescriptorStorageImages = 1 << 20;
+		r.maxPerStageDescriptorInputAttachments = 1 << 20;
+		r.maxPerStageResources = 1 << 20;
+		r.maxDescriptorSetSamplers = 1 << 20;
+		r.maxDescriptorSetUniformBuffers = 1 << 20;
+		r.maxDescriptorSetUniformBuffersDynamic = 16;
+		r.maxDescriptorSetStorageBuffers = 1 << 20;
+		r.maxDescriptorSetStorageBuffersDynamic = 16;
+		r.maxDescriptorSetSampledImages = 1 << 20;
+		r.maxDescriptorSetStorageImages = 1 << 20;
+		r.maxDescriptorSetInputAttachments = 1 << 20;
+		r.maxVertexInputAttributes = 32;
+		r.maxVertexInputBindings = 32;
+		r.maxVertexInputAttributeOffset = 2047;
+		r.maxVertexInputBindingStride = 2048;
+		r.maxVertexOutputComponents = 128;
+		r.maxTessellationGenerationLevel = 64;
+		r.maxTessellationPatchSize = 32;
+		r.maxTessellationControlPerVertexInputComponents = 128;
+		r.maxTessellationControlPerVertexOutputComponents = 128;
+		r.maxTessellationControlPerPatchOutputComponents = 120;
+		r.maxTessellationControlTotalOutputComponents = 4096;
+		r.maxTessellationEvaluationInputComponents = 128;
+		r.maxTessellationEvaluationOutputComponents = 128;
+		r.maxGeometryShaderInvocations = 32;
+		r.maxGeometryInputComponents = 128;
+		r.maxGeometryOutputComponents = 128;
+		r.maxGeometryOutputVertices = 256;
+		r.maxGeometryTotalOutputComponents = 1024;
+		r.maxFragmentInputComponents = 128;
+		r.maxFragmentOutputAttachments = 8;
+		r.maxFragmentDualSrcAttachments = 1;
+		r.maxFragmentCombinedOutputResources = 1 << 20;
+		r.maxComputeSharedMemorySize = 1 << 15;
+		r.maxComputeWorkGroupCount[0] = r.maxComputeWorkGroupCount[1] = r.maxComputeWorkGroupCount[2] = 65535;
+		r.maxComputeWorkGroupInvocations = 1024;
+		r.maxComputeWorkGroupSize[0] = r.maxComputeWorkGroupSize[1] = 1024;
+		r.maxComputeWorkGroupSize[2] = 64;
+		r.subPixelPrecisionBits = 8;
+		r.subTexelPrecisionBits = 8;
+		r.mipmapPrecisionBits = 8;
+		r.maxDrawIndexedIndexValue = UINT32_MAX;
+		r.maxDrawIndirectCount = UINT32_MAX;
+		r.maxSamplerLodBias = 16.0f;
+		r.maxSamplerAnisotropy = 16.0f;
+		r.maxViewports = 16;
+		r.maxViewportDimensions[0] = r.maxViewportDimensions[1] = 16384;
+		r.viewportBoundsRange[0] = -32768.0f;
+		r.viewportBoundsRange[1] = 32767.0f;
+		r.viewportSubPixelBits = 8;
+		r.minMemoryMapAlignment = 64;
+		r.minTexelBufferOffsetAlignment = 16;
+		r.minUniformBufferOffsetAlignment = 256;
+		r.minStorageBufferOffsetAlignment = 256;
+		r.minTexelOffset = -8;
+		r.maxTexelOffset = 7;
+		r.minTexelGatherOffset = -32;
+		r.maxTexelGatherOffset = 31;
+		r.minInterpolationOffset = -0.5f;
+		r.maxInterpolationOffset = 0.4375f;
+		r.subPixelInterpolationOffsetBits = 4;
+		r.maxFramebufferWidth = 16384;
+		r.maxFramebufferHeight = 16384;
+		r.maxFramebufferLayers = 2048;
+		r.framebufferColorSampleCounts = VK_SAMPLE_COUNT_1_BIT | VK_SAMPLE_COUNT_2_BIT | VK_SAMPLE_COUNT_4_BIT | VK_SAMPLE_COUNT_8_BIT;
+		r.framebufferDepthSampleCounts = r.framebufferColorSampleCounts;
+		r.framebufferStencilSampleCounts = r.framebufferColorSampleCounts;
+		r.framebufferNoAttachmentsSampleCounts = r.framebufferColorSampleCounts;
+		r.maxColorAttachments = 8;
+		r.sampledImageColorSampleCounts = r.framebufferColorSampleCounts;
+		r.sampledImageIntegerSampleCounts = r.framebufferColorSampleCounts;
+		r.sampledImageDepthSampleCounts = r.framebufferColorSampleCounts;
+		r.sampledImageStencilSampleCounts = r.framebufferColorSampleCounts;
+		r.storageImageSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+		r.maxSampleMaskWords = 1;
+		r.timestampComputeAndGraphics = VK_TRUE;
+		r.timestampPeriod = 1.0f; // Timestamps are simulated in nanoseconds
+		r.maxClipDistances = 8;
+		r.maxCullDistances = 8;
+		r.maxCombinedClipAndCullDistances = 8;
+		r.discreteQueuePriorities = 2;
+		r.pointSizeRange[0] = 1.0f;
+		r.pointSizeRange[1] = 256.0f;
+		r.lineWidthRange[0] = 1.0f;
+		r.lineWidthRange[1] = 16.0f;
+		r.pointSizeGranularity = 0.125f;
+		r.lineWidthGranularity = 0.125f;
+		r.strictLines = VK_FALSE;
+		r.standardSampleLocations = VK_TRUE;
+		r.optimalBufferCopyOffsetAlignment = 16;
+		r.optimalBufferCopyRowPitchAlignment = 16;
+		r.nonCoherentAtomSize = 64;
+		return r;
+	}
+
+
+	VkPhysicalDeviceFeatures mk_features() {
+		VkPhysicalDeviceFeatures r = { };
+		r.robustBufferAccess = VK_TRUE;
+		r.fullDrawIndexUint32 = VK_TRUE;
+		r.imageCubeArray = VK_TRUE;
+		r.independentBlend = VK_TRUE;
+		r.geometryShader = VK_TRUE;
+		r.tessellationShader = VK_TRUE;
+		r.sampleRateShading = VK_TRUE;
+		r.dualSrcBlend = VK_TRUE;
+		r.logicOp = VK_TRUE;
+		r.multiDrawIndirect = VK_TRUE;
+		r.drawIndirectFirstInstance = VK_TRUE;
+		r.depthClamp = VK_TRUE;
+		r.depthBiasClamp = VK_TRUE;
+		r.fillModeNonSolid = VK_TRUE;
+		r.depthBounds = VK_TRUE;
+		r.wideLines = VK_TRUE;
+		r.largePoints = VK_TRUE;
+		r.multiViewport = VK_TRUE;
+		r.samplerAnisotropy = VK_TRUE;
+		r.textureCompressionBC = VK_TRUE;
+		r.pipelineStatisticsQuery = VK_FALSE; // Nothing is ever rasterized, so there is nothing to count
+		r.fragmentStoresAndAtomics = VK_TRUE;
+		r.shaderImageGatherExtended = VK_TRUE;
+		r.shaderClipDistance = VK_TRUE;
+		r.shaderCullDistance = VK_TRUE;
+		return r;
+	}
+
+
+	/** A single queue family that can do everything, with timestamps. */
+	VkQueueFamilyProperties mk_queue_family() {
+		VkQueueFamilyProperties r = { };
+		r.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+		r.queueCount = Device::QUEUE_COUNT;
+		r.timestampValidBits = 64;
+		r.minImageTransferGranularity = { 1, 1, 1 };
+		return r;
+	}
+
+
+	/** Device-local and host-visible memory have separate heaps,
+	 * as on a discrete GPU, plus a small device-local heap
+	 * that the host can map. */
+	VkPhysicalDeviceMemoryProperties mk_memory_properties() {
+		constexpr VkDeviceSize GiB = VkDeviceSize(1) << 30;
+		VkPhysicalDeviceMemoryProperties r = { };
+		r.memoryHeapCount = 3;
+		r.memoryHeaps[0] = { 4 * GiB, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		r.memoryHeaps[1] = { 8 * GiB, 0 };
+		r.memoryHeaps[2] = { GiB / 4, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		r.memoryTypeCount = 3;
+		r.memoryTypes[0] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+		r.memoryTypes[1] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1 };
+		r.memoryTypes[2] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 2 };
+		return r;
+	}
+
+
+	const ProcTable& proc_table();
+
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceVersion(uint32_t* pApiVersion) {
+		*pApiVersion = API_VERSION;
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
+			const char* pLayerName, uint32_t* pPropertyCount, VkExtensionProperties* pProperties
+	) {
+		if(pLayerName != nullptr)  return VK_ERROR_LAYER_NOT_PRESENT;
+		*pPropertyCount = 0; // Nothing can be presented, so there is no surface extension
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(uint32_t* pPropertyCount, VkLayerProperties*) {
+		*pPropertyCount = 0;
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
+			const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkInstance* pInstance
+	) {
+		if(pCreateInfo->enabledExtensionCount > 0)  return VK_ERROR_EXTENSION_NOT_PRESENT;
+		auto* instance = new Instance;
+		instance->physicalDevice.instance = instance;
+		*pInstance = toHandle<VkInstance>(instance);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks*) {
+		delete fromHandle<Instance>(instance);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
+			VkInstance instance, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices
+	) {
+		VkPhysicalDevice pDev = toHandle<VkPhysicalDevice>(&fromHandle<Instance>(instance)->physicalDevice);
+		return enumerate(&pDev, 1, pPhysicalDeviceCount, pPhysicalDevices);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties* pProperties) {
+		*pProperties = { };
+		pProperties->apiVersion = API_VERSION;
+		pProperties->driverVersion = VK_MAKE_VERSION(0, 1, 0);
+		pProperties->vendorID = 0;
+		pProperties->deviceID = 0;
+		pProperties->deviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+		std::strncpy(pProperties->deviceName, DEVICE_NAME, VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+		std::memcpy(pProperties->pipelineCacheUUID, "vkapp2-nulldev-0", VK_UUID_SIZE);
+		pProperties->limits = mk_limits();
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties2(VkPhysicalDevice pDev, VkPhysicalDeviceProperties2* pProperties) {
+		vkGetPhysicalDeviceProperties(pDev, &pProperties->properties);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures(VkPhysicalDevice, VkPhysicalDeviceFeatures* pFeatures) {
+		*pFeatures = mk_features();
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures2(VkPhysicalDevice, VkPhysicalDeviceFeatures2* pFeatures) {
+		pFeatures->features = mk_features();
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceQueueFamilyProperties(
+			VkPhysicalDevice, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties* pQueueFamilyProperties
+	) {
+		VkQueueFamilyProperties family = mk_queue_family();
+		enumerate(&family, 1, pQueueFamilyPropertyCount, pQueueFamilyProperties);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceQueueFamilyProperties2(
+			VkPhysicalDevice, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties2* pQueueFamilyProperties
+	) {
+		if(pQueueFamilyProperties == nullptr) {
+			*pQueueFamilyPropertyCount = 1;
+		} else if(*pQueueFamilyPropertyCount > 0) {
+			pQueueFamilyProperties[0].queueFamilyProperties = mk_queue_family();
+			*pQueueFamilyPropertyCount = 1;
+		}
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties) {
+		*pMemoryProperties = mk_memory_properties();
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties2(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties2* pMemoryProperties) {
+		pMemoryProperties->memoryProperties = mk_memory_properties();
+	}
+
+
+	/** Every format supports everything: nothing is ever read or written. */
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFormatProperties(VkPhysicalDevice, VkFormat format, VkFormatProperties* pFormatProperties) {
+		constexpr VkFormatFeatureFlags allFeatures =
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+			VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT |
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+			VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+			VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+		constexpr VkFormatFeatureFlags bufferFeatures =
+			VK_FORMAT_FEATURE_UNIFORM_TEXEL_BUFFER_BIT | VK_FORMAT_FEATURE_STORAGE_TEXEL_BUFFER_BIT |
+			VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT;
+		if(format == VK_FORMAT_UNDEFINED) {
+			*pFormatProperties = { };
+			return;
+		}
+		pFormatProperties->linearTilingFeatures = allFeatures;
+		pFormatProperties->optimalTilingFeatures = allFeatures;
+		pFormatProperties->bufferFeatures = bufferFeatures;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFormatProperties2(VkPhysicalDevice pDev, VkFormat format, VkFormatProperties2* pFormatProperties) {
+		vkGetPhysicalDeviceFormatProperties(pDev, format, &pFormatProperties->formatProperties);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceImageFormatProperties(
+			VkPhysicalDevice, VkFormat, VkImageType, VkImageTiling, VkImageUsageFlags, VkImageCreateFlags,
+			VkImageFormatProperties* pImageFormatProperties
+	) {
+		pImageFormatProperties->maxExtent = { 16384, 16384, 2048 };
+		pImageFormatProperties->maxMipLevels = 15;
+		pImageFormatProperties->maxArrayLayers = 2048;
+		pImageFormatProperties->sampleCounts = VK_SAMPLE_COUNT_1_BIT | VK_SAMPLE_COUNT_2_BIT | VK_SAMPLE_COUNT_4_BIT | VK_SAMPLE_COUNT_8_BIT;
+		pImageFormatProperties->maxResourceSize = VkDeviceSize(1) << 32;
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
+			VkPhysicalDevice, const char* pLayerName, uint32_t* pPropertyCount, VkExtensionProperties*
+	) {
+		if(pLayerName != nullptr)  return VK_ERROR_LAYER_NOT_PRESENT;
+		*pPropertyCount = 0; // Notably, no swapchains
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(VkPhysicalDevice, uint32_t* pPropertyCount, VkLayerProperties*) {
+		*pPropertyCount = 0;
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
+			VkPhysicalDevice, const VkDeviceCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks*, VkDevice* pDevice
+	) {
+		if(pCreateInfo->enabledExtensionCount > 0)  return VK_ERROR_EXTENSION_NOT_PRESENT;
+		if((pCreateInfo->pEnabledFeatures != nullptr) && pCreateInfo->pEnabledFeatures->pipelineStatisticsQuery) {
+			return VK_ERROR_FEATURE_NOT_PRESENT; }
+		auto* dev = new Device;
+		dev->latencies = Latencies::fromEnv();
+		for(auto& queue : dev->queues) {
+			queue = std::make_unique<Queue>();
+			queue->device = dev;
+		}
+		*pDevice = toHandle<VkDevice>(dev);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(VkDevice device, const VkAllocationCallbacks*) {
+		if(device == VK_NULL_HANDLE)  return;
+		auto* dev = fromHandle<Device>(device);
+		dev->report();
+		delete dev;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(VkDevice device, uint32_t, uint32_t queueIndex, VkQueue* pQueue) {
+		*pQueue = toHandle<VkQueue>(fromHandle<Device>(device)->queues[queueIndex].get());
+	}
+
+
+	VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance, const char* pName) {
+		auto& procs = proc_table();
+		auto found = procs.find(pName);
+		return (found == procs.end())? nullptr : found->second;
+	}
+
+
+	VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice, const char* pName) {
+		return vkGetInstanceProcAddr(VK_NULL_HANDLE, pName);
+	}
+
+
+	const ProcTable& proc_table() {
+		static const ProcTable r = ([]() {
+			ProcTable r = {
+				NULLDEV_PROC_(vkGetInstanceProcAddr),
+				NULLDEV_PROC_(vkGetDeviceProcAddr),
+				NULLDEV_PROC_(vkEnumerateInstanceVersion),
+				NULLDEV_PROC_(vkEnumerateInstanceExtensionProperties),
+				NULLDEV_PROC_(vkEnumerateInstanceLayerProperties),
+				NULLDEV_PROC_(vkCreateInstance),
+				NULLDEV_PROC_(vkDestroyInstance),
+				NULLDEV_PROC_(vkEnumeratePhysicalDevices),
+				NULLDEV_PROC_(vkGetPhysicalDeviceProperties),
+				NULLDEV_PROC_(vkGetPhysicalDeviceProperties2),
+				NULLDEV_PROC_(vkGetPhysicalDeviceFeatures),
+				NULLDEV_PROC_(vkGetPhysicalDeviceFeatures2),
+				NULLDEV_PROC_(vkGetPhysicalDeviceQueueFamilyProperties),
+				NULLDEV_PROC_(vkGetPhysicalDeviceQueueFamilyProperties2),
+				NULLDEV_PROC_(vkGetPhysicalDeviceMemoryProperties),
+				NULLDEV_PROC_(vkGetPhysicalDeviceMemoryProperties2),
+				NULLDEV_PROC_(vkGetPhysicalDeviceFormatProperties),
+				NULLDEV_PROC_(vkGetPhysicalDeviceFormatProperties2),
+				NULLDEV_PROC_(vkGetPhysicalDeviceImageFormatProperties),
+				NULLDEV_PROC_(vkEnumerateDeviceExtensionProperties),
+				NULLDEV_PROC_(vkEnumerateDeviceLayerProperties),
+				NULLDEV_PROC_(vkCreateDevice),
+				NULLDEV_PROC_(vkDestroyDevice),
+				NULLDEV_PROC_(vkGetDeviceQueue) };
+			addQueueProcs(r);
+			addResourceProcs(r);
+			return r;
+		} ());
+		return r;
+	}
+
+}
+
+
+
+namespace nulldev {
+
+	ns_t nowNs() noexcept {
+		using namespace std::chrono;
+		return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+
+	void spinFor(ns_t duration) noexcept {
+		if(duration == 0)  return;
+		ns_t end = nowNs() + duration;
+		while(nowNs() < end) { }
+	}
+
+
+	void sleepUntil(ns_t time) noexcept {
+		ns_t now = nowNs();
+		if(time > now) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds(time - now)); }
+	}
+
+
+	Latencies Latencies::fromEnv() {
+		Latencies r;
+		r.submit = env_ns("VKA2_NULLDEV_SUBMIT_NS");
+		r.draw   = env_ns("VKA2_NULLDEV_DRAW_NS");
+		r.record = env_ns("VKA2_NULLDEV_RECORD_NS");
+		r.alloc  = env_ns("VKA2_NULLDEV_ALLOC_NS");
+		return r;
+	}
+
+
+	std::string_view kindName(Kind kind) {
+		#define CASE_(K_) case Kind::e##K_: return #K_;
+		switch(kind) {
+			CASE_(DeviceMemory)  CASE_(Buffer)  CASE_(BufferView)  CASE_(Image)  CASE_(ImageView)  CASE_(Sampler)
+			CASE_(ShaderModule)  CASE_(PipelineCache)  CASE_(PipelineLayout)  CASE_(Pipeline)
+			CASE_(DescriptorSetLayout)  CASE_(DescriptorPool)  CASE_(RenderPass)  CASE_(Framebuffer)
+			CASE_(CommandPool)  CASE_(Fence)  CASE_(Semaphore)  CASE_(Event)  CASE_(QueryPool)
+			case Kind::eCount: break;
+		}
+		#undef CASE_
+		return "?";
+	}
+
+
+	void Device::report() const {
+		#define STAT_(NAME_) (unsigned long long) stats.NAME_.load(std::memory_order_relaxed)
+		std::fprintf(stderr,
+			"[nulldev] %llu submits, %llu command buffers, %llu commands (%llu draws), %llu descriptor writes\n"
+			"[nulldev] %llu memory allocations, %llu bytes peak\n"
+			"[nulldev] %llu fence waits, %.3f ms blocked\n",
+			STAT_(submits), STAT_(recordedCmdBuffers), STAT_(commands), STAT_(draws), STAT_(descriptorWrites),
+			STAT_(allocations), STAT_(peakAllocatedBytes),
+			STAT_(fenceWaits), double(stats.fenceWaitNs.load(std::memory_order_relaxed)) / 1.0e6);
+		#undef STAT_
+		for(size_t i=0; i < liveObjects.size(); ++i) {
+			auto count = liveObjects[i].load(std::memory_order_relaxed);
+			if(count != 0) {
+				std::string name = std::string(kindName(Kind(i)));
+				std::fprintf(stderr, "[nulldev] %lld %s objects were not destroyed\n", (long long) count, name.c_str());
+			}
+		}
+	}
+
+}
+
+
+
+extern "C" {
+
+	__attribute__((visibility("default")))
+	VKAPI_ATTR VkResult VKAPI_CALL vk_icdNegotiateLoaderICDInterfaceVersion(uint32_t* pSupportedVersion) {
+		*pSupportedVersion = std::min(*pSupportedVersion, LOADER_INTERFACE_VERSION);
+		return VK_SUCCESS;
+	}
+
+
+	__attribute__((visibility("default")))
+	VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vk_icdGetInstanceProcAddr(VkInstance instance, const char* pName) {
+		return vkGetInstanceProcAddr(instance, pName);
+	}
+
+}
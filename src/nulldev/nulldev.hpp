@@ -0,0 +1,257 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+/* A Vulkan driver (ICD) that doesn't drive anything: objects are
+ * plain allocations, commands are only counted, and submissions
+ * complete after a configurable amount of simulated GPU time.
+ *
+ * It lets the application run its whole frame loop, including
+ * command recording, submission and synchronization, on machines
+ * without a GPU, so that its CPU-side cost can be measured in
+ * isolation; nothing is ever rendered. */
+
+#pragma once
+
+#define VK_NO_PROTOTYPES // The loader's symbols must never be called (or interposed) from here
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_icd.h>
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace nulldev {
+
+	using ns_t = uint64_t;
+
+	constexpr ns_t NEVER = UINT64_MAX;
+
+	ns_t nowNs() noexcept;
+
+	/** Keeps the calling thread busy, as a driver doing actual work would. */
+	void spinFor(ns_t) noexcept;
+
+	/** Sleeps until the given time, or returns immediately if it has passed. */
+	void sleepUntil(ns_t) noexcept;
+
+
+	/** Fake latencies, read from the environment when a device is
+	 * created; every value is in nanoseconds, and defaults to 0. */
+	struct Latencies {
+		ns_t submit; // GPU time taken by each submitted batch      (VKA2_NULLDEV_SUBMIT_NS)
+		ns_t draw;   // GPU time taken by each draw or dispatch     (VKA2_NULLDEV_DRAW_NS)
+		ns_t record; // CPU time spent recording each command       (VKA2_NULLDEV_RECORD_NS)
+		ns_t alloc;  // CPU time spent on each memory allocation    (VKA2_NULLDEV_ALLOC_NS)
+
+		static Latencies fromEnv();
+	};
+
+
+	/** Counters that are printed when the device is destroyed. */
+	struct Stats {
+		std::atomic<uint64_t> submits = 0;
+		std::atomic<uint64_t> recordedCmdBuffers = 0;
+		std::atomic<uint64_t> commands = 0;
+		std::atomic<uint64_t> draws = 0;
+		std::atomic<uint64_t> descriptorWrites = 0;
+		std::atomic<uint64_t> allocations = 0;
+		std::atomic<uint64_t> allocatedBytes = 0;
+		std::atomic<uint64_t> peakAllocatedBytes = 0;
+		std::atomic<uint64_t> fenceWaits = 0;
+		std::atomic<uint64_t> fenceWaitNs = 0;
+	};
+
+
+	enum class Kind : unsigned {
+		eDeviceMemory, eBuffer, eBufferView, eImage, eImageView, eSampler,
+		eShaderModule, ePipelineCache, ePipelineLayout, ePipeline,
+		eDescriptorSetLayout, eDescriptorPool, eRenderPass, eFramebuffer,
+		eCommandPool, eFence, eSemaphore, eEvent, eQueryPool,
+		eCount
+	};
+
+	std::string_view kindName(Kind);
+
+
+	/* Non-dispatchable handles are pointers on 64-bit platforms,
+	 * and opaque 64-bit integers elsewhere. */
+
+	template<typename Handle, typename T>
+	Handle toHandle(T* obj) noexcept {
+		if constexpr(std::is_pointer_v<Handle>) {
+			return reinterpret_cast<Handle>(obj);
+		} else {
+			return static_cast<Handle>(reinterpret_cast<uintptr_t>(obj));
+		}
+	}
+
+	template<typename T, typename Handle>
+	T* fromHandle(Handle handle) noexcept {
+		if constexpr(std::is_pointer_v<Handle>) {
+			return reinterpret_cast<T*>(handle);
+		} else {
+			return reinterpret_cast<T*>(static_cast<uintptr_t>(handle));
+		}
+	}
+
+
+	/** The loader writes its dispatch table into the first
+	 * pointer of every dispatchable object. */
+	struct Dispatchable {
+		VK_LOADER_DATA loaderData;
+
+		Dispatchable() { loaderData.loaderMagic = ICD_LOADER_MAGIC; }
+		Dispatchable(const Dispatchable&) = delete;
+		Dispatchable& operator=(const Dispatchable&) = delete;
+	};
+
+
+	struct Instance;
+	struct Device;
+	struct QueryPool;
+	struct CommandPool;
+
+
+	struct PhysicalDevice : Dispatchable {
+		Instance* instance;
+	};
+
+
+	struct Instance : Dispatchable {
+		PhysicalDevice physicalDevice;
+	};
+
+
+	struct Queue : Dispatchable {
+		Device* device;
+		std::mutex mutex;
+		ns_t busyUntil = 0; // When the last submitted batch completes
+	};
+
+
+	struct Device : Dispatchable {
+		static constexpr uint32_t QUEUE_COUNT = 4; // All in the same family
+
+		Latencies latencies;
+		Stats stats;
+		std::array<std::atomic<int64_t>, size_t(Kind::eCount)> liveObjects = { };
+		std::array<std::unique_ptr<Queue>, QUEUE_COUNT> queues;
+
+		/** Prints the stats, and every object that hasn't been destroyed. */
+		void report() const;
+	};
+
+
+	/** The base of every non-dispatchable object, which keeps track of
+	 * how many objects of each kind are alive. */
+	struct Object {
+		Device* device;
+		Kind kind;
+
+		Object(Device* dev, Kind k): device(dev), kind(k) {
+			device->liveObjects[size_t(kind)].fetch_add(1, std::memory_order_relaxed); }
+		virtual ~Object() {
+			device->liveObjects[size_t(kind)].fetch_sub(1, std::memory_order_relaxed); }
+
+		Object(const Object&) = delete;
+		Object& operator=(const Object&) = delete;
+	};
+
+
+	struct CommandBuffer : Dispatchable {
+		/** A query operation, applied when the command buffer is submitted;
+		 * queries are written `gpuOffset` ns after the command buffer begins
+		 * executing, which is also the value of timestamps. */
+		struct QueryOp {
+			QueryPool* pool;
+			uint32_t first;
+			uint32_t count;
+			ns_t gpuOffset;
+			bool reset; // Otherwise, the queries are written
+		};
+
+		Device* device;
+		CommandPool* pool;
+		uint64_t commands = 0;
+		ns_t gpuNs = 0; // The GPU time the recorded commands would take
+		std::vector<QueryOp> queryOps;
+	};
+
+
+	struct Fence : Object {
+		std::atomic<ns_t> signalAt; // NEVER if unsignaled and not submitted
+
+		Fence(Device* dev, bool signaled): Object(dev, Kind::eFence), signalAt(signaled? 0 : NEVER) { }
+	};
+
+
+	struct Semaphore : Object {
+		std::atomic<ns_t> signalAt = 0; // Binary semaphores are only waited after being signaled
+
+		Semaphore(Device* dev): Object(dev, Kind::eSemaphore) { }
+	};
+
+
+	struct QueryPool : Object {
+		VkQueryType type;
+		uint32_t valuesPerQuery;
+		std::vector<uint64_t> values;
+		std::vector<std::atomic<ns_t>> availableAt; // When the simulated GPU writes each query, or NEVER
+
+		QueryPool(Device* dev, VkQueryType t, uint32_t count, uint32_t perQuery):
+				Object(dev, Kind::eQueryPool), type(t), valuesPerQuery(perQuery),
+				values(size_t(count) * perQuery, 0), availableAt(count)
+		{
+			for(auto& query : availableAt) {
+				query.store(NEVER, std::memory_order_relaxed); }
+		}
+	};
+
+
+	struct CommandPool : Object {
+		std::vector<std::unique_ptr<CommandBuffer>> buffers;
+
+		CommandPool(Device* dev): Object(dev, Kind::eCommandPool) { }
+	};
+
+
+	using ProcTable = std::unordered_map<std::string_view, PFN_vkVoidFunction>;
+
+	#define NULLDEV_PROC_(NAME_) { #NAME_, reinterpret_cast<PFN_vkVoidFunction>(&NAME_) }
+
+	/* Each translation unit adds the entry points it implements;
+	 * functions that aren't in the table are reported as missing. */
+	void addQueueProcs(ProcTable&);
+	void addResourceProcs(ProcTable&);
+
+}
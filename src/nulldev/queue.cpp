@@ -0,0 +1,511 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "nulldev/nulldev.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+
+
+using namespace nulldev;
+
+
+
+namespace {
+
+	/** How long a fence waits before checking again whether it has been
+	 * submitted, if it wasn't when the wait began. */
+	constexpr ns_t UNSUBMITTED_POLL_NS = 1'000'000;
+
+
+	CommandBuffer* cmd_buffer(VkCommandBuffer handle) {
+		return fromHandle<CommandBuffer>(handle);
+	}
+
+
+	/** Every recorded command goes through here. */
+	void record_cmd(VkCommandBuffer handle, ns_t gpuNs = 0) {
+		auto* cmd = cmd_buffer(handle);
+		++ cmd->commands;
+		cmd->gpuNs += gpuNs;
+		spinFor(cmd->device->latencies.record);
+	}
+
+
+	void record_draw(VkCommandBuffer handle) {
+		auto* cmd = cmd_buffer(handle);
+		cmd->device->stats.draws.fetch_add(1, std::memory_order_relaxed);
+		record_cmd(handle, cmd->device->latencies.draw);
+	}
+
+
+	/** Applies the query operations of a command buffer that
+	 * starts executing at the given time. */
+	void apply_query_ops(const CommandBuffer& cmd, ns_t beginNs) {
+		for(const auto& op : cmd.queryOps) {
+			for(uint32_t i = op.first; i < op.first + op.count; ++i) {
+				if(op.reset) {
+					op.pool->availableAt[i].store(NEVER, std::memory_order_relaxed);
+				} else {
+					// Timestamps are the only queries with a meaningful value
+					ns_t writtenAt = beginNs + op.gpuOffset;
+					std::fill_n(op.pool->values.begin() + (size_t(i) * op.pool->valuesPerQuery), op.pool->valuesPerQuery,
+						(op.pool->type == VK_QUERY_TYPE_TIMESTAMP)? writtenAt : 0);
+					op.pool->availableAt[i].store(writtenAt, std::memory_order_release);
+				}
+			}
+		}
+	}
+
+
+	/** The time at which the given fences are signaled: the latest one if
+	 * `waitAll`, the earliest one otherwise; NEVER if some of the
+	 * relevant fences haven't been submitted yet. */
+	ns_t fences_signal_time(uint32_t fenceCount, const VkFence* pFences, bool waitAll) {
+		ns_t r = waitAll? 0 : NEVER;
+		for(uint32_t i=0; i < fenceCount; ++i) {
+			ns_t signalAt = fromHandle<Fence>(pFences[i])->signalAt.load(std::memory_order_acquire);
+			r = waitAll? std::max(r, signalAt) : std::min(r, signalAt);
+		}
+		return r;
+	}
+
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence) {
+		auto* q = fromHandle<Queue>(queue);
+		auto& stats = q->device->stats;
+		ns_t fenceSignalAt;
+		{
+			auto lock = std::unique_lock(q->mutex);
+			ns_t now = nowNs();
+			for(uint32_t i=0; i < submitCount; ++i) {
+				const auto& submit = pSubmits[i];
+				ns_t begin = std::max(now, q->busyUntil);
+				for(uint32_t j=0; j < submit.waitSemaphoreCount; ++j) {
+					begin = std::max(begin, fromHandle<Semaphore>(submit.pWaitSemaphores[j])->signalAt.load(std::memory_order_acquire)); }
+				ns_t end = begin + q->device->latencies.submit;
+				for(uint32_t j=0; j < submit.commandBufferCount; ++j) {
+					auto* cmd = cmd_buffer(submit.pCommandBuffers[j]);
+					apply_query_ops(*cmd, end);
+					end += cmd->gpuNs;
+				}
+				for(uint32_t j=0; j < submit.signalSemaphoreCount; ++j) {
+					fromHandle<Semaphore>(submit.pSignalSemaphores[j])->signalAt.store(end, std::memory_order_release); }
+				q->busyUntil = end;
+			}
+			fenceSignalAt = std::max(now, q->busyUntil);
+		}
+		if(fence != VK_NULL_HANDLE) {
+			fromHandle<Fence>(fence)->signalAt.store(fenceSignalAt, std::memory_order_release); }
+		stats.submits.fetch_add(submitCount, std::memory_order_relaxed);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkQueueWaitIdle(VkQueue queue) {
+		auto* q = fromHandle<Queue>(queue);
+		ns_t busyUntil;
+		{
+			auto lock = std::unique_lock(q->mutex);
+			busyUntil = q->busyUntil;
+		}
+		sleepUntil(busyUntil);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkDeviceWaitIdle(VkDevice device) {
+		for(auto& queue : fromHandle<Device>(device)->queues) {
+			vkQueueWaitIdle(toHandle<VkQueue>(queue.get())); }
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateFence(
+			VkDevice device, const VkFenceCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkFence* pFence
+	) {
+		bool signaled = (pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0;
+		*pFence = toHandle<VkFence>(new Fence(fromHandle<Device>(device), signaled));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyFence(VkDevice, VkFence fence, const VkAllocationCallbacks*) {
+		delete fromHandle<Fence>(fence);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkResetFences(VkDevice, uint32_t fenceCount, const VkFence* pFences) {
+		for(uint32_t i=0; i < fenceCount; ++i) {
+			fromHandle<Fence>(pFences[i])->signalAt.store(NEVER, std::memory_order_release); }
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkGetFenceStatus(VkDevice, VkFence fence) {
+		return (fromHandle<Fence>(fence)->signalAt.load(std::memory_order_acquire) <= nowNs())? VK_SUCCESS : VK_NOT_READY;
+	}
+
+
+	/** Sleeps until the simulated GPU would have signaled the fences;
+	 * fences that haven't been submitted yet are checked periodically,
+	 * since another thread may submit them during the wait. */
+	VKAPI_ATTR VkResult VKAPI_CALL vkWaitForFences(
+			VkDevice device, uint32_t fenceCount, const VkFence* pFences, VkBool32 waitAll, uint64_t timeout
+	) {
+		auto& stats = fromHandle<Device>(device)->stats;
+		ns_t begin = nowNs();
+		ns_t deadline = (timeout > NEVER - begin)? NEVER : (begin + timeout);
+		VkResult r;
+		while(true) {
+			ns_t signalAt = fences_signal_time(fenceCount, pFences, waitAll);
+			ns_t now = nowNs();
+			if(signalAt <= now) {
+				r = VK_SUCCESS;
+				break;
+			}
+			if(now >= deadline) {
+				r = VK_TIMEOUT;
+				break;
+			}
+			sleepUntil(std::min({ signalAt, deadline, now + UNSUBMITTED_POLL_NS }));
+		}
+		stats.fenceWaits.fetch_add(1, std::memory_order_relaxed);
+		stats.fenceWaitNs.fetch_add(nowNs() - begin, std::memory_order_relaxed);
+		return r;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateSemaphore(
+			VkDevice device, const VkSemaphoreCreateInfo*, const VkAllocationCallbacks*, VkSemaphore* pSemaphore
+	) {
+		*pSemaphore = toHandle<VkSemaphore>(new Semaphore(fromHandle<Device>(device)));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroySemaphore(VkDevice, VkSemaphore semaphore, const VkAllocationCallbacks*) {
+		delete fromHandle<Semaphore>(semaphore);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateQueryPool(
+			VkDevice device, const VkQueryPoolCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkQueryPool* pQueryPool
+	) {
+		uint32_t valuesPerQuery = 1;
+		if(pCreateInfo->queryType == VK_QUERY_TYPE_PIPELINE_STATISTICS) {
+			valuesPerQuery = std::max(1, std::popcount(uint32_t(pCreateInfo->pipelineStatistics))); }
+		*pQueryPool = toHandle<VkQueryPool>(new QueryPool(fromHandle<Device>(device),
+			pCreateInfo->queryType, pCreateInfo->queryCount, valuesPerQuery));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyQueryPool(VkDevice, VkQueryPool queryPool, const VkAllocationCallbacks*) {
+		delete fromHandle<QueryPool>(queryPool);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkResetQueryPool(VkDevice, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
+		auto* pool = fromHandle<QueryPool>(queryPool);
+		for(uint32_t i = firstQuery; i < firstQuery + queryCount; ++i) {
+			pool->availableAt[i].store(NEVER, std::memory_order_relaxed); }
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkGetQueryPoolResults(
+			VkDevice, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount,
+			size_t dataSize, void* pData, VkDeviceSize stride, VkQueryResultFlags flags
+	) {
+		auto* pool = fromHandle<QueryPool>(queryPool);
+		bool is64 = (flags & VK_QUERY_RESULT_64_BIT) != 0;
+		bool withAvailability = (flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) != 0;
+		VkResult r = VK_SUCCESS;
+		for(uint32_t i=0; i < queryCount; ++i) {
+			uint32_t query = firstQuery + i;
+			auto* dst = static_cast<char*>(pData) + (stride * i);
+			ns_t availableAt = pool->availableAt[query].load(std::memory_order_acquire);
+			if((flags & VK_QUERY_RESULT_WAIT_BIT) && (availableAt != NEVER)) {
+				// Waiting for queries that haven't been submitted would never end
+				sleepUntil(availableAt); }
+			bool available = availableAt <= nowNs();
+			if(! available)  r = VK_NOT_READY;
+			auto write = [&](uint32_t idx, uint64_t value) {
+				if(is64) std::memcpy(dst + (idx * 8), &value, 8);
+				else { uint32_t v32 = uint32_t(value);  std::memcpy(dst + (idx * 4), &v32, 4); }
+			};
+			if(available || (flags & VK_QUERY_RESULT_PARTIAL_BIT)) {
+				for(uint32_t j=0; j < pool->valuesPerQuery; ++j) {
+					write(j, pool->values[(size_t(query) * pool->valuesPerQuery) + j]); }
+			}
+			if(withAvailability) {
+				write(pool->valuesPerQuery, available? 1 : 0); }
+		}
+		(void) dataSize;
+		return r;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateCommandPool(
+			VkDevice device, const VkCommandPoolCreateInfo*, const VkAllocationCallbacks*, VkCommandPool* pCommandPool
+	) {
+		*pCommandPool = toHandle<VkCommandPool>(new CommandPool(fromHandle<Device>(device)));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyCommandPool(VkDevice, VkCommandPool commandPool, const VkAllocationCallbacks*) {
+		delete fromHandle<CommandPool>(commandPool);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkResetCommandPool(VkDevice, VkCommandPool commandPool, VkCommandPoolResetFlags) {
+		for(auto& cmd : fromHandle<CommandPool>(commandPool)->buffers) {
+			cmd->commands = 0;
+			cmd->gpuNs = 0;
+			cmd->queryOps.clear();
+		}
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkAllocateCommandBuffers(
+			VkDevice device, const VkCommandBufferAllocateInfo* pAllocateInfo, VkCommandBuffer* pCommandBuffers
+	) {
+		auto* pool = fromHandle<CommandPool>(pAllocateInfo->commandPool);
+		for(uint32_t i=0; i < pAllocateInfo->commandBufferCount; ++i) {
+			auto& cmd = pool->buffers.emplace_back(std::make_unique<CommandBuffer>());
+			cmd->device = fromHandle<Device>(device);
+			cmd->pool = pool;
+			pCommandBuffers[i] = toHandle<VkCommandBuffer>(cmd.get());
+		}
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkFreeCommandBuffers(
+			VkDevice, VkCommandPool commandPool, uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers
+	) {
+		auto& buffers = fromHandle<CommandPool>(commandPool)->buffers;
+		for(uint32_t i=0; i < commandBufferCount; ++i) {
+			auto* cmd = cmd_buffer(pCommandBuffers[i]);
+			if(cmd == nullptr)  continue;
+			std::erase_if(buffers, [cmd](const auto& buffer) { return buffer.get() == cmd; });
+		}
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo*) {
+		auto* cmd = cmd_buffer(commandBuffer);
+		cmd->commands = 0;
+		cmd->gpuNs = 0;
+		cmd->queryOps.clear();
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkEndCommandBuffer(VkCommandBuffer commandBuffer) {
+		auto* cmd = cmd_buffer(commandBuffer);
+		cmd->device->stats.recordedCmdBuffers.fetch_add(1, std::memory_order_relaxed);
+		cmd->device->stats.commands.fetch_add(cmd->commands, std::memory_order_relaxed);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkResetCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags) {
+		return vkBeginCommandBuffer(commandBuffer, nullptr);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkCmdResetQueryPool(VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
+		record_cmd(commandBuffer);
+		cmd_buffer(commandBuffer)->queryOps.push_back({ fromHandle<QueryPool>(queryPool), firstQuery, queryCount, 0, true });
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkCmdWriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits, VkQueryPool queryPool, uint32_t query) {
+		record_cmd(commandBuffer);
+		auto* cmd = cmd_buffer(commandBuffer);
+		cmd->queryOps.push_back({ fromHandle<QueryPool>(queryPool), query, 1, cmd->gpuNs, false });
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkCmdBeginQuery(VkCommandBuffer commandBuffer, VkQueryPool, uint32_t, VkQueryControlFlags) {
+		record_cmd(commandBuffer);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkCmdEndQuery(VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t query) {
+		record_cmd(commandBuffer);
+		auto* cmd = cmd_buffer(commandBuffer);
+		cmd->queryOps.push_back({ fromHandle<QueryPool>(queryPool), query, 1, cmd->gpuNs, false });
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkCmdExecuteCommands(VkCommandBuffer commandBuffer, uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers) {
+		record_cmd(commandBuffer);
+		auto* cmd = cmd_buffer(commandBuffer);
+		for(uint32_t i=0; i < commandBufferCount; ++i) {
+			auto* secondary = cmd_buffer(pCommandBuffers[i]);
+			for(auto op : secondary->queryOps) {
+				op.gpuOffset += cmd->gpuNs;
+				cmd->queryOps.push_back(op);
+			}
+			cmd->gpuNs += secondary->gpuNs;
+		}
+	}
+
+
+	/* The commands that don't need more than being counted; draws and
+	 * dispatches also take the configured amount of GPU time. */
+	#define CMD_(NAME_, ...) VKAPI_ATTR void VKAPI_CALL NAME_(VkCommandBuffer commandBuffer, __VA_ARGS__) { record_cmd(commandBuffer); }
+	#define DRAW_CMD_(NAME_, ...) VKAPI_ATTR void VKAPI_CALL NAME_(VkCommandBuffer commandBuffer, __VA_ARGS__) { record_draw(commandBuffer); }
+		CMD_(vkCmdBindPipeline, VkPipelineBindPoint, VkPipeline)
+		CMD_(vkCmdSetViewport, uint32_t, uint32_t, const VkViewport*)
+		CMD_(vkCmdSetScissor, uint32_t, uint32_t, const VkRect2D*)
+		CMD_(vkCmdSetLineWidth, float)
+		CMD_(vkCmdSetDepthBias, float, float, float)
+		CMD_(vkCmdSetBlendConstants, const float[4])
+		CMD_(vkCmdSetDepthBounds, float, float)
+		CMD_(vkCmdSetStencilCompareMask, VkStencilFaceFlags, uint32_t)
+		CMD_(vkCmdSetStencilWriteMask, VkStencilFaceFlags, uint32_t)
+		CMD_(vkCmdSetStencilReference, VkStencilFaceFlags, uint32_t)
+		CMD_(vkCmdBindDescriptorSets, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t, const VkDescriptorSet*, uint32_t, const uint32_t*)
+		CMD_(vkCmdBindIndexBuffer, VkBuffer, VkDeviceSize, VkIndexType)
+		CMD_(vkCmdBindVertexBuffers, uint32_t, uint32_t, const VkBuffer*, const VkDeviceSize*)
+		DRAW_CMD_(vkCmdDraw, uint32_t, uint32_t, uint32_t, uint32_t)
+		DRAW_CMD_(vkCmdDrawIndexed, uint32_t, uint32_t, uint32_t, int32_t, uint32_t)
+		DRAW_CMD_(vkCmdDrawIndirect, VkBuffer, VkDeviceSize, uint32_t, uint32_t)
+		DRAW_CMD_(vkCmdDrawIndexedIndirect, VkBuffer, VkDeviceSize, uint32_t, uint32_t)
+		DRAW_CMD_(vkCmdDispatch, uint32_t, uint32_t, uint32_t)
+		DRAW_CMD_(vkCmdDispatchIndirect, VkBuffer, VkDeviceSize)
+		CMD_(vkCmdCopyBuffer, VkBuffer, VkBuffer, uint32_t, const VkBufferCopy*)
+		CMD_(vkCmdCopyImage, VkImage, VkImageLayout, VkImage, VkImageLayout, uint32_t, const VkImageCopy*)
+		CMD_(vkCmdBlitImage, VkImage, VkImageLayout, VkImage, VkImageLayout, uint32_t, const VkImageBlit*, VkFilter)
+		CMD_(vkCmdCopyBufferToImage, VkBuffer, VkImage, VkImageLayout, uint32_t, const VkBufferImageCopy*)
+		CMD_(vkCmdCopyImageToBuffer, VkImage, VkImageLayout, VkBuffer, uint32_t, const VkBufferImageCopy*)
+		CMD_(vkCmdUpdateBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, const void*)
+		CMD_(vkCmdFillBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, uint32_t)
+		CMD_(vkCmdClearColorImage, VkImage, VkImageLayout, const VkClearColorValue*, uint32_t, const VkImageSubresourceRange*)
+		CMD_(vkCmdClearDepthStencilImage, VkImage, VkImageLayout, const VkClearDepthStencilValue*, uint32_t, const VkImageSubresourceRange*)
+		CMD_(vkCmdClearAttachments, uint32_t, const VkClearAttachment*, uint32_t, const VkClearRect*)
+		CMD_(vkCmdResolveImage, VkImage, VkImageLayout, VkImage, VkImageLayout, uint32_t, const VkImageResolve*)
+		CMD_(vkCmdSetEvent, VkEvent, VkPipelineStageFlags)
+		CMD_(vkCmdResetEvent, VkEvent, VkPipelineStageFlags)
+		CMD_(vkCmdWaitEvents, uint32_t, const VkEvent*, VkPipelineStageFlags, VkPipelineStageFlags,
+			uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*, uint32_t, const VkImageMemoryBarrier*)
+		CMD_(vkCmdPipelineBarrier, VkPipelineStageFlags, VkPipelineStageFlags, VkDependencyFlags,
+			uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*, uint32_t, const VkImageMemoryBarrier*)
+		CMD_(vkCmdCopyQueryPoolResults, VkQueryPool, uint32_t, uint32_t, VkBuffer, VkDeviceSize, VkDeviceSize, VkQueryResultFlags)
+		CMD_(vkCmdPushConstants, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, const void*)
+		CMD_(vkCmdBeginRenderPass, const VkRenderPassBeginInfo*, VkSubpassContents)
+		CMD_(vkCmdNextSubpass, VkSubpassContents)
+	#undef CMD_
+	#undef DRAW_CMD_
+
+	VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer commandBuffer) {
+		record_cmd(commandBuffer);
+	}
+
+}
+
+
+
+namespace nulldev {
+
+	void addQueueProcs(ProcTable& procs) {
+		procs.insert({
+			NULLDEV_PROC_(vkQueueSubmit),
+			NULLDEV_PROC_(vkQueueWaitIdle),
+			NULLDEV_PROC_(vkDeviceWaitIdle),
+			NULLDEV_PROC_(vkCreateFence),
+			NULLDEV_PROC_(vkDestroyFence),
+			NULLDEV_PROC_(vkResetFences),
+			NULLDEV_PROC_(vkGetFenceStatus),
+			NULLDEV_PROC_(vkWaitForFences),
+			NULLDEV_PROC_(vkCreateSemaphore),
+			NULLDEV_PROC_(vkDestroySemaphore),
+			NULLDEV_PROC_(vkCreateQueryPool),
+			NULLDEV_PROC_(vkDestroyQueryPool),
+			NULLDEV_PROC_(vkResetQueryPool),
+			NULLDEV_PROC_(vkGetQueryPoolResults),
+			NULLDEV_PROC_(vkCreateCommandPool),
+			NULLDEV_PROC_(vkDestroyCommandPool),
+			NULLDEV_PROC_(vkResetCommandPool),
+			NULLDEV_PROC_(vkAllocateCommandBuffers),
+			NULLDEV_PROC_(vkFreeCommandBuffers),
+			NULLDEV_PROC_(vkBeginCommandBuffer),
+			NULLDEV_PROC_(vkEndCommandBuffer),
+			NULLDEV_PROC_(vkResetCommandBuffer),
+			NULLDEV_PROC_(vkCmdResetQueryPool),
+			NULLDEV_PROC_(vkCmdWriteTimestamp),
+			NULLDEV_PROC_(vkCmdBeginQuery),
+			NULLDEV_PROC_(vkCmdEndQuery),
+			NULLDEV_PROC_(vkCmdExecuteCommands),
+			NULLDEV_PROC_(vkCmdBindPipeline),
+			NULLDEV_PROC_(vkCmdSetViewport),
+			NULLDEV_PROC_(vkCmdSetScissor),
+			NULLDEV_PROC_(vkCmdSetLineWidth),
+			NULLDEV_PROC_(vkCmdSetDepthBias),
+			NULLDEV_PROC_(vkCmdSetBlendConstants),
+			NULLDEV_PROC_(vkCmdSetDepthBounds),
+			NULLDEV_PROC_(vkCmdSetStencilCompareMask),
+			NULLDEV_PROC_(vkCmdSetStencilWriteMask),
+			NULLDEV_PROC_(vkCmdSetStencilReference),
+			NULLDEV_PROC_(vkCmdBindDescriptorSets),
+			NULLDEV_PROC_(vkCmdBindIndexBuffer),
+			NULLDEV_PROC_(vkCmdBindVertexBuffers),
+			NULLDEV_PROC_(vkCmdDraw),
+			NULLDEV_PROC_(vkCmdDrawIndexed),
+			NULLDEV_PROC_(vkCmdDrawIndirect),
+			NULLDEV_PROC_(vkCmdDrawIndexedIndirect),
+			NULLDEV_PROC_(vkCmdDispatch),
+			NULLDEV_PROC_(vkCmdDispatchIndirect),
+			NULLDEV_PROC_(vkCmdCopyBuffer),
+			NULLDEV_PROC_(vkCmdCopyImage),
+			NULLDEV_PROC_(vkCmdBlitImage),
+			NULLDEV_PROC_(vkCmdCopyBufferToImage),
+			NULLDEV_PROC_(vkCmdCopyImageToBuffer),
+			NULLDEV_PROC_(vkCmdUpdateBuffer),
+			NULLDEV_PROC_(vkCmdFillBuffer),
+			NULLDEV_PROC_(vkCmdClearColorImage),
+			NULLDEV_PROC_(vkCmdClearDepthStencilImage),
+			NULLDEV_PROC_(vkCmdClearAttachments),
+			NULLDEV_PROC_(vkCmdResolveImage),
+			NULLDEV_PROC_(vkCmdSetEvent),
+			NULLDEV_PROC_(vkCmdResetEvent),
+			NULLDEV_PROC_(vkCmdWaitEvents),
+			NULLDEV_PROC_(vkCmdPipelineBarrier),
+			NULLDEV_PROC_(vkCmdCopyQueryPoolResults),
+			NULLDEV_PROC_(vkCmdPushConstants),
+			NULLDEV_PROC_(vkCmdBeginRenderPass),
+			NULLDEV_PROC_(vkCmdNextSubpass),
+			NULLDEV_PROC_(vkCmdEndRenderPass) });
+	}
+
+}
@@ -0,0 +1,531 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "nulldev/nulldev.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+
+
+using namespace nulldev;
+
+
+
+namespace {
+
+	constexpr uint32_t ALL_MEMORY_TYPES = 0b111;
+	constexpr VkDeviceSize BUFFER_ALIGNMENT = 256;
+	constexpr VkDeviceSize IMAGE_ALIGNMENT = 4096;
+
+
+	/** Host memory backs every allocation, so that mapped memory can
+	 * actually be written; `calloc` leaves untouched pages uncommitted. */
+	struct DeviceMemory : Object {
+		void* data;
+		VkDeviceSize size;
+
+		DeviceMemory(Device* dev, VkDeviceSize sz):
+				Object(dev, Kind::eDeviceMemory), data(std::calloc(sz, 1)), size(sz)
+		{ }
+		~DeviceMemory() { std::free(data); }
+	};
+
+
+	struct Buffer : Object {
+		VkDeviceSize size;
+
+		Buffer(Device* dev, VkDeviceSize sz): Object(dev, Kind::eBuffer), size(sz) { }
+	};
+
+
+	struct Image : Object {
+		VkFormat format;
+		VkExtent3D extent;
+		uint32_t mipLevels;
+		uint32_t arrayLayers;
+		VkSampleCountFlagBits samples;
+
+		Image(Device* dev, const VkImageCreateInfo& info):
+				Object(dev, Kind::eImage),
+				format(info.format), extent(info.extent),
+				mipLevels(info.mipLevels), arrayLayers(info.arrayLayers),
+				samples(info.samples)
+		{ }
+	};
+
+
+	struct DescriptorPool;
+
+	/** Descriptor sets belong to their pool, and aren't counted as objects. */
+	struct DescriptorSet {
+		DescriptorPool* pool;
+	};
+
+
+	struct DescriptorPool : Object {
+		uint32_t maxSets;
+		std::vector<std::unique_ptr<DescriptorSet>> sets;
+
+		DescriptorPool(Device* dev, uint32_t max): Object(dev, Kind::eDescriptorPool), maxSets(max) { }
+	};
+
+
+	VkDeviceSize align(VkDeviceSize value, VkDeviceSize alignment) {
+		return ((value + alignment - 1) / alignment) * alignment;
+	}
+
+
+	/** A plausible size for a texel of the given format; compressed
+	 * formats are overestimated, which is harmless. */
+	VkDeviceSize texel_size(VkFormat format) {
+		switch(format) {
+			case VK_FORMAT_R8_UNORM: case VK_FORMAT_R8_SNORM: case VK_FORMAT_R8_UINT:
+			case VK_FORMAT_R8_SINT: case VK_FORMAT_R8_SRGB: case VK_FORMAT_S8_UINT:
+				return 1;
+			case VK_FORMAT_R8G8_UNORM: case VK_FORMAT_R8G8_SNORM: case VK_FORMAT_R8G8_UINT:
+			case VK_FORMAT_R8G8_SINT: case VK_FORMAT_R8G8_SRGB: case VK_FORMAT_R16_UNORM:
+			case VK_FORMAT_R16_SFLOAT: case VK_FORMAT_R16_UINT: case VK_FORMAT_R16_SINT:
+			case VK_FORMAT_D16_UNORM:
+				return 2;
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+				return 3;
+			case VK_FORMAT_R16G16B16A16_UNORM: case VK_FORMAT_R16G16B16A16_SFLOAT:
+			case VK_FORMAT_R16G16B16A16_UINT: case VK_FORMAT_R16G16B16A16_SINT:
+			case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32_SINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return 8;
+			case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32_SINT:
+				return 12;
+			case VK_FORMAT_R32G32B32A32_SFLOAT: case VK_FORMAT_R32G32B32A32_UINT: case VK_FORMAT_R32G32B32A32_SINT:
+				return 16;
+			default:
+				return 4;
+		}
+	}
+
+
+	VkDeviceSize image_size(const Image& img) {
+		VkDeviceSize r = 0;
+		for(uint32_t level = 0; level < img.mipLevels; ++level) {
+			VkDeviceSize w = std::max(img.extent.width >> level, 1u);
+			VkDeviceSize h = std::max(img.extent.height >> level, 1u);
+			VkDeviceSize d = std::max(img.extent.depth >> level, 1u);
+			r += w * h * d;
+		}
+		return r * img.arrayLayers * VkDeviceSize(img.samples) * texel_size(img.format);
+	}
+
+
+	VkMemoryRequirements buffer_requirements(VkBuffer buffer) {
+		VkMemoryRequirements r;
+		r.size = align(std::max<VkDeviceSize>(fromHandle<Buffer>(buffer)->size, 1), BUFFER_ALIGNMENT);
+		r.alignment = BUFFER_ALIGNMENT;
+		r.memoryTypeBits = ALL_MEMORY_TYPES;
+		return r;
+	}
+
+
+	VkMemoryRequirements image_requirements(VkImage image) {
+		VkMemoryRequirements r;
+		r.size = align(std::max<VkDeviceSize>(image_size(*fromHandle<Image>(image)), 1), IMAGE_ALIGNMENT);
+		r.alignment = IMAGE_ALIGNMENT;
+		r.memoryTypeBits = ALL_MEMORY_TYPES;
+		return r;
+	}
+
+
+	/** Dedicated allocations are never needed. */
+	void fill_requirements2(VkMemoryRequirements2* dst, const VkMemoryRequirements& requirements) {
+		dst->memoryRequirements = requirements;
+		for(auto* ext = static_cast<VkBaseOutStructure*>(dst->pNext); ext != nullptr; ext = ext->pNext) {
+			if(ext->sType == VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS) {
+				auto* dedicated = reinterpret_cast<VkMemoryDedicatedRequirements*>(ext);
+				dedicated->prefersDedicatedAllocation = VK_FALSE;
+				dedicated->requiresDedicatedAllocation = VK_FALSE;
+			}
+		}
+	}
+
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(
+			VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo,
+			const VkAllocationCallbacks*, VkDeviceMemory* pMemory
+	) {
+		auto* dev = fromHandle<Device>(device);
+		spinFor(dev->latencies.alloc);
+		auto* mem = new DeviceMemory(dev, pAllocateInfo->allocationSize);
+		if(mem->data == nullptr) {
+			delete mem;
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		}
+		auto& stats = dev->stats;
+		stats.allocations.fetch_add(1, std::memory_order_relaxed);
+		uint64_t allocated = stats.allocatedBytes.fetch_add(mem->size, std::memory_order_relaxed) + mem->size;
+		uint64_t peak = stats.peakAllocatedBytes.load(std::memory_order_relaxed);
+		while((allocated > peak) && ! stats.peakAllocatedBytes.compare_exchange_weak(peak, allocated, std::memory_order_relaxed)) { }
+		*pMemory = toHandle<VkDeviceMemory>(mem);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*) {
+		auto* mem = fromHandle<DeviceMemory>(memory);
+		if(mem == nullptr)  return;
+		mem->device->stats.allocatedBytes.fetch_sub(mem->size, std::memory_order_relaxed);
+		delete mem;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(
+			VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void** ppData
+	) {
+		*ppData = static_cast<char*>(fromHandle<DeviceMemory>(memory)->data) + offset;
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice, VkDeviceMemory) { }
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkFlushMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange*) {
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkInvalidateMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange*) {
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetDeviceMemoryCommitment(VkDevice, VkDeviceMemory memory, VkDeviceSize* pCommittedMemoryInBytes) {
+		*pCommittedMemoryInBytes = fromHandle<DeviceMemory>(memory)->size;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(
+			VkDevice device, const VkBufferCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkBuffer* pBuffer
+	) {
+		*pBuffer = toHandle<VkBuffer>(new Buffer(fromHandle<Device>(device), pCreateInfo->size));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*) {
+		delete fromHandle<Buffer>(buffer);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(
+			VkDevice device, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkImage* pImage
+	) {
+		*pImage = toHandle<VkImage>(new Image(fromHandle<Device>(device), *pCreateInfo));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*) {
+		delete fromHandle<Image>(image);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetImageSubresourceLayout(
+			VkDevice, VkImage image, const VkImageSubresource*, VkSubresourceLayout* pLayout
+	) {
+		const auto& img = *fromHandle<Image>(image);
+		pLayout->offset = 0;
+		pLayout->rowPitch = VkDeviceSize(img.extent.width) * texel_size(img.format);
+		pLayout->depthPitch = pLayout->rowPitch * img.extent.height;
+		pLayout->arrayPitch = pLayout->depthPitch * img.extent.depth;
+		pLayout->size = pLayout->arrayPitch;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice, VkBuffer buffer, VkMemoryRequirements* pMemoryRequirements) {
+		*pMemoryRequirements = buffer_requirements(buffer);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage image, VkMemoryRequirements* pMemoryRequirements) {
+		*pMemoryRequirements = image_requirements(image);
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements2(
+			VkDevice, const VkBufferMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements
+	) {
+		fill_requirements2(pMemoryRequirements, buffer_requirements(pInfo->buffer));
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements2(
+			VkDevice, const VkImageMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements
+	) {
+		fill_requirements2(pMemoryRequirements, image_requirements(pInfo->image));
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize) {
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize) {
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory2(VkDevice, uint32_t, const VkBindBufferMemoryInfo*) {
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory2(VkDevice, uint32_t, const VkBindImageMemoryInfo*) {
+		return VK_SUCCESS;
+	}
+
+
+	/* Objects that only need to exist, to be destroyed later. */
+	#define OBJECT_(TYPE_) \
+		VKAPI_ATTR VkResult VKAPI_CALL vkCreate##TYPE_( \
+				VkDevice device, const Vk##TYPE_##CreateInfo*, const VkAllocationCallbacks*, Vk##TYPE_* pHandle \
+		) { \
+			*pHandle = toHandle<Vk##TYPE_>(new Object(fromHandle<Device>(device), Kind::e##TYPE_)); \
+			return VK_SUCCESS; \
+		} \
+		VKAPI_ATTR void VKAPI_CALL vkDestroy##TYPE_(VkDevice, Vk##TYPE_ handle, const VkAllocationCallbacks*) { \
+			delete fromHandle<Object>(handle); \
+		}
+	//
+		OBJECT_(BufferView)
+		OBJECT_(ImageView)
+		OBJECT_(Sampler)
+		OBJECT_(ShaderModule)
+		OBJECT_(PipelineCache)
+		OBJECT_(PipelineLayout)
+		OBJECT_(DescriptorSetLayout)
+		OBJECT_(RenderPass)
+		OBJECT_(Framebuffer)
+		OBJECT_(Event)
+	#undef OBJECT_
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass2(
+			VkDevice device, const VkRenderPassCreateInfo2*, const VkAllocationCallbacks*, VkRenderPass* pRenderPass
+	) {
+		*pRenderPass = toHandle<VkRenderPass>(new Object(fromHandle<Device>(device), Kind::eRenderPass));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkGetEventStatus(VkDevice, VkEvent) { return VK_EVENT_RESET; }
+	VKAPI_ATTR VkResult VKAPI_CALL vkSetEvent(VkDevice, VkEvent) { return VK_SUCCESS; }
+	VKAPI_ATTR VkResult VKAPI_CALL vkResetEvent(VkDevice, VkEvent) { return VK_SUCCESS; }
+
+
+	/** The cache only holds the standard header, since there
+	 * is nothing to compile. */
+	VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(VkDevice device, VkPipelineCache, size_t* pDataSize, void* pData) {
+		struct Header {
+			uint32_t headerSize;
+			uint32_t headerVersion;
+			uint32_t vendorId;
+			uint32_t deviceId;
+			uint8_t uuid[VK_UUID_SIZE];
+		};
+		static_assert(sizeof(Header) == 32);
+		if(pData == nullptr) {
+			*pDataSize = sizeof(Header);
+			return VK_SUCCESS;
+		}
+		if(*pDataSize < sizeof(Header)) {
+			*pDataSize = 0;
+			return VK_INCOMPLETE;
+		}
+		Header header = { sizeof(Header), VK_PIPELINE_CACHE_HEADER_VERSION_ONE, 0, 0, { } };
+		std::memcpy(header.uuid, "vkapp2-nulldev-0", VK_UUID_SIZE);
+		std::memcpy(pData, &header, sizeof(Header));
+		*pDataSize = sizeof(Header);
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkMergePipelineCaches(VkDevice, VkPipelineCache, uint32_t, const VkPipelineCache*) {
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(
+			VkDevice device, VkPipelineCache, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo*,
+			const VkAllocationCallbacks*, VkPipeline* pPipelines
+	) {
+		for(uint32_t i=0; i < createInfoCount; ++i) {
+			pPipelines[i] = toHandle<VkPipeline>(new Object(fromHandle<Device>(device), Kind::ePipeline)); }
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(
+			VkDevice device, VkPipelineCache, uint32_t createInfoCount, const VkComputePipelineCreateInfo*,
+			const VkAllocationCallbacks*, VkPipeline* pPipelines
+	) {
+		for(uint32_t i=0; i < createInfoCount; ++i) {
+			pPipelines[i] = toHandle<VkPipeline>(new Object(fromHandle<Device>(device), Kind::ePipeline)); }
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyPipeline(VkDevice, VkPipeline pipeline, const VkAllocationCallbacks*) {
+		delete fromHandle<Object>(pipeline);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkCreateDescriptorPool(
+			VkDevice device, const VkDescriptorPoolCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks*, VkDescriptorPool* pDescriptorPool
+	) {
+		*pDescriptorPool = toHandle<VkDescriptorPool>(new DescriptorPool(fromHandle<Device>(device), pCreateInfo->maxSets));
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkDestroyDescriptorPool(VkDevice, VkDescriptorPool descriptorPool, const VkAllocationCallbacks*) {
+		delete fromHandle<DescriptorPool>(descriptorPool);
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkResetDescriptorPool(VkDevice, VkDescriptorPool descriptorPool, VkDescriptorPoolResetFlags) {
+		fromHandle<DescriptorPool>(descriptorPool)->sets.clear();
+		return VK_SUCCESS;
+	}
+
+
+	/** Fails like a real pool would, once `maxSets` sets are allocated. */
+	VKAPI_ATTR VkResult VKAPI_CALL vkAllocateDescriptorSets(
+			VkDevice, const VkDescriptorSetAllocateInfo* pAllocateInfo, VkDescriptorSet* pDescriptorSets
+	) {
+		auto* pool = fromHandle<DescriptorPool>(pAllocateInfo->descriptorPool);
+		if(pool->sets.size() + pAllocateInfo->descriptorSetCount > pool->maxSets) {
+			return VK_ERROR_OUT_OF_POOL_MEMORY; }
+		for(uint32_t i=0; i < pAllocateInfo->descriptorSetCount; ++i) {
+			auto& set = pool->sets.emplace_back(std::make_unique<DescriptorSet>(pool));
+			pDescriptorSets[i] = toHandle<VkDescriptorSet>(set.get());
+		}
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR VkResult VKAPI_CALL vkFreeDescriptorSets(
+			VkDevice, VkDescriptorPool descriptorPool, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets
+	) {
+		auto& sets = fromHandle<DescriptorPool>(descriptorPool)->sets;
+		for(uint32_t i=0; i < descriptorSetCount; ++i) {
+			auto* set = fromHandle<DescriptorSet>(pDescriptorSets[i]);
+			if(set == nullptr)  continue;
+			std::erase_if(sets, [set](const auto& s) { return s.get() == set; });
+		}
+		return VK_SUCCESS;
+	}
+
+
+	VKAPI_ATTR void VKAPI_CALL vkUpdateDescriptorSets(
+			VkDevice device,
+			uint32_t descriptorWriteCount, const VkWriteDescriptorSet* pDescriptorWrites,
+			uint32_t descriptorCopyCount, const VkCopyDescriptorSet* pDescriptorCopies
+	) {
+		uint64_t count = 0;
+		for(uint32_t i=0; i < descriptorWriteCount; ++i)  count += pDescriptorWrites[i].descriptorCount;
+		for(uint32_t i=0; i < descriptorCopyCount; ++i)   count += pDescriptorCopies[i].descriptorCount;
+		fromHandle<Device>(device)->stats.descriptorWrites.fetch_add(count, std::memory_order_relaxed);
+	}
+
+}
+
+
+
+namespace nulldev {
+
+	void addResourceProcs(ProcTable& procs) {
+		procs.insert({
+			NULLDEV_PROC_(vkAllocateMemory),
+			NULLDEV_PROC_(vkFreeMemory),
+			NULLDEV_PROC_(vkMapMemory),
+			NULLDEV_PROC_(vkUnmapMemory),
+			NULLDEV_PROC_(vkFlushMappedMemoryRanges),
+			NULLDEV_PROC_(vkInvalidateMappedMemoryRanges),
+			NULLDEV_PROC_(vkGetDeviceMemoryCommitment),
+			NULLDEV_PROC_(vkCreateBuffer),
+			NULLDEV_PROC_(vkDestroyBuffer),
+			NULLDEV_PROC_(vkCreateImage),
+			NULLDEV_PROC_(vkDestroyImage),
+			NULLDEV_PROC_(vkGetImageSubresourceLayout),
+			NULLDEV_PROC_(vkGetBufferMemoryRequirements),
+			NULLDEV_PROC_(vkGetImageMemoryRequirements),
+			NULLDEV_PROC_(vkGetBufferMemoryRequirements2),
+			NULLDEV_PROC_(vkGetImageMemoryRequirements2),
+			NULLDEV_PROC_(vkBindBufferMemory),
+			NULLDEV_PROC_(vkBindImageMemory),
+			NULLDEV_PROC_(vkBindBufferMemory2),
+			NULLDEV_PROC_(vkBindImageMemory2),
+			NULLDEV_PROC_(vkCreateBufferView),
+			NULLDEV_PROC_(vkDestroyBufferView),
+			NULLDEV_PROC_(vkCreateImageView),
+			NULLDEV_PROC_(vkDestroyImageView),
+			NULLDEV_PROC_(vkCreateSampler),
+			NULLDEV_PROC_(vkDestroySampler),
+			NULLDEV_PROC_(vkCreateShaderModule),
+			NULLDEV_PROC_(vkDestroyShaderModule),
+			NULLDEV_PROC_(vkCreatePipelineCache),
+			NULLDEV_PROC_(vkDestroyPipelineCache),
+			NULLDEV_PROC_(vkGetPipelineCacheData),
+			NULLDEV_PROC_(vkMergePipelineCaches),
+			NULLDEV_PROC_(vkCreatePipelineLayout),
+			NULLDEV_PROC_(vkDestroyPipelineLayout),
+			NULLDEV_PROC_(vkCreateGraphicsPipelines),
+			NULLDEV_PROC_(vkCreateComputePipelines),
+			NULLDEV_PROC_(vkDestroyPipeline),
+			NULLDEV_PROC_(vkCreateDescriptorSetLayout),
+			NULLDEV_PROC_(vkDestroyDescriptorSetLayout),
+			NULLDEV_PROC_(vkCreateDescriptorPool),
+			NULLDEV_PROC_(vkDestroyDescriptorPool),
+			NULLDEV_PROC_(vkResetDescriptorPool),
+			NULLDEV_PROC_(vkAllocateDescriptorSets),
+			NULLDEV_PROC_(vkFreeDescriptorSets),
+			NULLDEV_PROC_(vkUpdateDescriptorSets),
+			NULLDEV_PROC_(vkCreateRenderPass),
+			NULLDEV_PROC_(vkCreateRenderPass2),
+			NULLDEV_PROC_(vkDestroyRenderPass),
+			NULLDEV_PROC_(vkCreateFramebuffer),
+			NULLDEV_PROC_(vkDestroyFramebuffer),
+			NULLDEV_PROC_(vkCreateEvent),
+			NULLDEV_PROC_(vkDestroyEvent),
+			NULLDEV_PROC_(vkGetEventStatus),
+			NULLDEV_PROC_(vkSetEvent),
+			NULLDEV_PROC_(vkResetEvent) });
+	}
+
+}
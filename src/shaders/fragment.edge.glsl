@@ -0,0 +1,137 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+
+/* Screen space outlines: a fragment is part of an outline if one of its
+ * neighbors is closer to the view by more than `outlineDepth`, the same
+ * way an extruded back face would peek out from behind an object.
+ *
+ * Compiled twice, with and without MULTISAMPLED defined, since multisampled
+ * depth attachments have to be read through a different sampler type. */
+
+
+
+layout(set = 0, binding = 0) uniform StaticUbo {
+	mat4 proj;
+	float outlineSize;
+	float outlineDepth;
+	float outlineRnd;
+} staticUbo;
+
+#ifdef MULTISAMPLED
+	layout(set = 0, binding = 2) uniform sampler2DMS depthTex;
+#else
+	layout(set = 0, binding = 2) uniform sampler2D depthTex;
+#endif
+
+layout(set = 2, binding = 0) uniform FrameUbo {
+	mat4 view;
+	vec3 viewPos;
+	vec4 pointLight;
+	vec3 lightDirection;
+	float rnd;
+	uint pack0; // shaderSelector : 0xff00
+} frameUbo;
+
+
+
+layout(location = 0) out vec4 out_col;
+
+
+
+const float MAX_RADIUS = 8.0; // Pixels
+
+
+
+ivec2 depth_size() {
+	#ifdef MULTISAMPLED
+		return textureSize(depthTex);
+	#else
+		return textureSize(depthTex, 0);
+	#endif
+}
+
+
+/* Distance from the view, in world units, of the fragment
+ * with the given depth value. */
+float linear_depth(float depth) {
+	mat4 p = staticUbo.proj;
+	return abs((p[3][2] - (depth * p[3][3])) / ((depth * p[2][3]) - p[2][2]));
+}
+
+
+float rd_depth(ivec2 texel) {
+	texel = clamp(texel, ivec2(0), depth_size() - 1);
+	#ifdef MULTISAMPLED
+		return linear_depth(texelFetch(depthTex, texel, gl_SampleID).r);
+	#else
+		return linear_depth(texelFetch(depthTex, texel, 0).r);
+	#endif
+}
+
+
+
+void main_0() {
+	discard;
+}
+
+void main_1() {
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float center = rd_depth(texel);
+	// `outlineDepth` is premultiplied by zNear, which is where depth 0 lies
+	float gap = staticUbo.outlineDepth / linear_depth(0.0);
+	// Outlines are as thick as `outlineSize` world units would be, at the fragment's distance
+	float radius = clamp(
+		staticUbo.outlineSize * abs(staticUbo.proj[1][1]) * float(depth_size().y) / center,
+		1.0, MAX_RADIUS);
+	int r = int(radius);
+	float nearest = min(
+		min(rd_depth(texel + ivec2(r, 0)), rd_depth(texel - ivec2(r, 0))),
+		min(rd_depth(texel + ivec2(0, r)), rd_depth(texel - ivec2(0, r))) );
+	if(center - nearest > gap) {
+		out_col = vec4(0,0,0, 1);
+	} else {
+		discard;
+	}
+}
+
+
+
+void main() {
+	switch(frameUbo.pack0 >> 16) {
+		case 0:
+		case 1:  main_0();  break;
+		case 2:  main_1();  break;
+		case 3:  main_0();  break;
+		case 4:  main_1();  break;
+		case 5:  main_0();  break;
+		case 6:
+		default:  main_1();  break;
+	}
+}
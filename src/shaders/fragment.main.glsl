@@ -52,6 +52,25 @@ layout(set = 2, binding = 0) uniform FrameUbo {
 	uint pack0; // shaderSelector : 0xff00
 } frameUbo;
 
+struct Material {
+	float ambient;
+	float diffuse;
+	float specular;
+	float shininess;
+	float rnd;
+	uint celLevels;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer MaterialTable {
+	Material entries[];
+} materialTable;
+
+layout(push_constant) uniform ObjectConst {
+	uint instanceIndex;
+	uint materialIndex; // 0xffffffff: use the model UBO
+	float lodBias;
+} objConst;
+
 layout(set = 1, binding = 1) uniform sampler2D tex_dfsSampler;
 layout(set = 1, binding = 2) uniform sampler2D tex_spcSampler;
 layout(set = 1, binding = 3) uniform sampler2D tex_nrmSampler;
@@ -67,6 +86,8 @@ layout(location = 8) in mat3 frg_tbnInverse;
 
 layout(location = 0) out vec4 out_col;
 
+Material material; // Either from the material table or from the model UBO, see main()
+
 
 
 struct PointLightInfo {
@@ -95,10 +116,10 @@ float shave(float value, float stride, float bias) {
 
 float celShade(float lightLevel) {
 	float r = lightLevel;
-	float noCelShading = float(modelUbo.celLevels < 1);
-	// (modelUbo.celLevels + noCelShading) has no tangible effect, but prevents division by zero
+	float noCelShading = float(material.celLevels < 1);
+	// (material.celLevels + noCelShading) has no tangible effect, but prevents division by zero
 	r =
-		(1-noCelShading) * shave(r, 1.0 / float(modelUbo.celLevels + noCelShading), 0.5) +
+		(1-noCelShading) * shave(r, 1.0 / float(material.celLevels + noCelShading), 0.5) +
 		noCelShading * r;
 	return r;
 }
@@ -118,7 +139,7 @@ vec3 rnd_f3(vec3 seed) {
 
 vec3 get_normal_tanspace() {
 	return (
-		texture(tex_nrmSampler, frg_tex).rgb
+		texture(tex_nrmSampler, frg_tex, objConst.lodBias).rgb
 		- 0.5
 	) * 2.0;
 }
@@ -137,7 +158,7 @@ float rayDiffusion(vec3 lightDirTan, vec3 nrmTan) {
 	float r;
 	r = dot(-lightDirTan, nrmTan);
 	r = max(0, r);
-	r = unnormalize(modelUbo.ambient, modelUbo.diffuse, r);
+	r = unnormalize(material.ambient, material.diffuse, r);
 	r = max(0, r);
 	return r;
 }
@@ -153,8 +174,8 @@ float raySpecular(vec3 lightDirTan, vec3 nrmTan) {
 	float r;
 	r = dot(-viewDir, reflectDir);
 	r = max(0, r);
-	r = pow(r, modelUbo.shininess);
-	r = r * modelUbo.specular;
+	r = pow(r, material.shininess);
+	r = r * material.specular;
 	r = max(0, r);
 	return r;
 }
@@ -180,8 +201,8 @@ void main_0() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -207,8 +228,8 @@ void main_1() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -238,8 +259,8 @@ void main_2() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -265,8 +286,8 @@ void main_3() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -296,8 +317,8 @@ void main_4() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -325,8 +346,8 @@ void main_5() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -358,8 +379,8 @@ void main_6() {
 
 	// Compute the color output
 	out_col.rgb =
-		(texture(tex_dfsSampler, frg_tex).xyz * diffuse) +
-		(texture(tex_spcSampler, frg_tex).xyz * specular);
+		(texture(tex_dfsSampler, frg_tex, objConst.lodBias).xyz * diffuse) +
+		(texture(tex_spcSampler, frg_tex, objConst.lodBias).xyz * specular);
 	out_col.a = 1;
 	out_col *= frg_col;
 
@@ -380,6 +401,14 @@ void main_6() {
  * 5: Diffuse and specular lighting
  * 6: Diffuse and specular lighting with cel shading and outline */
 void main() {
+	if(objConst.materialIndex == 0xffffffff) {
+		material = Material(
+			modelUbo.ambient, modelUbo.diffuse, modelUbo.specular,
+			modelUbo.shininess, modelUbo.rnd, modelUbo.celLevels);
+	} else {
+		material = materialTable.entries[objConst.materialIndex];
+	}
+
 	switch(frameUbo.pack0 >> 16) {
 		case 0:  main_0();  break;
 		case 1:  main_1();  break;
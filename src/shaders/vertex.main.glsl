@@ -52,6 +52,12 @@ layout(set = 2, binding = 0) uniform FrameUbo {
 	uint pack0; // shaderSelector : 0xff00
 } frameUbo;
 
+layout(push_constant) uniform ObjectConst {
+	uint instanceIndex;
+	uint materialIndex; // 0xffffffff: use the model UBO
+	float lodBias;
+} objConst;
+
 
 
 layout(location = 0) in vec3 in_pos;
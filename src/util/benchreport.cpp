@@ -0,0 +1,152 @@
+#include "benchreport.hpp"
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+
+namespace {
+
+	using Stats = util::BenchReport::Stats;
+
+	constexpr const char* CSV_HEADER = "id,count,min,mean,stddev,p50,p95,p99,max";
+
+
+	Stats mk_stats(const perf::PerfTracker::Record& rec) {
+		const auto& hist = rec.histogram;
+		Stats r;
+		r.id = rec.id;
+		r.count = hist.count();
+		r.min = static_cast<double>(hist.min());
+		r.max = static_cast<double>(hist.max());
+		r.mean = hist.mean();
+		r.stdDev = hist.stdDev();
+		r.p50 = static_cast<double>(hist.percentile(0.50));
+		r.p95 = static_cast<double>(hist.percentile(0.95));
+		r.p99 = static_cast<double>(hist.percentile(0.99));
+		return r;
+	}
+
+
+	bool ends_with(const std::string& str, const std::string& suffix) {
+		return
+			(str.size() >= suffix.size()) &&
+			(0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix));
+	}
+
+}
+
+
+
+namespace util {
+
+	BenchReport BenchReport::fromTracker(const perf::PerfTracker& tracker, unsigned long frames) {
+		BenchReport r;
+		r.frames = frames;
+		for(const auto& rec : tracker.records()) {
+			if(rec.histogram.count() > 0)  r.stats.push_back(mk_stats(rec)); }
+		std::sort(r.stats.begin(), r.stats.end(),
+			[](const Stats& a, const Stats& b) { return a.id < b.id; });
+		return r;
+	}
+
+
+	BenchReport BenchReport::readCsv(std::istream& in) {
+		BenchReport r;
+		r.frames = 0;
+		std::string line;
+		if((! std::getline(in, line)) || (line.rfind("# frames=", 0) != 0)) {
+			throw std::runtime_error("benchmark report: missing frame count"); }
+		r.frames = std::stoul(line.substr(9));
+		if((! std::getline(in, line)) || (line != CSV_HEADER)) {
+			throw std::runtime_error("benchmark report: unexpected CSV header"); }
+		while(std::getline(in, line)) {
+			if(line.empty())  continue;
+			std::istringstream row = std::istringstream(line);
+			Stats st;
+			char sep[7];
+			std::getline(row, st.id, ',');
+			row >> st.count >> sep[0] >> st.min >> sep[1] >> st.mean >> sep[2] >> st.stdDev >> sep[3]
+				>> st.p50 >> sep[4] >> st.p95 >> sep[5] >> st.p99 >> sep[6] >> st.max;
+			if((! row) || ! std::all_of(sep, sep+7, [](char c) { return c == ','; })) {
+				throw std::runtime_error("benchmark report: malformed row \"" + line + "\""); }
+			r.stats.push_back(std::move(st));
+		}
+		return r;
+	}
+
+
+	BenchReport BenchReport::fromFile(const std::string& path) {
+		std::ifstream in = std::ifstream(path);
+		if(! in) {
+			throw std::runtime_error("failed to open the benchmark report \"" + path + "\""); }
+		return readCsv(in);
+	}
+
+
+	void BenchReport::writeCsv(std::ostream& out) const {
+		out << "# frames=" << frames << '\n' << CSV_HEADER << '\n';
+		for(const auto& st : stats) {
+			out << st.id << ',' << st.count << ',' << st.min << ',' << st.mean << ',' << st.stdDev << ','
+				<< st.p50 << ',' << st.p95 << ',' << st.p99 << ',' << st.max << '\n';
+		}
+	}
+
+
+	void BenchReport::writeJson(std::ostream& out) const {
+		out << "{\n\t\"frames\": " << frames << ",\n\t\"records\": [";
+		for(size_t i=0; i < stats.size(); ++i) {
+			const auto& st = stats[i];
+			out << ((i == 0)? "\n" : ",\n") << "\t\t{ \"id\": ";
+			write_json_str(out, st.id); // Scope paths and string timers may contain anything
+			out << ", \"count\": " << st.count
+				<< ", \"min\": " << st.min << ", \"mean\": " << st.mean << ", \"stddev\": " << st.stdDev
+				<< ", \"p50\": " << st.p50 << ", \"p95\": " << st.p95
+				<< ", \"p99\": " << st.p99 << ", \"max\": " << st.max << " }";
+		}
+		out << "\n\t]\n}\n";
+	}
+
+
+	void BenchReport::writeFile(const std::string& path) const {
+		std::ofstream out = std::ofstream(path, std::ios::trunc);
+		out.precision(12);
+		if(ends_with(path, ".json")) {
+			writeJson(out);
+		} else {
+			writeCsv(out);
+		}
+		if(! out) {
+			throw std::runtime_error("failed to write the benchmark report \"" + path + "\""); }
+	}
+
+
+	std::vector<BenchReport::Regression> BenchReport::compare(
+			const BenchReport& baseline, double tolerance
+	) const {
+		std::vector<Regression> r;
+		for(const auto& base : baseline.stats) {
+			auto found = std::find_if(stats.begin(), stats.end(),
+				[&base](const Stats& st) { return st.id == base.id; });
+			if(found == stats.end()) {
+				// Renamed, removed or compiled out: the baseline can't vouch for it anymore
+				r.push_back(Regression { base.id, "count", double(base.count), 0.0 });
+				continue;
+			}
+			const auto check = [&](const char* name, double Stats::* stat) {
+				if((*found).*stat > (base.*stat * (1.0 + tolerance))) {
+					r.push_back(Regression { base.id, name, base.*stat, (*found).*stat }); }
+			};
+			check("mean", &Stats::mean);
+			check("p95", &Stats::p95);
+			check("p99", &Stats::p99);
+		}
+		return r;
+	}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "perftracker.hpp"
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+
+
+namespace util {
+
+	/** Summarizes the samples of every record of a PerfTracker, in a
+	 * form that can be written to a file and compared against a
+	 * previously written one.
+	 *
+	 * Values have the same unit as the records: nanoseconds for
+	 * timers, whatever is counted for the others. */
+	struct BenchReport {
+		struct Stats {
+			std::string id;
+			size_t count;
+			double min, mean, stdDev, p50, p95, p99, max; // Percentiles are approximated, see perf::Histogram
+		};
+
+		/** A statistic that has grown beyond the tolerated ratio. */
+		struct Regression {
+			std::string id;
+			const char* stat;
+			double baseline, current;
+		};
+
+		unsigned long frames;
+		std::vector<Stats> stats; // Sorted by ID
+
+		/** Records without samples are skipped. */
+		static BenchReport fromTracker(const perf::PerfTracker&, unsigned long frames);
+
+		/** Only CSV reports can be read, since writing JSON is meant
+		 * for external tools. */
+		static BenchReport readCsv(std::istream&);
+		static BenchReport fromFile(const std::string& path);
+
+		void writeCsv(std::ostream&) const;
+		void writeJson(std::ostream&) const;
+
+		/** Writes the report as JSON if the path ends with ".json",
+		 * as CSV otherwise. */
+		void writeFile(const std::string& path) const;
+
+		/** Compares the mean, p95 and p99 of each record with the ones
+		 * in the baseline. A baseline record that is missing from this
+		 * report is a regression of its "count" down to 0; records that
+		 * are only in this report are ignored.
+		 * @param tolerance How much a statistic may grow, relative to
+		 * the baseline, before being considered a regression. */
+		std::vector<Regression> compare(const BenchReport& baseline, double tolerance) const;
+	};
+
+}
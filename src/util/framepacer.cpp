@@ -0,0 +1,149 @@
+#include "framepacer.hpp"
+
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+
+
+namespace {
+
+	using ns_t = util::FramePacer::ns_t;
+	using clock = std::chrono::steady_clock;
+
+	/* Estimates are kept as a moving average and a moving mean
+	 * deviation, the same way TCP estimates round trip times:
+	 * the expected value is `avg + (DEV_MUL * dev)`. */
+	constexpr double AVG_GAIN = 1.0 / 8.0;
+	constexpr double DEV_GAIN = 1.0 / 4.0;
+	constexpr double DEV_MUL = 4.0;
+
+
+	ns_t now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			clock::now().time_since_epoch()
+		).count();
+	}
+
+
+	void update_estimate(double& avg, double& dev, double sample) {
+		dev += DEV_GAIN * (std::abs(sample - avg) - dev);
+		avg += AVG_GAIN * (sample - avg);
+	}
+
+
+	ns_t get_estimate(double avg, double dev, ns_t max) {
+		return std::clamp<ns_t>(avg + (DEV_MUL * dev), 0, max);
+	}
+
+}
+
+
+
+namespace util {
+
+	FramePacer::FramePacer(double frameTimeS, Mode mode):
+			_frame_time(frameTimeS * 1'000'000'000.0),
+			_target(-1),
+			_last_begin(-1),
+			_work_begin(-1),
+			_overshoot_avg(0.0),
+			_overshoot_dev(0.0),
+			_work_avg(0.0),
+			_work_dev(0.0),
+			_mode(mode)
+	{
+		resetJitter();
+	}
+
+
+	FramePacer::ns_t FramePacer::waitForFrame() {
+		ns_t now = now_ns();
+		ns_t begin;
+		if(_target < 0) {
+			// First frame: nothing to wait for
+			_target = (_mode == Mode::eDeadline)? now + _frame_time : now;
+			begin = now;
+		} else {
+			ns_t wakeAt = _target;
+			if(_mode == Mode::eDeadline) {
+				wakeAt -= get_estimate(_work_avg, _work_dev, _frame_time); }
+			if(now > wakeAt + _frame_time) {
+				// More than one frame late: catching up would just cause a burst of frames
+				_target += now - wakeAt;
+				wakeAt = now;
+			}
+			_wait_until(wakeAt);
+			begin = now_ns();
+		}
+		if(_last_begin >= 0) {
+			// Welford's online variance
+			double error = static_cast<double>((begin - _last_begin) - _frame_time);
+			++ _jitter_count;
+			double delta = error - _jitter_mean;
+			_jitter_mean += delta / static_cast<double>(_jitter_count);
+			_jitter_m2 += delta * (error - _jitter_mean);
+			_jitter_max = std::max(_jitter_max, std::abs(error));
+		}
+		_target += _frame_time;
+		_last_begin = begin;
+		_work_begin = begin;
+		return begin - now;
+	}
+
+
+	void FramePacer::endFrame() {
+		if(_work_begin < 0) return;
+		update_estimate(_work_avg, _work_dev, now_ns() - _work_begin);
+		_work_begin = -1;
+	}
+
+
+	FramePacer::JitterStats FramePacer::jitter() const {
+		JitterStats r;
+		r.frames = _jitter_count;
+		r.meanErrorNs = _jitter_mean;
+		r.stdDevNs = (_jitter_count > 1)?
+			std::sqrt(_jitter_m2 / static_cast<double>(_jitter_count - 1)) :
+			0.0;
+		r.maxErrorNs = _jitter_max;
+		r.sleepOvershootNs = get_estimate(_overshoot_avg, _overshoot_dev, MAX_OVERSHOOT_NS);
+		r.frameWorkNs = get_estimate(_work_avg, _work_dev, _frame_time);
+		return r;
+	}
+
+
+	void FramePacer::resetJitter() {
+		_jitter_count = 0;
+		_jitter_mean = 0.0;
+		_jitter_m2 = 0.0;
+		_jitter_max = 0.0;
+	}
+
+
+	void FramePacer::_wait_until(ns_t t) {
+		ns_t now = now_ns();
+		if(_mode == Mode::eSleep) {
+			if(t > now) {
+				std::this_thread::sleep_for(std::chrono::nanoseconds(t - now)); }
+			return;
+		}
+		{ // Sleep for as long as the scheduler can be trusted
+			ns_t overshoot = get_estimate(_overshoot_avg, _overshoot_dev, MAX_OVERSHOOT_NS);
+			ns_t request = (t - now) - overshoot;
+			while(request >= MIN_SLEEP_NS) {
+				std::this_thread::sleep_for(std::chrono::nanoseconds(request));
+				ns_t slept = now_ns() - now;
+				update_estimate(_overshoot_avg, _overshoot_dev, slept - request);
+				now += slept;
+				overshoot = get_estimate(_overshoot_avg, _overshoot_dev, MAX_OVERSHOOT_NS);
+				request = (t - now) - overshoot;
+			}
+		} { // Spin for the rest
+			while(now < t) {
+				now = now_ns(); }
+		}
+	}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+
+namespace util {
+
+	/** Throttles a loop to a fixed frequency, and keeps track of
+	 * how closely the actual frequency follows the intended one.
+	 *
+	 * `waitForFrame` is to be called at the beginning of every iteration,
+	 * `endFrame` after the iteration's work has been submitted: the
+	 * latter is only used to estimate how long a frame takes to be
+	 * prepared, which is relevant to the eDeadline mode. */
+	class FramePacer {
+	public:
+		using ns_t = std::int64_t;
+
+		enum class Mode {
+			/** Sleep for the whole remaining time: cheap, but the
+			 * scheduler may wake the thread up much later than requested. */
+			eSleep,
+			/** Sleep until shortly before the next frame is due, then
+			 * spin for the remaining time; how early the sleep ends is
+			 * based on how much previous sleeps overshot their target. */
+			eHybrid,
+			/** Like eHybrid, but frames begin as late as the estimated
+			 * frame work allows in order to be ready on time, so that
+			 * input is sampled closer to the moment it's displayed. */
+			eDeadline
+		};
+
+		struct JitterStats {
+			size_t frames;
+			double meanErrorNs; // Mean difference between the actual and the intended frame interval
+			double stdDevNs; // Standard deviation of the frame interval
+			double maxErrorNs; // Largest absolute difference between the actual and the intended frame interval
+			double sleepOvershootNs; // How much sleeps are currently expected to overshoot their target
+			double frameWorkNs; // How long frames are currently expected to take, without waiting
+		};
+
+		/* Sleeps shorter than this are not worth a context switch,
+		 * and are replaced by spinning. */
+		static constexpr ns_t MIN_SLEEP_NS = 100'000;
+
+		/* Upper bound for the estimated sleep overshoot, so that a
+		 * single preempted sleep cannot turn the pacer into a spinlock. */
+		static constexpr ns_t MAX_OVERSHOOT_NS = 4'000'000;
+
+		FramePacer(double frameTimeS, Mode);
+
+		/** Waits until the next frame is due; if the previous frame
+		 * took so long that the next one is already late, the schedule
+		 * is shifted instead of rushing the following frames.
+		 * @returns How many nanoseconds the thread has waited. */
+		ns_t waitForFrame();
+
+		/** Marks the end of the work for the current frame. */
+		void endFrame();
+
+		JitterStats jitter() const;
+		void resetJitter();
+
+		double frameTimeS() const { return static_cast<double>(_frame_time) / 1'000'000'000.0; }
+		Mode mode() const { return _mode; }
+
+	private:
+		void _wait_until(ns_t);
+
+		ns_t _frame_time;
+		ns_t _target; // When the next frame is due to begin, or to end with Mode::eDeadline
+		ns_t _last_begin;
+		ns_t _work_begin;
+		double _overshoot_avg;
+		double _overshoot_dev;
+		double _work_avg;
+		double _work_dev;
+		size_t _jitter_count;
+		double _jitter_mean;
+		double _jitter_m2;
+		double _jitter_max;
+		Mode _mode;
+	};
+
+}
@@ -0,0 +1,148 @@
+#include "perfcollector.hpp"
+
+#include <cassert>
+#include <string>
+#include <algorithm>
+
+
+
+namespace perf {
+
+	ThreadTracker::Scope::Scope(ThreadTracker& tracker, const TimerId& id):
+			tracker_(tracker),
+			state_(tracker.startTimer(tracker.scopedId_(id)))
+	{
+		tracker_.scopes_.push_back(state_.timerId);
+	}
+
+
+	ThreadTracker::Scope::~Scope() {
+		assert(! tracker_.scopes_.empty());
+		assert(tracker_.scopes_.back().index == state_.timerId.index); // Scopes must be destroyed in LIFO order
+		tracker_.scopes_.pop_back();
+		tracker_.stopTimer(state_);
+	}
+
+
+	ThreadTracker::ThreadTracker(Collector& collector):
+			collector_(collector),
+			epoch_(collector.epoch_),
+			resets_(collector.resets_),
+			pendingResets_(0),
+			pendingFull_(false)
+	{
+		collector_.register_(*this); // Also initializes `seenEpoch_` and `seenResets_`
+	}
+
+
+	ThreadTracker::~ThreadTracker() {
+		collector_.unregister_(*this);
+	}
+
+
+	void ThreadTracker::publish() {
+		seenEpoch_ = epoch_.load(std::memory_order_acquire);
+		uint64_t resets = resets_.load(std::memory_order_acquire);
+		if(resets != seenResets_) {
+			// Recorded before the collector was reset, or in flight across the reset
+			active_.reset();
+			seenResets_ = resets;
+			return;
+		}
+		if(active_.records().empty())  return;
+		if(pendingFull_.load(std::memory_order_acquire))  return; // Not collected yet, try again next epoch
+		std::swap(active_, pending_); // The collector leaves `pending_` empty
+		pendingResets_ = seenResets_;
+		pendingFull_.store(true, std::memory_order_release);
+	}
+
+
+	const TimerId& ThreadTracker::scopedId_(const TimerId& child) {
+		if(scopes_.empty())  return child;
+		const TimerId& parent = scopes_.back();
+		uint64_t key = (uint64_t(parent.index) << 32) | child.index;
+		auto found = scopedIds_.find(key);
+		if(found == scopedIds_.end()) {
+			// Only the first occurrence of each path takes the interning lock
+			std::string path = std::string(parent.name) + '/' + child.name;
+			found = scopedIds_.emplace(key, TimerId::intern(path.c_str())).first;
+		}
+		return found->second;
+	}
+
+
+
+	Collector::~Collector() {
+		assert(threads_.empty()); // Every thread must exit before its collector is destroyed
+	}
+
+
+	const PerfTracker& Collector::collect() {
+		auto lock = std::unique_lock(mutex_);
+		uint64_t resets = resets_.load(std::memory_order_relaxed);
+		for(auto* thread : threads_) {
+			if(thread->pendingFull_.load(std::memory_order_acquire)) {
+				// A thread may hand over records it took before the last reset, if it hasn't seen it yet
+				if(thread->pendingResets_ == resets) {
+					merged_ |= thread->pending_; }
+				thread->pending_.reset();
+				thread->pendingFull_.store(false, std::memory_order_release);
+			}
+		}
+		merged_ |= retired_;
+		retired_.reset();
+		epoch_.fetch_add(1, std::memory_order_release);
+		return merged_;
+	}
+
+
+	void Collector::reset() {
+		auto lock = std::unique_lock(mutex_);
+		resets_.fetch_add(1, std::memory_order_release);
+		epoch_.fetch_add(1, std::memory_order_release); // Makes threads look at `resets_` on their next sample
+		for(auto* thread : threads_) {
+			if(thread->pendingFull_.load(std::memory_order_acquire)) {
+				thread->pending_.reset();
+				thread->pendingFull_.store(false, std::memory_order_release);
+			}
+		}
+		retired_.reset();
+		merged_.reset();
+	}
+
+
+	void Collector::register_(ThreadTracker& thread) {
+		auto lock = std::unique_lock(mutex_);
+		thread.seenEpoch_ = epoch_.load(std::memory_order_relaxed);
+		thread.seenResets_ = resets_.load(std::memory_order_relaxed);
+		threads_.push_back(&thread);
+	}
+
+
+	void Collector::unregister_(ThreadTracker& thread) {
+		auto lock = std::unique_lock(mutex_);
+		auto found = std::find(threads_.begin(), threads_.end(), &thread);
+		assert(found != threads_.end());
+		threads_.erase(found);
+		// The thread is exiting, so nothing else touches its trackers
+		uint64_t resets = resets_.load(std::memory_order_relaxed);
+		if(thread.pendingFull_.load(std::memory_order_acquire) && (thread.pendingResets_ == resets)) {
+			retired_ |= thread.pending_; }
+		if(thread.seenResets_ == resets) {
+			retired_ |= thread.active_; }
+	}
+
+
+
+	Collector& collector() {
+		static Collector r;
+		return r;
+	}
+
+
+	ThreadTracker& threadTracker() {
+		thread_local ThreadTracker r = ThreadTracker(collector());
+		return r;
+	}
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "perftracker.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+
+
+namespace perf {
+
+	class Collector;
+
+
+	/** A PerfTracker that belongs to a single thread, and that hands
+	 * its records over to a Collector without ever taking a lock.
+	 *
+	 * Samples are recorded into a thread-private tracker; after a sample
+	 * is recorded, if the collector has started a new epoch and the
+	 * hand-off slot is empty, the private tracker is swapped with it.
+	 * The collector empties the slot and marks it as such, so each side
+	 * only touches the slot while the other one can't.
+	 *
+	 * The check happens after the sample is taken, so that it's never
+	 * timed. When it finds that the collector has been reset, every
+	 * record the thread holds is discarded, including the sample that
+	 * was in flight across the reset, rather than mixed with the
+	 * ones that follow.
+	 *
+	 * Scopes are recorded hierarchically: a scope opened while another
+	 * one is open is recorded as "<parent>/<child>". */
+	class ThreadTracker {
+	public:
+		using utime_t = PerfTracker::utime_t;
+		using State = PerfTracker::State;
+
+		/** Times the lifetime of the object, within the scope
+		 * that is currently open on the same thread. */
+		class Scope {
+		public:
+			Scope(ThreadTracker&, const TimerId&);
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			ThreadTracker& tracker_;
+			State state_;
+		};
+
+		ThreadTracker(Collector&);
+		~ThreadTracker();
+
+		ThreadTracker(const ThreadTracker&) = delete;
+		ThreadTracker& operator=(const ThreadTracker&) = delete;
+
+		State startTimer(const TimerId& id) { return active_.startTimer(id); }
+		utime_t stopTimer(State& state) { auto r = active_.stopTimer(state);  tryPublish_();  return r; }
+		void record(const TimerId& id, utime_t value) { active_.record(id, value);  tryPublish_(); }
+
+		template<typename fn_t, typename... args_t>
+		void measure(const TimerId& id, fn_t fn, args_t... args) {
+			auto timer = startTimer(id);
+			fn(args...);
+			stopTimer(timer);
+		}
+
+		/** Hands the records over to the collector, if it has already
+		 * taken the previous ones; useful before a thread goes idle. */
+		void publish();
+
+	private:
+		friend Collector;
+
+		/** The ID of `child` within the innermost open scope. */
+		const TimerId& scopedId_(const TimerId& child);
+
+		void tryPublish_() {
+			if(epoch_.load(std::memory_order_relaxed) != seenEpoch_)  publish();
+		}
+
+		Collector& collector_;
+		const std::atomic<uint64_t>& epoch_;
+		const std::atomic<uint64_t>& resets_;
+		uint64_t seenEpoch_;
+		uint64_t seenResets_;
+		PerfTracker active_;
+		PerfTracker pending_; // Only accessed by the collector while `pendingFull_` is set
+		uint64_t pendingResets_; // The value of `seenResets_` when `pending_` was handed over
+		std::atomic<bool> pendingFull_;
+		std::vector<TimerId> scopes_;
+		std::unordered_map<uint64_t, TimerId> scopedIds_; // (parent << 32) | child -> "<parent>/<child>"
+	};
+
+
+	/** Merges the records of every ThreadTracker registered with it.
+	 *
+	 * Collecting only takes the registry lock, which threads contend
+	 * for when they start and exit - never while recording. */
+	class Collector {
+	public:
+		Collector() = default;
+		~Collector();
+
+		Collector(const Collector&) = delete;
+		Collector& operator=(const Collector&) = delete;
+
+		/** Merges every record handed over since the last call, then
+		 * starts a new epoch, which asks the threads to hand over their
+		 * records as soon as they record a sample. */
+		const PerfTracker& collect();
+
+		/** Discards the merged records, and any record that has been
+		 * handed over but not collected yet; threads discard the records
+		 * they still hold when they record their next sample. */
+		void reset();
+
+		/** The records merged so far; only safe to access from the thread
+		 * that calls `collect` and `reset`. */
+		const PerfTracker& records() const noexcept { return merged_; }
+
+	private:
+		friend ThreadTracker;
+
+		void register_(ThreadTracker&);
+		void unregister_(ThreadTracker&); // Moves the thread's remaining records to `retired_`
+
+		std::mutex mutex_;
+		std::vector<ThreadTracker*> threads_;
+		std::atomic<uint64_t> epoch_ = 0;
+		std::atomic<uint64_t> resets_ = 0; // Only modified while `mutex_` is held
+		PerfTracker retired_; // Records of exited threads, merged on the next collection
+		PerfTracker merged_;
+	};
+
+
+	/** The collector used by `threadTracker()`. */
+	Collector& collector();
+
+	/** The calling thread's tracker, registered with `collector()`
+	 * the first time it is used. */
+	ThreadTracker& threadTracker();
+
+}
+
+
+
+#ifdef ENABLE_PERF_TRACKER
+	#define PERF_SCOPE_CAT_2_(A_, B_) A_ ## B_
+	#define PERF_SCOPE_CAT_(A_, B_) PERF_SCOPE_CAT_2_(A_, B_)
+	/** Times the rest of the enclosing C++ scope on the calling thread's tracker. */
+	#define PERF_SCOPE(NAME_) ::perf::ThreadTracker::Scope PERF_SCOPE_CAT_(perfScope_, __LINE__) ( \
+		::perf::threadTracker(), PERF_ID(NAME_) );
+#else
+	#define PERF_SCOPE(NAME_)
+#endif
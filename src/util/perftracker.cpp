@@ -1,8 +1,19 @@
 #include "perftracker.hpp"
 
+#include "spanrecorder.hpp"
+
 #include <chrono>
 #include <cassert>
 #include <cstring>
+#include <cmath>
+#include <bit>
+#include <limits>
+#include <algorithm>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 
 
@@ -52,12 +63,130 @@ namespace {
 		return false;
 	}
 
+
+	/** Every interned ID, which is never forgotten. */
+	struct IdRegistry {
+		std::mutex mutex;
+		std::deque<std::string> names; // Elements don't move when the deque grows
+		std::unordered_map<std::string_view, uint32_t> indices;
+	};
+
+	/* Constructed on first use, since trackers with static storage
+	 * may intern IDs before this translation unit is initialized. */
+	IdRegistry& id_registry() {
+		static IdRegistry r;
+		return r;
+	}
+
 }
 
 
 
 namespace perf {
 
+	size_t Histogram::bucketOf(value_t v) noexcept {
+		if(v < LINEAR_BUCKETS)  return v;
+		unsigned msb = std::bit_width(v) - 1;
+		unsigned shift = msb - SUB_BITS + 1;
+		value_t top = v >> shift; // In [HALF_BUCKETS, LINEAR_BUCKETS)
+		return LINEAR_BUCKETS + ((msb - SUB_BITS) * HALF_BUCKETS) + (top - HALF_BUCKETS);
+	}
+
+
+	Histogram::value_t Histogram::bucketLowest(size_t b) noexcept {
+		if(b < LINEAR_BUCKETS)  return b;
+		size_t k = b - LINEAR_BUCKETS;
+		unsigned shift = (k / HALF_BUCKETS) + 1;
+		value_t top = HALF_BUCKETS + (k % HALF_BUCKETS);
+		return top << shift;
+	}
+
+
+	Histogram::value_t Histogram::bucketHighest(size_t b) noexcept {
+		if(b < LINEAR_BUCKETS)  return b;
+		size_t k = b - LINEAR_BUCKETS;
+		unsigned shift = (k / HALF_BUCKETS) + 1;
+		value_t top = HALF_BUCKETS + (k % HALF_BUCKETS);
+		return ((top + 1) << shift) - 1; // Wraps around to the max value for the last bucket
+	}
+
+
+	Histogram::Histogram() noexcept:
+			buckets_ { },
+			count_(0),
+			min_(0), max_(0),
+			mean_(0.0), m2_(0.0)
+	{ }
+
+
+	void Histogram::add(value_t v) noexcept {
+		++ buckets_[bucketOf(v)];
+		if(count_ == 0) {
+			min_ = max_ = v;
+		} else {
+			min_ = std::min(min_, v);
+			max_ = std::max(max_, v);
+		}
+		++ count_;
+		double delta = double(v) - mean_;
+		mean_ += delta / double(count_);
+		m2_ += delta * (double(v) - mean_);
+	}
+
+
+	double Histogram::stdDev() const noexcept {
+		return (count_ > 1)? std::sqrt(m2_ / double(count_ - 1)) : 0.0;
+	}
+
+
+	Histogram::value_t Histogram::percentile(double p) const noexcept {
+		if(count_ == 0)  return 0;
+		size_t rank = std::clamp<size_t>(static_cast<size_t>(std::ceil(p * double(count_))), 1, count_);
+		size_t cumulative = 0;
+		for(size_t b=0; b < BUCKET_COUNT; ++b) {
+			cumulative += buckets_[b];
+			if(cumulative >= rank) {
+				return std::clamp(bucketHighest(b), min_, max_); }
+		}
+		return max_;
+	}
+
+
+	Histogram& Histogram::operator|=(const Histogram& rh) noexcept {
+		if(rh.count_ == 0)  return *this;
+		if(count_ == 0)  return *this = rh;
+		for(size_t b=0; b < BUCKET_COUNT; ++b) {
+			buckets_[b] += rh.buckets_[b]; }
+		{ // Chan et al.'s parallel variance
+			double n = double(count_) + double(rh.count_);
+			double delta = rh.mean_ - mean_;
+			m2_ += rh.m2_ + (delta * delta * double(count_) * double(rh.count_) / n);
+			mean_ += delta * double(rh.count_) / n;
+		}
+		count_ += rh.count_;
+		min_ = std::min(min_, rh.min_);
+		max_ = std::max(max_, rh.max_);
+		return *this;
+	}
+
+
+
+	TimerId TimerId::intern(const char* name) {
+		assert(name != nullptr);
+		auto& reg = id_registry();
+		auto lock = std::unique_lock(reg.mutex);
+		auto found = reg.indices.find(name);
+		if(found != reg.indices.end()) {
+			return TimerId { found->second, reg.names[found->second].c_str() }; }
+		uint32_t index = reg.names.size();
+		assert(index != invalidIndex);
+		const std::string& stored = reg.names.emplace_back(name);
+		reg.indices.emplace(stored, index);
+		return TimerId { index, stored.c_str() };
+	}
+
+
+
 	void PerfTracker::resetRuntimeEpoch() {
 		timeReference = clock::now();
 	}
@@ -69,46 +198,98 @@ namespace perf {
 
 
 	PerfTracker::State PerfTracker::startTimer(const char* id) {
-		return State{id, utime_t(now<clock::duration>())};
+		return State{id, utime_t(now<clock::duration>()), { }};
+	}
+
+
+	PerfTracker::State PerfTracker::startTimer(const TimerId& id) {
+		return State{id.name, utime_t(now<clock::duration>()), id};
 	}
 
 
-	void PerfTracker::stopTimer(State& state) {
+	utime_t PerfTracker::stopTimer(State& state) {
 		using conv = ConvRatio<clock::time_point::period, ns::period>;
 		assert(state.id != nullptr);
 		assert(stime_t(conv::num) * stime_t(conv::den) >= 0);
-		state.time = ((now<clock::duration>() - state.time) * conv::num) / conv::den;
-		if(find(records_, state.id, recordsHintIdx_)) {
-			auto& rec = records_[recordsHintIdx_];
-			assert(0 == strcmp(rec.id, state.id));
+		utime_t begin = state.time;
+		utime_t r = ((now<clock::duration>() - begin) * conv::num) / conv::den;
+		const char* internedId;
+		if(state.timerId.valid()) {
+			record(state.timerId, r);
+			internedId = state.timerId.name;
+		} else {
+			record(state.id, r);
+			internedId = records_[recordsHintIdx_].id; // `record` leaves the hint on the record it has found or added
+		}
+		if(auto* spans = SpanRecorder::active()) {
+			spans->add(internedId, (begin * conv::num) / conv::den, r); }
+		state.time = r;
+		#ifndef NDEBUG
+			state.id = nullptr;
+			state.time = 0;
+		#endif
+		return r;
+	}
+
+
+	void PerfTracker::record(const char* id, utime_t value) {
+		assert(id != nullptr);
+		if(find(records_, id, recordsHintIdx_)) {
+			assert(0 == strcmp(records_[recordsHintIdx_].id, id));
+			add_(records_[recordsHintIdx_], value);
+		} else {
+			add_(insert_(TimerId::intern(id)), value);
+		}
+	}
+
+
+	void PerfTracker::record(const TimerId& id, utime_t value) {
+		assert(id.valid());
+		uint32_t slot = (id.index < recordIndices_.size())? recordIndices_[id.index] : 0;
+		add_((slot != 0)? records_[slot - 1] : insert_(id), value);
+	}
+
+
+	void PerfTracker::add_(Record& rec, utime_t value) {
+		if(rec.count == 0) {
+			rec.avgTime = value;
+			rec.count = 1;
+		} else {
 			rec.avgTime =
-				(state.time * movingAverageDecay) +
+				(value * movingAverageDecay) +
 				(rec.avgTime * (1.0 - movingAverageDecay));
 			if((rec.count+1) < std::numeric_limits<decltype(rec.count)>::max() / 2) {
 				rec.count += 1;
 			} else {
 				rec.count /= 3;
 			}
-		} else {
-			recordsHintIdx_ = records_.size();
-			records_.push_back(Record{
-				state.id,
-				utime_t(state.time),
-				1 });
 		}
-		#ifndef NDEBUG
-			state.id = nullptr;
-			state.time = 0;
-		#endif
+		rec.histogram.add(value);
+	}
+
+
+	PerfTracker::Record& PerfTracker::insert_(const TimerId& id) {
+		if(recordIndices_.size() <= id.index) {
+			recordIndices_.resize(id.index + 1, 0); }
+		recordIndices_[id.index] = records_.size() + 1;
+		recordsHintIdx_ = records_.size();
+		records_.push_back(Record { id.name, id, 0, 0, { } });
+		return records_.back();
 	}
 
 
 	void PerfTracker::reset() {
 		records_.clear();
+		recordIndices_.clear();
 		recordsHintIdx_ = 0;
 	}
 
 
+	bool PerfTracker::has(const char* id) const noexcept {
+		return find(records_, id, recordsHintIdx_);
+	}
+
+
 	PerfTracker::utime_t PerfTracker::ns(const char* id) const noexcept {
 		#ifndef NDEBUG
 			bool found = find(records_, id, recordsHintIdx_);
@@ -120,6 +301,13 @@ namespace perf {
 	}
 
 
+	const Histogram& PerfTracker::histogram(const char* id) const noexcept {
+		[[maybe_unused]] bool found = find(records_, id, recordsHintIdx_);
+		assert(found);
+		return records_[recordsHintIdx_].histogram;
+	}
+
+
 	PerfTracker PerfTracker::operator|(const PerfTracker& rh) {
 		const PerfTracker* bigger = this;
 		const PerfTracker* smaller = &rh;
@@ -132,18 +320,19 @@ namespace perf {
 
 	PerfTracker& PerfTracker::operator|=(const PerfTracker& rh) {
 		for(const auto& rhRecord : rh.records_) {
-			++recordsHintIdx_; // Subsequent insertions guarantee cache misses
-			bool found = find(records_, rhRecord.id, recordsHintIdx_);
-			if(found) {
-				auto& rRecord = records_[recordsHintIdx_];
+			uint32_t idx = rhRecord.timerId.index;
+			uint32_t slot = (idx < recordIndices_.size())? recordIndices_[idx] : 0;
+			if(slot != 0) {
+				auto& rRecord = records_[slot - 1];
 				rRecord.avgTime =
 					(
 						( rRecord.avgTime *  rRecord.count) +
 						(rhRecord.avgTime * rhRecord.count)
 					) / (rRecord.count + rhRecord.count);
 				rRecord.count = 1;
+				rRecord.histogram |= rhRecord.histogram;
 			} else {
-				records_.push_back(rhRecord);
+				insert_(rhRecord.timerId) = rhRecord;
 				records_.back().count = 1;
 			}
 		}
@@ -1,12 +1,88 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
 #include <vector>
 
 
 
 namespace perf {
 
+	/** A log-linear histogram, in the style of HdrHistogram: values
+	 * smaller than 2^SUB_BITS have a bucket each, larger values share
+	 * a bucket with the ones that have the same SUB_BITS most significant
+	 * bits. The relative error is then bounded by 2^-(SUB_BITS-1) for
+	 * values of any magnitude, with a fixed number of buckets.
+	 *
+	 * Adding a sample never allocates, and two histograms
+	 * can be merged without losing precision. */
+	class Histogram {
+	public:
+		using value_t = std::uintmax_t;
+
+		static constexpr unsigned SUB_BITS = 5;
+		static constexpr unsigned VALUE_BITS = 64;
+		static constexpr size_t LINEAR_BUCKETS = size_t(1) << SUB_BITS;
+		static constexpr size_t HALF_BUCKETS = LINEAR_BUCKETS / 2; // Buckets per power of 2, past the linear ones
+		static constexpr size_t BUCKET_COUNT = LINEAR_BUCKETS + ((VALUE_BITS - SUB_BITS) * HALF_BUCKETS);
+
+		static_assert(sizeof(value_t) * 8 == VALUE_BITS);
+
+		static size_t bucketOf(value_t) noexcept;
+		static value_t bucketLowest(size_t) noexcept;
+		static value_t bucketHighest(size_t) noexcept;
+
+		Histogram() noexcept;
+
+		void add(value_t) noexcept;
+
+		size_t count() const noexcept { return count_; }
+		value_t min() const noexcept { return min_; } // 0 if there are no samples
+		value_t max() const noexcept { return max_; }
+		double mean() const noexcept { return mean_; }
+		double stdDev() const noexcept;
+
+		/** The highest value that is equivalent to the nearest-rank
+		 * percentile `p` (in [0, 1]), clamped to the exact min and max. */
+		value_t percentile(double p) const noexcept;
+
+		Histogram& operator|=(const Histogram&) noexcept;
+
+	private:
+		std::array<uint64_t, BUCKET_COUNT> buckets_;
+		size_t count_;
+		value_t min_, max_;
+		double mean_, m2_; // Welford's online variance
+	};
+
+
+	/** A record ID that has been interned once for the whole process,
+	 * and that maps to a dense index: records can be found through it
+	 * without comparing strings.
+	 *
+	 * Interning takes a lock, so it should happen once per call site;
+	 * the PERF_ID macro does exactly that. */
+	class TimerId {
+	public:
+		static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+		uint32_t index = invalidIndex;
+		const char* name = nullptr; // Owned by the process-wide registry, never deallocated
+
+		static TimerId intern(const char*);
+
+		bool valid() const noexcept { return index != invalidIndex; }
+	};
+
+	/** Interns a string (usually a literal) the first time the expression
+	 * is evaluated, and yields the same `const perf::TimerId&` afterwards. */
+	#define PERF_ID(NAME_) ([]() -> const ::perf::TimerId& { \
+		static const ::perf::TimerId id_ = ::perf::TimerId::intern(NAME_); \
+		return id_; \
+	} ())
+
+
 	class PerfTracker {
 	public:
 		using utime_t = std::uintmax_t;
@@ -15,18 +91,25 @@ namespace perf {
 		struct State {
 			const char* id;
 			utime_t time;
+			TimerId timerId; // Invalid for timers started with a string
 		};
 
 		struct Record {
-			const char* id;
+			const char* id; // The same as `timerId.name`
+			TimerId timerId;
 			utime_t avgTime;
 			size_t count;
+			Histogram histogram; // Every sample ever recorded, unlike `avgTime`
 		};
 
 	private:
 		std::vector<Record> records_;
+		std::vector<uint32_t> recordIndices_; // For each TimerId index, 1 + the index of its record; 0 if there is none
 		mutable size_t recordsHintIdx_; // Used to hint where to search first in the records vector
 
+		void add_(Record&, utime_t value);
+		Record& insert_(const TimerId&);
+
 	public:
 		double movingAverageDecay = 0.5;
 
@@ -38,8 +121,17 @@ namespace perf {
 		PerfTracker& operator=(const PerfTracker&) = default;
 		PerfTracker& operator=(PerfTracker&&) = default;
 
+		/* Timers started with a string are stopped through the slow
+		 * path, which compares the string with every record's ID
+		 * until it finds a match. */
 		State startTimer(const char*);
-		void stopTimer(State&);
+		State startTimer(const TimerId&);
+		utime_t stopTimer(State&); // Returns the measured time, in nanoseconds
+
+		/** Adds a sample to a record, as if a timer with the same ID
+		 * measured it; useful for tracking counters alongside times. */
+		void record(const char* id, utime_t value);
+		void record(const TimerId&, utime_t value);
 
 		template<typename fn_t, typename... args_t>
 		void measure(const char* id, fn_t fn, args_t... args) {
@@ -48,6 +140,13 @@ namespace perf {
 			stopTimer(timer);
 		}
 
+		template<typename fn_t, typename... args_t>
+		void measure(const TimerId& id, fn_t fn, args_t... args) {
+			auto timer = startTimer(id);
+			fn(args...);
+			stopTimer(timer);
+		}
+
 		template<typename fn_t, typename... args_t>
 		void measure(fn_t fn, args_t... args) {
 			auto timer = startTimer();
@@ -57,8 +156,17 @@ namespace perf {
 
 		void reset();
 
+		/** Whether any sample has been recorded with the given ID. */
+		bool has(const char*) const noexcept;
+
 		utime_t ns(const char*) const noexcept;
 
+		/** The average of a record's samples, for records that aren't times. */
+		utime_t value(const char* id) const noexcept { return ns(id); }
+
+		/** The distribution of a record's samples; the record must exist. */
+		const Histogram& histogram(const char*) const noexcept;
+
 		utime_t us(const char* id) const noexcept { return ns(id) / 1000; }
 		utime_t ms(const char* id) const noexcept { return ns(id) / 1000000; }
 
@@ -67,6 +175,8 @@ namespace perf {
 		utime_t us() const noexcept { return us(""); }
 		utime_t ms() const noexcept { return ms(""); }
 
+		const std::vector<Record>& records() const noexcept { return records_; }
+
 		PerfTracker operator|(const PerfTracker& rh);
 		PerfTracker& operator|=(const PerfTracker& rh);
 	};
@@ -85,6 +195,8 @@ namespace perf {
 
 			static void resetRuntimeEpoch() { }
 
+			double movingAverageDecay = 0.5;
+
 			PerfTracker() { }
 			PerfTracker(const PerfTracker&) = default;
 			PerfTracker(PerfTracker&&) = default;
@@ -92,7 +204,11 @@ namespace perf {
 			PerfTracker& operator=(PerfTracker&&) = default;
 
 			State startTimer(const char*) { return { }; }
-			void stopTimer(State&) { }
+			State startTimer(const TimerId&) { return { }; }
+			utime_t stopTimer(State&) { return { }; }
+
+			void record(const char*, utime_t) { }
+			void record(const TimerId&, utime_t) { }
 
 			template<typename fn_t, typename... args_t>
 			void measure(fn_t fn, args_t... args) { fn(args...); }
@@ -100,8 +216,17 @@ namespace perf {
 			template<typename fn_t, typename... args_t>
 			void measure(const char*, fn_t fn, args_t... args) { fn(args...); }
 
+			template<typename fn_t, typename... args_t>
+			void measure(const TimerId&, fn_t fn, args_t... args) { fn(args...); }
+
+			void reset() { }
+
+			bool has(const char*) const noexcept { return false; }
+
 			utime_t ns(const char*) const noexcept;
 
+			utime_t value(const char*) const noexcept { return { }; }
+
 			utime_t us(const char*) const noexcept { return { }; }
 			utime_t ms(const char*) const noexcept { return { }; }
 
@@ -0,0 +1,63 @@
+#include "radixsort.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+
+
+namespace {
+
+	constexpr unsigned RADIX_BITS = 8;
+	constexpr size_t RADIX = size_t(1) << RADIX_BITS;
+
+	using histogram_t = std::array<uint32_t, RADIX>;
+
+	constexpr unsigned MAX_PASSES = 64 / RADIX_BITS;
+
+}
+
+
+
+namespace util {
+
+	void radix_sort(
+			std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch,
+			unsigned keyBits
+	) {
+		assert(keyBits <= 64);
+		if(entries.size() < 2) return;
+		const unsigned passes = (keyBits + RADIX_BITS - 1) / RADIX_BITS;
+		std::array<histogram_t, MAX_PASSES> histograms = { };
+
+		{ // Count every digit of every pass at once
+			for(const auto& entry : entries) {
+				for(unsigned p=0; p < passes; ++p) {
+					++ histograms[p][(entry.key >> (p * RADIX_BITS)) & (RADIX - 1)]; }
+			}
+		}
+
+		scratch.resize(entries.size());
+		SortEntry* src = entries.data();
+		SortEntry* dst = scratch.data();
+		for(unsigned p=0; p < passes; ++p) {
+			auto& histogram = histograms[p];
+			unsigned shift = p * RADIX_BITS;
+			if(histogram[(src[0].key >> shift) & (RADIX - 1)] == entries.size()) {
+				continue; } // Every key has the same digit
+			uint32_t offset = 0;
+			for(auto& count : histogram) {
+				uint32_t c = count;
+				count = offset;
+				offset += c;
+			}
+			for(size_t i=0; i < entries.size(); ++i) {
+				dst[histogram[(src[i].key >> shift) & (RADIX - 1)] ++] = src[i]; }
+			std::swap(src, dst);
+		}
+		if(src != entries.data()) {
+			entries.swap(scratch); }
+	}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+
+namespace util {
+
+	/** An element to be sorted: `index` usually refers to an
+	 * external array, which is then visited in the sorted order. */
+	struct SortEntry {
+		std::uint64_t key;
+		std::uint32_t index;
+	};
+
+
+	/** Stably sorts the entries by ascending key, with a LSD radix sort
+	 * that processes a byte per pass.
+	 *
+	 * Only the lowest `keyBits` bits of the keys are considered, and
+	 * passes over bytes that are the same for every key are skipped.
+	 * `scratch` is only used as temporary storage, and is kept by the
+	 * caller so that its capacity can be reused. */
+	void radix_sort(
+		std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch,
+		unsigned keyBits = 64 );
+
+
+	/** Maps a float to an unsigned integer with the same ordering,
+	 * so that it can be used in (part of) a sort key. */
+	inline std::uint32_t float_sort_key(float f) {
+		static_assert(sizeof(float) == sizeof(std::uint32_t));
+		std::uint32_t bits;
+		std::memcpy(&bits, &f, sizeof(bits));
+		// Negative values are stored as sign+magnitude, and need to be flipped entirely
+		std::uint32_t mask = -std::int32_t(bits >> 31) | 0x80000000u;
+		return bits ^ mask;
+	}
+
+}
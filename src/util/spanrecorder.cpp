@@ -0,0 +1,126 @@
+#include "spanrecorder.hpp"
+
+#include "util.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+
+
+namespace {
+
+	std::atomic<uint32_t> lastThreadId = 0;
+
+
+	/** Chrome traces use microseconds, but sub-microsecond spans
+	 * are common enough to keep the fractional part. */
+	void write_us(std::ostream& out, std::uintmax_t ns) {
+		auto frac = ns % 1000;
+		out << (ns / 1000) << '.' << char('0' + (frac / 100)) << char('0' + ((frac / 10) % 10)) << char('0' + (frac % 10));
+	}
+
+}
+
+
+
+namespace perf {
+
+	void SpanRecorder::setActive(SpanRecorder* recorder) noexcept {
+		active_.store(recorder, std::memory_order_release);
+	}
+
+
+	uint32_t SpanRecorder::currentThreadId() noexcept {
+		thread_local uint32_t r = ++ lastThreadId;
+		return r;
+	}
+
+
+	SpanRecorder::SpanRecorder(size_t capacity):
+			ring_(capacity),
+			next_(0),
+			cleared_(0)
+	{
+		assert(capacity > 0);
+	}
+
+
+	void SpanRecorder::add(const char* id, utime_t beginNs, utime_t durationNs) {
+		uint64_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+		auto& slot = ring_[ticket % ring_.size()];
+		slot.seq.store((2 * ticket) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.id.store(id, std::memory_order_relaxed);
+		slot.beginNs.store(beginNs, std::memory_order_relaxed);
+		slot.durationNs.store(durationNs, std::memory_order_relaxed);
+		slot.threadId.store(currentThreadId(), std::memory_order_relaxed);
+		slot.seq.store(2 * (ticket + 1), std::memory_order_release);
+	}
+
+
+	std::vector<SpanRecorder::Span> SpanRecorder::spans() const {
+		uint64_t end = next_.load(std::memory_order_acquire);
+		uint64_t first = firstTicket_(end);
+		std::vector<Span> r;
+		r.reserve(end - first);
+		for(uint64_t ticket = first; ticket < end; ++ticket) {
+			const auto& slot = ring_[ticket % ring_.size()];
+			uint64_t seq = slot.seq.load(std::memory_order_acquire);
+			if(seq != 2 * (ticket + 1))  continue; // Still being written, or already overwritten
+			Span span = {
+				slot.id.load(std::memory_order_relaxed),
+				slot.beginNs.load(std::memory_order_relaxed),
+				slot.durationNs.load(std::memory_order_relaxed),
+				slot.threadId.load(std::memory_order_relaxed) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(slot.seq.load(std::memory_order_relaxed) != seq)  continue; // Overwritten while being read
+			r.push_back(span);
+		}
+		return r;
+	}
+
+
+	size_t SpanRecorder::size() const noexcept {
+		uint64_t end = next_.load(std::memory_order_acquire);
+		return end - firstTicket_(end);
+	}
+
+
+	void SpanRecorder::clear() {
+		cleared_.store(next_.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+
+	uint64_t SpanRecorder::firstTicket_(uint64_t end) const noexcept {
+		uint64_t oldest = (end > ring_.size())? (end - ring_.size()) : 0;
+		return std::min(end, std::max(oldest, cleared_.load(std::memory_order_acquire)));
+	}
+
+
+	void SpanRecorder::writeChromeTrace(std::ostream& out) const {
+		auto spanList = spans(); // Copied, so that recording isn't blocked while writing
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		for(size_t i=0; i < spanList.size(); ++i) {
+			const auto& span = spanList[i];
+			out << ((i == 0)? "\n" : ",\n") << "{\"name\":";
+			util::write_json_str(out, span.id);
+			out << ",\"cat\":\"perf\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.threadId << ",\"ts\":";
+			write_us(out, span.beginNs);
+			out << ",\"dur\":";
+			write_us(out, span.durationNs);
+			out << '}';
+		}
+		out << "\n]}\n";
+	}
+
+
+	void SpanRecorder::writeChromeTrace(const std::string& path) const {
+		std::ofstream out = std::ofstream(path, std::ios::trunc);
+		writeChromeTrace(out);
+		if(! out) {
+			throw std::runtime_error("failed to write the trace \"" + path + "\""); }
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+
+
+namespace perf {
+
+	/** A bounded ring buffer of timed spans, which can be written as a
+	 * Chrome trace-event JSON file (viewable with Perfetto or
+	 * chrome://tracing).
+	 *
+	 * While a recorder is active, every timer stopped by any PerfTracker
+	 * on any thread is added to it; once the buffer is full, the oldest
+	 * spans are overwritten. Each span is stored as a single complete
+	 * event, so overwriting never leaves a begin without its end.
+	 *
+	 * Adding a span never takes a lock: each one claims a slot with an
+	 * atomic ticket, and readers skip the slots that are being written. */
+	class SpanRecorder {
+	public:
+		using utime_t = std::uintmax_t;
+
+		struct Span {
+			const char* id; // Interned through perf::TimerId, so it's never deallocated
+			utime_t beginNs; // Relative to the same epoch as every PerfTracker
+			utime_t durationNs;
+			uint32_t threadId;
+		};
+
+		/** The recorder that PerfTrackers add their spans to, or `nullptr`. */
+		static SpanRecorder* active() noexcept { return active_.load(std::memory_order_acquire); }
+		static void setActive(SpanRecorder*) noexcept;
+
+		/** A small number that identifies the calling thread in traces;
+		 * threads are numbered by their first span, from 1. */
+		static uint32_t currentThreadId() noexcept;
+
+		SpanRecorder(size_t capacity);
+
+		SpanRecorder(const SpanRecorder&) = delete;
+		SpanRecorder& operator=(const SpanRecorder&) = delete;
+
+		void add(const char* id, utime_t beginNs, utime_t durationNs);
+
+		/** Every span in the buffer, oldest first; spans that are
+		 * being added concurrently may be left out. */
+		std::vector<Span> spans() const;
+
+		size_t size() const noexcept; // Including spans that are being added
+		size_t capacity() const noexcept { return ring_.size(); }
+
+		void clear();
+
+		void writeChromeTrace(std::ostream&) const;
+		void writeChromeTrace(const std::string& path) const;
+
+	private:
+		/** A seqlock-protected span; the fields are atomic only so
+		 * that torn reads, which are discarded, aren't data races. */
+		struct Slot {
+			std::atomic<uint64_t> seq = 0; // 2 * (1 + the ticket of the span), odd while it's being written
+			std::atomic<const char*> id;
+			std::atomic<utime_t> beginNs;
+			std::atomic<utime_t> durationNs;
+			std::atomic<uint32_t> threadId;
+		};
+
+		static inline std::atomic<SpanRecorder*> active_ = nullptr;
+
+		uint64_t firstTicket_(uint64_t end) const noexcept; // The oldest span that is still in the buffer, given the next ticket
+
+		std::vector<Slot> ring_;
+		std::atomic<uint64_t> next_; // The ticket of the next span
+		std::atomic<uint64_t> cleared_; // Spans with lower tickets have been cleared
+	};
+
+}
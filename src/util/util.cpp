@@ -106,6 +106,24 @@ namespace util {
 		return r;
 	}
 
+
+	void write_json_str(std::ostream& out, std::string_view str) {
+		constexpr const char* hexDigits = "0123456789abcdef";
+		out << '"';
+		for(char c : str) {
+			auto uc = static_cast<unsigned char>(c);
+			if(c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else
+			if(uc < 0x20) {
+				out << "\\u00" << hexDigits[uc >> 4] << hexDigits[uc & 0xF];
+			} else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
 }
 
 
@@ -137,6 +155,7 @@ namespace util {
 
 
 	void AllocTracker::alloc(const std::string& nm, unsigned n) {
+		auto lock = std::unique_lock(_mutex);
 		util::logAlloc() << count_allocs(nm, n, '+') << util::endl;
 		_allocs[nm] += n;
 	}
@@ -147,6 +166,7 @@ namespace util {
 
 
 	void AllocTracker::dealloc(const std::string& nm, unsigned n) {
+		auto lock = std::unique_lock(_mutex);
 		util::logAlloc() << count_allocs(nm, n, '-') << util::endl;
 		_allocs[nm] -= n;
 	}
@@ -14,8 +14,11 @@
 // Only <string> is required for inline utils
 #ifndef UTIL_INLINE_ONLY
 	#include <istream>
+	#include <ostream>
+	#include <string_view>
 	#include <ratio>
 	#include <map>
+	#include <mutex>
 #endif
 
 
@@ -82,6 +85,11 @@ namespace util {
 		std::string read_stream(std::istream&);
 
 
+		/** Inserts a string into a stream as a quoted JSON string,
+		 * escaping quotes, backslashes and control characters. */
+		void write_json_str(std::ostream&, std::string_view);
+
+
 		#ifdef NDEBUG
 			class AllocTracker {
 			public:
@@ -96,6 +104,7 @@ namespace util {
 			class AllocTracker {
 			private:
 				std::map<std::string, int> _allocs;
+				std::mutex _mutex; // Resources may be created by worker threads
 
 			public:
 				AllocTracker() = default;
@@ -27,6 +27,10 @@
 #include <iostream>
 #include <set>
 #include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <cstring>
+#include <cstdlib>
 
 #include <libconfig.h++>
 
@@ -79,11 +83,14 @@ namespace {
 	} ());
 
 
+	/** Creates the Vulkan instance, with the extensions required by SDL
+	 * to create a surface for the given window; a headless instance
+	 * has no window, and needs no surface extension. */
 	vk::Instance mk_vk_instance(const vk::ApplicationInfo& appInfo, SDL_Window* window) {
 		std::vector<const char*> actualExtensions;
 		actualExtensions.insert(actualExtensions.end(),
 			instanceExtensions.begin(), instanceExtensions.end());
-		{
+		if(window != nullptr) {
 			uint32_t extCount;
 			const char** ptr;
 			#ifdef NDEBUG
@@ -104,6 +111,28 @@ namespace {
 	}
 
 
+	/** Makes the Vulkan loader ignore every installed driver but the
+	 * null one; this must happen before the instance is created, since
+	 * the loader reads the driver list only then. */
+	void select_null_device_driver() {
+		const char* cEnvPath = getenv(NULL_DEVICE_ICD_ENV_VAR_NAME);
+		if(cEnvPath == nullptr) {
+			util::logGeneral()
+				<< NULL_DEVICE_ICD_ENV_VAR_NAME << " env variable not set; using \"" << NULL_DEVICE_ICD_DEFAULT << '"' << util::endl;
+			cEnvPath = NULL_DEVICE_ICD_DEFAULT;
+		}
+		auto path = std::filesystem::absolute(cEnvPath).string();
+		if(! std::filesystem::exists(path)) {
+			throw std::runtime_error(formatVkErrorMsg("null device driver manifest not found", path)); }
+		// Older loaders only know VK_ICD_FILENAMES, newer ones prefer VK_DRIVER_FILES
+		setenv("VK_DRIVER_FILES", path.c_str(), true);
+		setenv("VK_ICD_FILENAMES", path.c_str(), true);
+		// Implicit layers (overlays, capture tools) would add their own overhead to every call
+		setenv("VK_LOADER_LAYERS_DISABLE", "~implicit~", true);
+		util::logVkDebug() << "Using the null device driver \"" << path << '"' << util::endl;
+	}
+
+
 	vk::PhysicalDevice get_ph_dev(
 			vk::Instance vkInstance,
 			vk::PhysicalDeviceFeatures* destDevFeatures
@@ -226,15 +255,25 @@ namespace {
 	vk::Device mk_device(
 			vk::PhysicalDevice pDev,
 			const Queues::FamilyIndices& qFamIdx,
+			bool headless, bool pipelineStatistics,
 			Queues* queues
 	) {
 		auto dqcInfos = mk_q_create_infos(
 			qFamIdx, pDev.getQueueFamilyProperties());
+		// Headless devices never present, and software ICDs may not even expose the swapchain extension
+		std::vector<const char*> extensions = std::vector<const char*>(
+			deviceExtensions.begin(), deviceExtensions.end());
+		if(headless) {
+			std::erase_if(extensions, [](const char* ext) {
+				return 0 == strcmp(ext, VK_KHR_SWAPCHAIN_EXTENSION_NAME); });
+		}
+		vk::PhysicalDeviceFeatures enabledFeatures = features;
+		enabledFeatures.pipelineStatisticsQuery = pipelineStatistics;
 		vk::DeviceCreateInfo dcInfo;
 		dcInfo.setQueueCreateInfos(dqcInfos.createInfos);
 		dcInfo.setPEnabledLayerNames(activeLayers);
-		dcInfo.setPEnabledExtensionNames(deviceExtensions);
-		dcInfo.setPEnabledFeatures(&features);
+		dcInfo.setPEnabledExtensionNames(extensions);
+		dcInfo.setPEnabledFeatures(&enabledFeatures);
 		auto r = pDev.createDevice(dcInfo);
 		queues->compute = r.getQueue(dqcInfos.computePos[0], dqcInfos.computePos[1]);
 		queues->transfer = r.getQueue(dqcInfos.transferPos[0], dqcInfos.transferPos[1]);
@@ -262,6 +301,127 @@ namespace {
 	}
 
 
+	/** Prepended to the pipeline cache data when it is saved to disk:
+	 * drivers are supposed to reject incompatible caches on their own,
+	 * but some of them don't, and the driver version isn't part
+	 * of the standard pipeline cache header. */
+	struct PipelineCacheFileHeader {
+		static constexpr std::array<char, 8> MAGIC = { 'V', 'K', 'A', '2', 'P', 'L', 'C', '\0' };
+		static constexpr uint32_t VERSION = 1;
+		std::array<char, 8> magic;
+		uint64_t dataSize;
+		uint32_t headerVersion;
+		uint32_t vendorId;
+		uint32_t deviceId;
+		uint32_t driverVersion;
+		std::array<uint8_t, VK_UUID_SIZE> pipelineCacheUuid;
+
+		static PipelineCacheFileHeader fromProperties(const vk::PhysicalDeviceProperties& props) {
+			PipelineCacheFileHeader r;
+			r.magic = MAGIC;
+			r.headerVersion = VERSION;
+			r.vendorId = props.vendorID;
+			r.deviceId = props.deviceID;
+			r.driverVersion = props.driverVersion;
+			std::copy(props.pipelineCacheUUID.begin(), props.pipelineCacheUUID.end(), r.pipelineCacheUuid.begin());
+			r.dataSize = 0;
+			return r;
+		}
+
+		bool isCompatibleWith(const PipelineCacheFileHeader& h) const {
+			return
+				(magic == h.magic) &&
+				(headerVersion == h.headerVersion) &&
+				(vendorId == h.vendorId) &&
+				(deviceId == h.deviceId) &&
+				(driverVersion == h.driverVersion) &&
+				(pipelineCacheUuid == h.pipelineCacheUuid);
+		}
+	};
+
+	static_assert(sizeof(PipelineCacheFileHeader) == 48, "PipelineCacheFileHeader must not contain padding");
+
+
+	/** Reads the pipeline cache data saved to the given file, if it
+	 * exists and if it has been produced by the same device and driver. */
+	std::vector<char> rd_pipeline_cache_data(
+			const vk::PhysicalDeviceProperties& props, const std::string& path
+	) {
+		std::ifstream in = std::ifstream(path, std::ios::binary);
+		if(! in) {
+			util::logVkDebug() << "No pipeline cache at \"" << path << '"' << util::endl;
+			return { };
+		}
+		PipelineCacheFileHeader expected = PipelineCacheFileHeader::fromProperties(props);
+		PipelineCacheFileHeader found;
+		in.read(reinterpret_cast<char*>(&found), sizeof(PipelineCacheFileHeader));
+		if((! in) || (! expected.isCompatibleWith(found))) {
+			util::logVkEvent() << "Discarding the pipeline cache at \"" << path
+				<< "\", created by a different device or driver" << util::endl;
+			return { };
+		}
+		std::vector<char> r;
+		r.resize(found.dataSize);
+		in.read(r.data(), r.size());
+		if(static_cast<uint64_t>(in.gcount()) != found.dataSize) {
+			util::logVkEvent() << "Discarding the truncated pipeline cache at \"" << path << '"' << util::endl;
+			return { };
+		}
+		return r;
+	}
+
+
+	vk::PipelineCache mk_pipeline_cache(
+			vk::PhysicalDevice pDev, vk::Device dev, const std::string& path
+	) {
+		std::vector<char> initialData = rd_pipeline_cache_data(pDev.getProperties(), path);
+		vk::PipelineCacheCreateInfo pccInfo;
+		pccInfo.initialDataSize = initialData.size();
+		pccInfo.pInitialData = initialData.data();
+		try {
+			auto r = dev.createPipelineCache(pccInfo);
+			if(! initialData.empty()) {
+				util::logVkDebug() << "Loaded " << initialData.size()
+					<< " bytes of pipeline cache" << util::endl;
+			}
+			return r;
+		} catch(vk::SystemError& err) {
+			if(initialData.empty()) throw;
+			util::logVkEvent() << "The driver rejected the pipeline cache at \"" << path << '"' << util::endl;
+			return dev.createPipelineCache(vk::PipelineCacheCreateInfo());
+		}
+	}
+
+
+	/** Writes the pipeline cache to a temporary file, then replaces the
+	 * given one with it, so that an interrupted write cannot leave
+	 * a corrupt cache behind. */
+	void save_pipeline_cache(
+			vk::PhysicalDevice pDev, vk::Device dev,
+			vk::PipelineCache cache, const std::string& path
+	) {
+		std::vector<uint8_t> data = dev.getPipelineCacheData(cache);
+		PipelineCacheFileHeader header = PipelineCacheFileHeader::fromProperties(pDev.getProperties());
+		header.dataSize = data.size();
+		std::string tmpPath = path + ".tmp";
+		{
+			std::ofstream out = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(PipelineCacheFileHeader));
+			out.write(reinterpret_cast<const char*>(data.data()), data.size());
+			if(! out) {
+				util::logVkError() << "Failed to write the pipeline cache to \"" << tmpPath << '"' << util::endl;
+				return;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tmpPath, path, ec);
+		if(ec) {
+			util::logVkError() << "Failed to replace the pipeline cache at \"" << path
+				<< "\": " << ec.message() << util::endl;
+		}
+	}
+
+
 	SDL_Window* mk_window(bool fullscreen, std::array<uint32_t, 2> ext) {
 		// glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);  // Do not create the OpenGL context
 		// glfwWindowHint(GLFW_RESIZABLE, true);
@@ -385,6 +545,86 @@ namespace {
 	}
 
 
+	/** Offscreen images aren't constrained by a surface: the format is
+	 * the one a surface would most likely use, and is guaranteed to
+	 * support being rendered to, blitted to and copied from. */
+	vk::SurfaceFormatKHR select_offscreen_fmt(vk::PhysicalDevice pDev) {
+		constexpr vk::FormatFeatureFlags feats =
+			vk::FormatFeatureFlagBits::eColorAttachment |
+			vk::FormatFeatureFlagBits::eBlitDst |
+			vk::FormatFeatureFlagBits::eTransferSrc;
+		auto r = vk::SurfaceFormatKHR(vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear);
+		auto props = pDev.getFormatProperties(r.format);
+		if((props.optimalTilingFeatures & feats) != feats) {
+			throw std::runtime_error(formatVkErrorMsg(
+				"offscreen images can't be rendered to", enum_str(r.format)));
+		}
+		return r;
+	}
+
+
+	/** Parses the command line arguments that aren't part of the
+	 * configuration file; unknown arguments are errors. */
+	LaunchParams parse_launch_params(int argc, char** argv) {
+		LaunchParams r;
+		for(int i=1; i < argc; ++i) {
+			std::string_view arg = argv[i];
+			const auto nextArg = [&]() -> const char* {
+				if(i+1 >= argc) {
+					throw std::runtime_error("missing value for argument \""s + argv[i] + "\""s); }
+				return argv[++i];
+			};
+			if(arg == "--headless") {
+				r.headless = true;
+			} else
+			if(arg == "--frames") {
+				r.frameLimit = std::stoul(nextArg());
+			} else
+			if(arg == "--readback") {
+				r.readbackPath = nextArg();
+			} else
+			if(arg == "--benchmark") {
+				r.benchmarkReport = nextArg();
+			} else
+			if(arg == "--baseline") {
+				r.benchmarkBaseline = nextArg();
+			} else
+			if(arg == "--tolerance") {
+				r.benchmarkTolerance = std::stod(nextArg());
+			} else
+			if(arg == "--trace") {
+				r.tracePath = nextArg();
+			} else
+			if(arg == "--trace-threshold") {
+				r.traceThresholdMs = std::stod(nextArg());
+			} else
+			if(arg == "--pipeline-stats") {
+				r.pipelineStatistics = true;
+			} else
+			if(arg == "--null-device") {
+				r.nullDevice = true;
+			} else {
+				throw std::runtime_error("unknown argument \""s + argv[i] + "\""s);
+			}
+		}
+		if((! r.readbackPath.empty()) && (! r.headless)) {
+			throw std::runtime_error("\"--readback\" requires \"--headless\""); }
+		if(r.nullDevice && (! r.headless)) {
+			throw std::runtime_error("\"--null-device\" requires \"--headless\""); }
+		if((! r.benchmarkBaseline.empty()) && (! r.benchmark())) {
+			throw std::runtime_error("\"--baseline\" requires \"--benchmark\""); }
+		if((r.traceThresholdMs > 0.0) && r.tracePath.empty()) {
+			throw std::runtime_error("\"--trace-threshold\" requires \"--trace\""); }
+		#ifndef ENABLE_PERF_TRACKER
+			if(r.benchmark()) {
+				throw std::runtime_error("\"--benchmark\" requires a build with ENABLE_PERF_TRACKER"); }
+		#endif
+		if(r.benchmark() && (r.frameLimit == 0)) {
+			r.frameLimit = BENCHMARK_DEFAULT_FRAMES; }
+		return r;
+	}
+
+
 	vk::SurfaceCapabilitiesKHR check_surface_capabs(
 			vk::PhysicalDevice pDev, vk::SurfaceKHR surface
 	) {
@@ -410,13 +650,24 @@ namespace {
 
 
 	void get_runtime_params(
-			vk::PhysicalDevice pDev,
+			vk::PhysicalDevice pDev, unsigned graphicsQueueFamily,
 			bool doUseStencil,
 			const vka2::Options& opts, Runtime* runtimePtr
 	) {
 		vk::PhysicalDeviceProperties pDevProps = pDev.getProperties();
 		runtimePtr->depthOptimalFmt = select_depthstencil_format(pDev, false);
 		runtimePtr->samplerAnisotropy = pDevProps.limits.maxSamplerAnisotropy;
+		{ // Timestamps are only usable if the graphics queue writes at least a few bits of them
+			unsigned validBits = pDev.getQueueFamilyProperties()[graphicsQueueFamily].timestampValidBits;
+			if(validBits > 0) {
+				runtimePtr->timestampPeriodNs = pDevProps.limits.timestampPeriod;
+				runtimePtr->timestampMask = (validBits >= 64)? UINT64_MAX : ((uint64_t(1) << validBits) - 1);
+			} else {
+				runtimePtr->timestampPeriodNs = 0.0f;
+				runtimePtr->timestampMask = 0;
+				util::logVkDebug() << "The graphics queue doesn't support timestamps" << util::endl;
+			}
+		}
 		runtimePtr->fullscreen = opts.windowParams.initFullscreen;
 		runtimePtr->bestSampleCount = vk::SampleCountFlagBits::e1;
 		if(opts.windowParams.useMultisampling) {
@@ -445,7 +696,7 @@ namespace {
 
 
 
-int main(int, char**) {
+int main(int argc, char** argv) {
 	#ifndef NDEBUG
 		#define DO_DEBUG true
 	#else
@@ -461,10 +712,10 @@ int main(int, char**) {
 	util::log.setLevel(util::LOG_VK_ERROR, true);
 	util::log.setLevel(util::LOG_VK_EVENT, true);
 	try {
-		Application app;
-		app.run();
+		Application app = Application(parse_launch_params(argc, argv));
+		bool success = app.run();
 		app.destroy();
-		return EXIT_SUCCESS;
+		return success? EXIT_SUCCESS : EXIT_FAILURE;
 	} catch(vk::SystemError& err) {
 		std::cerr << "[vk::SystemError] " << err.what() << '\n';
 		switch(err.code().value()) {
@@ -491,15 +742,20 @@ int main(int, char**) {
 
 namespace vka2 {
 
-	Application::Application():
+	Application::Application(const LaunchParams& launchParams):
 			_cached_swapchain(nullptr)
 	{
-		SDL_Init(SDL_INIT_VIDEO);
-		SDL_Vulkan_LoadLibrary(nullptr);
-
+		_data.launchParams = launchParams;
 		_data.options = Options::fromFile(CONFIG_FILE);
 
-		{
+		if(launchParams.headless) {
+			// No video subsystem, so that no display server is needed
+			SDL_Init(0);
+			_data.sdlWin = nullptr;
+			util::logVkDebug() << "Running headless" << util::endl;
+		} else {
+			SDL_Init(SDL_INIT_VIDEO);
+			SDL_Vulkan_LoadLibrary(nullptr);
 			const auto& wParams = _data.options.windowParams;
 			auto ext = wParams.initFullscreen? wParams.fullscreenExtent : wParams.windowExtent;
 			_data.sdlWin = mk_window(wParams.initFullscreen, ext);  util::alloc_tracker.alloc("Application:_data:sdlWin");
@@ -509,16 +765,30 @@ namespace vka2 {
 			"vkapp2", VK_MAKE_VERSION(VKA2_APP_VERSION[0], VKA2_APP_VERSION[1], VKA2_APP_VERSION[2]),
 			"vkapp_engine", VK_MAKE_VERSION(VKA2_ENGINE_VERSION[0], VKA2_ENGINE_VERSION[1], VKA2_ENGINE_VERSION[2]),
 			VK_API_VERSION);
+		if(launchParams.nullDevice) {
+			select_null_device_driver(); }
 		_vk_instance = mk_vk_instance(_vk_appinfo, _data.sdlWin);
 		_data.pDev = get_ph_dev(_vk_instance, &_data.pDevFeatures);
 		_data.pDevFeatures = _data.pDev.getFeatures();
 		_data.qFamIdx = find_qfam_idxs(_data.pDev);
-		_data.dev = mk_device(_data.pDev, _data.qFamIdx, &_data.queues);  util::alloc_tracker.alloc("Application:_data:dev");
+		bool pipelineStatistics = launchParams.pipelineStatistics && _data.pDevFeatures.pipelineStatisticsQuery;
+		if(launchParams.pipelineStatistics && ! pipelineStatistics) {
+			util::logError() << "The device doesn't support pipeline statistics queries" << util::endl; }
+		_data.dev = mk_device(_data.pDev, _data.qFamIdx, launchParams.headless, pipelineStatistics, &_data.queues);  util::alloc_tracker.alloc("Application:_data:dev");
 		_data.alloc = mk_allocator(_vk_instance,
 			_data.pDev, _data.dev);  util::alloc_tracker.alloc("Application:_data:alloc");
+		if(launchParams.nullDevice) {
+			// The null driver compiles nothing worth keeping, and its cache would replace the real device's one
+			_data.pipelineCache = _data.dev.createPipelineCache(vk::PipelineCacheCreateInfo());
+		} else {
+			_data.pipelineCache = mk_pipeline_cache(_data.pDev, _data.dev, PIPELINE_CACHE_FILE);
+		}
+		util::alloc_tracker.alloc("Application:_data:pipelineCache");
 		_data.transferCmdPool = CommandPool(_data.dev, _data.qFamIdx.transfer, true);  util::alloc_tracker.alloc("Application:_data:transferCmdPool");
 		_data.graphicsCmdPool = CommandPool(_data.dev, _data.qFamIdx.graphics, true);  util::alloc_tracker.alloc("Application:_data:graphicsCmdPool");
-		get_runtime_params(_data.pDev, false, _data.options, &_data.runtime);
+		_data.modelUbos = UboRing(*this, sizeof(ubo::Model), MODEL_UBO_RING_INITIAL_SLOTS, ubo::Model::dma);
+		get_runtime_params(_data.pDev, _data.qFamIdx.graphics, false, _data.options, &_data.runtime);
+		_data.runtime.pipelineStatistics = pipelineStatistics;
 		_create_surface();
 		util::alloc_tracker.alloc("Application");
 	}
@@ -526,33 +796,55 @@ namespace vka2 {
 
 	void Application::destroy() {
 		_destroy_surface();
+		_data.modelUbos.destroy();
 		_data.graphicsCmdPool.destroy();  util::alloc_tracker.dealloc("Application:_data:graphicsCmdPool");
 		_data.transferCmdPool.destroy();  util::alloc_tracker.dealloc("Application:_data:transferCmdPool");
+		if(! _data.launchParams.nullDevice) {
+			save_pipeline_cache(_data.pDev, _data.dev, _data.pipelineCache, PIPELINE_CACHE_FILE); }
+		_data.dev.destroyPipelineCache(_data.pipelineCache);  util::alloc_tracker.dealloc("Application:_data:pipelineCache");
 		vmaDestroyAllocator(_data.alloc);  util::alloc_tracker.dealloc("Application:_data:alloc");
 		_data.dev.destroy();  util::alloc_tracker.dealloc("Application:_data:dev");
 		_vk_instance.destroy();
-		SDL_DestroyWindow(_data.sdlWin);  util::alloc_tracker.dealloc("Application:_data:sdlWin");
+		if(_data.sdlWin != nullptr) {
+			SDL_DestroyWindow(_data.sdlWin);  util::alloc_tracker.dealloc("Application:_data:sdlWin"); }
 		SDL_Quit();
 		util::alloc_tracker.dealloc("Application");
 	}
 
 
 	void Application::_create_surface() {
-		_data.surface = mk_window_surface(_vk_instance, _data.sdlWin);  util::alloc_tracker.alloc("Application:_data:surface");
-		std::tie(_data.qFamIdxPresent, _data.presentQueue) =
-			find_present_idx(_data.pDev, _data.qFamIdx, _data.queues, _data.surface);
+		if(_data.launchParams.headless) {
+			// Nothing is ever presented
+			_data.surface = nullptr;
+			_data.qFamIdxPresent = _data.qFamIdx.graphics;
+			_data.presentQueue = nullptr;
+		} else {
+			_data.surface = mk_window_surface(_vk_instance, _data.sdlWin);  util::alloc_tracker.alloc("Application:_data:surface");
+			std::tie(_data.qFamIdxPresent, _data.presentQueue) =
+				find_present_idx(_data.pDev, _data.qFamIdx, _data.queues, _data.surface);
+		}
 		_create_swapchain();
 	}
 
 
 	void Application::_destroy_surface() {
 		_destroy_swapchain(false);
-		_vk_instance.destroySurfaceKHR(_data.surface);  util::alloc_tracker.dealloc("Application:_data:surface");
+		if(_data.surface) {
+			_vk_instance.destroySurfaceKHR(_data.surface);  util::alloc_tracker.dealloc("Application:_data:surface"); }
 	}
 
 
 	void Application::_create_swapchain() {
 		_data.dev.waitIdle();
+		if(_data.launchParams.headless) {
+			_data.surfaceFmt = select_offscreen_fmt(_data.pDev);
+			_data.swapchain = AbstractSwapchain::offscreen(*this,
+				vk::Extent2D(
+					_data.options.windowParams.windowExtent[0],
+					_data.options.windowParams.windowExtent[1]),
+				MAX_CONCURRENT_FRAMES);
+			return;
+		}
 		_data.surfaceCapabs = check_surface_capabs(_data.pDev, _data.surface);
 		_data.surfaceFmt = select_swapchain_fmt(
 			_data.pDev.getSurfaceFormatsKHR(_data.surface), _data.surfaceCapabs);
@@ -24,18 +24,32 @@
 
 #include "vkapp2/graphics.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <random>
 #include <set>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string_view>
 
 #include "vkapp2/draw.hpp"
 #include "vkapp2/constants.hpp"
+#include "vkapp2/transforms.hpp"
+#include "vkapp2/drawstream.hpp"
 
 #include "vkapp2/settings/options.hpp"
 #include "vkapp2/settings/scene.hpp"
 
 #include <util/perftracker.hpp>
+#include <util/perfcollector.hpp>
+#include <util/spanrecorder.hpp>
+#include <util/framepacer.hpp>
+#include <util/radixsort.hpp>
+#include <util/benchreport.hpp>
 
 using namespace vka2;
 using namespace std::string_literals;
@@ -65,216 +79,211 @@ namespace {
 	}
 
 
-	struct DeviceVectorTraits {
-		vk::BufferUsageFlags bufferUsage;
-		vk::MemoryPropertyFlags vmaRequiredFlags;
-		vk::MemoryPropertyFlags vmaPreferredFlags;
-		VmaMemoryUsage vmaMemoryUsage;
-		vk::PipelineStageFlags firstStage;
-		vk::AccessFlags firstAccess;
-	};
+	util::FramePacer::Mode pacing_mode_from_str(const std::string& str) {
+		using Mode = util::FramePacer::Mode;
+		if(str == "sleep") return Mode::eSleep;
+		if(str == "hybrid") return Mode::eHybrid;
+		if(str == "deadline") return Mode::eDeadline;
+		util::logError() << "Unknown frame pacing mode \"" << str << "\"; using \"hybrid\"" << util::endl;
+		return Mode::eHybrid;
+	}
 
 
-	template<typename T>
-	class DeviceVector {
-	private:
-		DeviceVectorTraits traits_;
-		Application* app_;
-		T* cpuDataPtr_;
-		vk::DeviceSize dataSize_;
-		vk::DeviceSize dataCapacity_;
-		BufferAlloc cpuDataBuffer_;
-		BufferAlloc devDataBuffer_;
+	RenderPass::OutlineMode outline_mode_from_str(const std::string& str) {
+		using Mode = RenderPass::OutlineMode;
+		if(str == "mesh") return Mode::eMesh;
+		if(str == "screen") return Mode::eScreenSpace;
+		util::logError() << "Unknown outline mode \"" << str << "\"; using \"screen\"" << util::endl;
+		return Mode::eScreenSpace;
+	}
 
-		void allocWithTraits_(vk::DeviceSize n) {
-			assert(app_ != nullptr);
-			assert(cpuDataPtr_ == nullptr);
-			util::alloc_tracker.alloc("::DeviceVector<"s + std::to_string(sizeof(T)) + "B>::T"s, n);
-			{
-				auto cpuBcInfo = vk::BufferCreateInfo(
-					{ }, n * sizeof(T),
-					vk::BufferUsageFlagBits::eTransferSrc,
-					vk::SharingMode::eExclusive);
-				cpuDataBuffer_ = app_->createBuffer(cpuBcInfo, VMA_MEMORY_USAGE_CPU_ONLY);
-				cpuDataPtr_ = app_->template mapBuffer<T>(cpuDataBuffer_.alloc);
-			} {
-				auto devBcInfo = vk::BufferCreateInfo(
-					{ }, n * sizeof(T),
-					traits_.bufferUsage | vk::BufferUsageFlagBits::eTransferDst,
-					vk::SharingMode::eExclusive);
-				if(traits_.vmaMemoryUsage == VMA_MEMORY_USAGE_UNKNOWN) {
-					devDataBuffer_ = app_->createBuffer(devBcInfo, traits_.vmaRequiredFlags, traits_.vmaPreferredFlags);
+
+	/** Sorts the given ranges, and merges the ones that overlap
+	 * or are contiguous. */
+	void merge_ranges(std::vector<InstanceRange>& r) {
+		if(r.empty()) return;
+		std::sort(r.begin(), r.end());
+		size_t last = 0;
+		for(size_t i=1; i < r.size(); ++i) {
+			if(r[i].first <= r[last].second) {
+				r[last].second = std::max(r[last].second, r[i].second);
+			} else {
+				r[++last] = r[i];
+			}
+		}
+		r.resize(last + 1);
+	}
+
+
+	/** Merges the ranges separated by the smallest gaps, until there
+	 * are no more than `maxRanges` of them; ranges must be sorted and
+	 * must not overlap. */
+	void limit_ranges(std::vector<InstanceRange>& r, size_t maxRanges) {
+		assert(maxRanges > 0);
+		if(r.size() > maxRanges) {
+			std::vector<vk::DeviceSize> gaps;
+			gaps.reserve(r.size() - 1);
+			for(size_t i=1; i < r.size(); ++i) {
+				gaps.push_back(r[i].first - r[i-1].second); }
+			size_t mergeCount = r.size() - maxRanges;
+			auto nth = gaps.begin() + (mergeCount - 1);
+			std::nth_element(gaps.begin(), nth, gaps.end());
+			vk::DeviceSize maxMergedGap = *nth;
+			size_t mergeableEqualGaps = mergeCount - std::count_if(
+				gaps.begin(), nth, [maxMergedGap](auto gap) { return gap < maxMergedGap; });
+			size_t last = 0;
+			for(size_t i=1; i < r.size(); ++i) {
+				auto gap = r[i].first - r[last].second;
+				bool merge = gap < maxMergedGap;
+				if((! merge) && (gap == maxMergedGap) && (mergeableEqualGaps > 0)) {
+					merge = true;
+					-- mergeableEqualGaps;
+				}
+				if(merge) {
+					r[last].second = r[i].second;
 				} else {
-					devDataBuffer_ = app_->createBuffer(devBcInfo, traits_.vmaMemoryUsage);
+					r[++last] = r[i];
 				}
 			}
-			dataCapacity_ = n;
+			r.resize(last + 1);
 		}
+		assert(r.size() <= maxRanges);
+	}
 
-		void dealloc_(
-				RenderPass* rpass,
-				VmaAllocation vmaAlloc,
-				BufferAlloc& cpuBuffer, BufferAlloc& devBuffer,
-				vk::DeviceSize capacity
-		) {
-			util::alloc_tracker.dealloc("::DeviceVector<"s + std::to_string(sizeof(T)) + "B>::T"s, capacity);
-			if(rpass == nullptr) {
-				app_->device().waitIdle();
-			} else {
-				rpass->waitIdle();
-			}
-			app_->unmapBuffer(vmaAlloc);
-			app_->destroyBuffer(cpuBuffer);
-			app_->destroyBuffer(devBuffer);
+
+	/** A vector whose elements are written to host memory, and replicated
+	 * into one persistently mapped, host visible buffer ("slot") for each
+	 * swapchain image.
+	 *
+	 * Modified ranges are only copied to a slot right before the latter
+	 * is used, after its image's fence has been waited on: the CPU never
+	 * waits for a transfer, and never writes to memory that the device
+	 * may still be reading. */
+	template<typename T>
+	class FrameVector {
+	private:
+		struct Slot {
+			BufferAlloc buffer;
+			T* mapped;
+			vk::DeviceSize capacity;
+			std::vector<InstanceRange> pending; // Ranges that still have to be copied
+			bool stale; // Whether the whole vector has to be copied
+		};
+
+		Application* app_;
+		vk::BufferUsageFlags usage_;
+		std::vector<T> data_;
+		std::vector<Slot> slots_;
+
+		void allocSlot_(Slot& slot, vk::DeviceSize capacity) {
+			auto bcInfo = vk::BufferCreateInfo(
+				{ }, capacity * sizeof(T),
+				usage_, vk::SharingMode::eExclusive);
+			slot.buffer = app_->createBuffer(bcInfo,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				vk::MemoryPropertyFlagBits::eDeviceLocal);
+			slot.mapped = app_->template mapBuffer<T>(slot.buffer.alloc);
+			slot.capacity = capacity;
+			util::alloc_tracker.alloc("::FrameVector<"s + std::to_string(sizeof(T)) + "B>::Slot"s, capacity);
 		}
 
-		void dealloc_(
-				RenderPass* rpass
-		) {
-			assert(app_ != nullptr);
-			cpuDataPtr_ = nullptr;
-			dealloc_(rpass, cpuDataBuffer_.alloc, cpuDataBuffer_, devDataBuffer_, dataCapacity_);
+		void deallocSlot_(Slot& slot) {
+			util::alloc_tracker.dealloc("::FrameVector<"s + std::to_string(sizeof(T)) + "B>::Slot"s, slot.capacity);
+			app_->unmapBuffer(slot.buffer.alloc);
+			app_->destroyBuffer(slot.buffer);
+			slot.mapped = nullptr;
+			slot.capacity = 0;
 		}
 
 	public:
-		DeviceVector() { }
+		FrameVector(): app_(nullptr) { }
 
-		DeviceVector(Application& app, const DeviceVectorTraits& traits):
-				traits_(traits), app_(&app),
-				cpuDataPtr_(nullptr),
-				dataSize_(0), dataCapacity_(0)
+		FrameVector(Application& app, vk::BufferUsageFlags usage):
+				app_(&app), usage_(usage)
 		{ }
 
-		DeviceVector(const DeviceVector& cp):
-				traits_(cp.traits_), app_(cp.app_),
-				dataSize_(cp.dataSize_)
-		{
-			if(app_ != nullptr && dataSize_ != 0) {
-				allocWithTraits_(dataSize_);
-				memcpy(cpuDataPtr_, cp.cpuDataPtr_, cp.dataSize_ * sizeof(T));
-			}
-		}
-
-		DeviceVector(DeviceVector&& mv):
-				traits_(std::move(mv.traits_)),
+		FrameVector(FrameVector&& mv):
 				app_(std::move(mv.app_)),
-				cpuDataPtr_(std::move(mv.cpuDataPtr_)),
-				dataSize_(std::move(mv.dataSize_)),
-				cpuDataBuffer_(std::move(mv.cpuDataBuffer_)),
-				devDataBuffer_(std::move(mv.devDataBuffer_))
+				usage_(std::move(mv.usage_)),
+				data_(std::move(mv.data_)),
+				slots_(std::move(mv.slots_))
 		{
-			assert(app_ != nullptr);
 			mv.app_ = nullptr;
+			mv.slots_.clear();
 		}
 
-		~DeviceVector() {
-			if(app_ != nullptr) {
-				if(dataSize_ != 0) {
-					dealloc_(nullptr);
-				}
-				app_ = nullptr;
-			}
+		~FrameVector() {
+			assert(slots_.empty() && "FrameVector::destroy() must be called before the dtor");
 		}
 
-		DeviceVector& operator=(const DeviceVector& cp) { this->~DeviceVector(); return *new (this) DeviceVector(cp); }
-		DeviceVector& operator=(DeviceVector&& mv) { this->~DeviceVector(); return *new (this) DeviceVector(mv); }
+		FrameVector& operator=(FrameVector&& mv) { this->~FrameVector(); return *new (this) FrameVector(std::move(mv)); }
 
 
-		T* begin() { return cpuDataPtr_; }
-		const T* begin() const { return cpuDataPtr_; }
-		T* end() { return cpuDataPtr_ + dataSize_; }
-		const T* end() const { return cpuDataPtr_ + dataSize_; }
+		/** Destroys all the device buffers; the device must not be
+		 * using any of them. */
+		void destroy() {
+			for(auto& slot : slots_) {
+				if(slot.capacity != 0) deallocSlot_(slot); }
+			slots_.clear();
+		}
 
-		vk::DeviceSize size() const { return dataSize_; }
-		vk::DeviceSize capacity() const { return dataCapacity_; }
 
-		void resizeExact(RenderPass* rpass, vk::DeviceSize newSize, vk::DeviceSize newCapacity) {
-			if(newSize == 0) {
-				if(dataCapacity_ != 0) dealloc_(rpass);
-			} else {
-				if(newCapacity != dataCapacity_) {
-					auto old_dataCapacity = dataCapacity_;
-					auto old_cpuDataPtr = cpuDataPtr_;
-					auto old_cpuDataBuffer = cpuDataBuffer_;
-					auto old_devDataBuffer = devDataBuffer_;
-					cpuDataPtr_ = nullptr;
-					allocWithTraits_(newCapacity);
-					memcpy(old_cpuDataPtr, cpuDataPtr_, std::min(dataSize_, newSize));
-					dataCapacity_ = newCapacity;
-					if(old_dataCapacity != 0) {
-						dealloc_(rpass, old_cpuDataBuffer.alloc, old_cpuDataBuffer, old_devDataBuffer, old_dataCapacity);
-					}
-				}
-				dataSize_ = newSize;
-			}
-		}
+		T* data() { return data_.data(); }
+		const T* data() const { return data_.data(); }
+		vk::DeviceSize size() const { return data_.size(); }
 
-		void resize(RenderPass* rpass, vk::DeviceSize newSize) {
-			if(newSize != 0) {
-				if(newSize > dataSize_) {
-					vk::DeviceSize pow = 1;
-					while(pow < newSize) pow *= 2;
-					resizeExact(rpass, newSize, pow);
-				}
-			}
-		}
+		/** New elements are not marked as modified. */
+		void resize(vk::DeviceSize newSize) { data_.resize(newSize); }
 
-		void push_back(T v) {
-			resize(dataSize_ + 1);
-			cpuDataPtr_[dataSize_-1] = std::move(v);
-		}
+		T& operator[](vk::DeviceSize i) { assert(i < data_.size()); return data_[i]; }
+		const T& operator[](vk::DeviceSize i) const { assert(i < data_.size()); return data_[i]; }
 
-		T& operator[](vk::DeviceSize i) { assert(i < dataSize_); return cpuDataPtr_[i]; }
-		const T& operator[](vk::DeviceSize i) const { assert(i < dataSize_); return cpuDataPtr_[i]; }
-
-
-		const BufferAlloc& devBuffer() const { assert(app_ != nullptr); return devDataBuffer_; }
-
-		[[nodiscard]]
-		CommandPool::BufferHandle flushAsync(vk::Fence fence, vk::DeviceSize beg, vk::DeviceSize end) {
-			assert(beg <= dataSize_);
-			assert(end <= dataSize_);
-			assert(beg <= end);
-			if(beg < end) {
-				auto& cmdPool = app_->graphicsCommandPool();
-				auto cmdFn = [this, beg, end](vk::CommandBuffer cmd) {
-					vk::BufferCopy cp;
-					vk::BufferMemoryBarrier mBar = { };
-					cp.srcOffset = cp.dstOffset = beg * sizeof(T);
-					cp.setSize((end - beg) * sizeof(T));
-					mBar.buffer = devDataBuffer_.handle;
-					mBar.size = VK_WHOLE_SIZE;
-					mBar.srcAccessMask = vk::AccessFlagBits::eHostWrite;
-					mBar.dstAccessMask = traits_.firstAccess;
-					mBar.srcQueueFamilyIndex =
-					mBar.dstQueueFamilyIndex = app_->queueFamilyIndices().graphics;
-					cmd.pipelineBarrier(
-						vk::PipelineStageFlagBits::eHost,
-						traits_.firstStage,
-						vk::DependencyFlags(),
-						{ }, mBar, { });
-					cmd.copyBuffer(cpuDataBuffer_.handle, devDataBuffer_.handle, cp);
-				};
-				if(fence) {
-					return cmdPool.runCmdsAsync(app_->queues().graphics, cmdFn, fence);
-				} else {
-					cmdPool.runCmds(app_->queues().graphics, cmdFn);
+
+		/** Marks the given ranges as modified, so that they will be
+		 * copied to each slot before the latter is used again. */
+		void markModified(const std::vector<InstanceRange>& ranges) {
+			if(ranges.empty()) return;
+			for(auto& slot : slots_) {
+				if(! slot.stale) {
+					slot.pending.insert(slot.pending.end(), ranges.begin(), ranges.end());
+					merge_ranges(slot.pending);
+					limit_ranges(slot.pending, INSTANCE_FLUSH_MAX_RANGES);
 				}
 			}
-			return { };
-		}
-
-		[[nodiscard]]
-		CommandPool::BufferHandle flushAsync(vk::Fence fence) {
-			return flushAsync(fence, 0, dataSize_);
 		}
 
-		void flush(vk::DeviceSize beg, vk::DeviceSize end) {
-			auto cmdHandle = flushAsync(nullptr, beg, end);
-		}
 
-		void flush() {
-			auto cmdHandle = flushAsync(nullptr);
+		/** Copies the pending modifications to the given slot, and returns
+		 * its buffer; the caller must guarantee that the device isn't using
+		 * the slot, usually by waiting on the fence of the frame that used
+		 * it last. The buffer may be reallocated if the vector grew. */
+		const BufferAlloc& syncSlot(size_t slotIndex) {
+			assert(app_ != nullptr);
+			if(slotIndex >= slots_.size()) {
+				slots_.resize(slotIndex + 1, Slot {
+					.buffer = { }, .mapped = nullptr, .capacity = 0,
+					.pending = { }, .stale = true });
+			}
+			auto& slot = slots_[slotIndex];
+			if(slot.capacity < std::max<vk::DeviceSize>(1, data_.size())) {
+				vk::DeviceSize capacity = 1;
+				while(capacity < data_.size()) capacity *= 2;
+				if(slot.capacity != 0) deallocSlot_(slot);
+				allocSlot_(slot, capacity);
+				slot.stale = true;
+			}
+			if(slot.stale) {
+				memcpy(slot.mapped, data_.data(), data_.size() * sizeof(T));
+				slot.stale = false;
+			} else {
+				for(const auto& range : slot.pending) {
+					assert(range.second <= data_.size());
+					memcpy(slot.mapped + range.first, data_.data() + range.first,
+						(range.second - range.first) * sizeof(T));
+				}
+			}
+			slot.pending.clear();
+			return slot.buffer;
 		}
 	};
 
@@ -292,8 +301,10 @@ namespace {
 		unsigned shaderSelector;
 		bool speedMod : 1;
 		bool toggleFullscreen : 1;
+		bool toggleOutlineMode : 1;
 		bool createObj : 1;
 		bool movePointLightMod : 1;
+		bool dumpTrace : 1;
 	};
 
 
@@ -305,6 +316,177 @@ namespace {
 	};
 
 
+	/** Everything that moves independently of the rendered frames. */
+	struct SimState {
+		glm::vec4 pointLight;
+		glm::vec3 position;
+		glm::vec2 orientation;
+		int64_t timeNs; // When the state is meant to be displayed, relative to the steady clock's epoch
+	};
+
+
+	struct SimParams {
+		float turnSpeedKey, turnSpeedKeyMod, moveSpeed, moveSpeedMod;
+	};
+
+
+	glm::mat4 mk_orientation_mat(const glm::vec2& orientation) {
+		glm::mat4 r = glm::mat4(1.0f);
+		r = glm::rotate(r, orientation.y, glm::vec3(1.0f, 0.0f, 0.0f));
+		r = glm::rotate(r, orientation.x, glm::vec3(0.0f, 1.0f, 0.0f));
+		return r;
+	}
+
+
+	/** Interpolates two angles in radians, through the shortest arc. */
+	float lerp_angle(float a, float b, float t) {
+		constexpr auto rad360 = glm::radians(360.0f);
+		float d = b - a;
+		d -= std::round(d / rad360) * rad360;
+		return a + (d * t);
+	}
+
+
+	/** Advances the view and the point light on a thread of its own,
+	 * at a fixed time step, independently of how long frames take to
+	 * be rendered.
+	 *
+	 * The two most recent states are double buffered: the render thread
+	 * samples them at `now - timeStep` and interpolates between them,
+	 * which trades one simulation step of latency for smooth motion
+	 * at any frame rate. */
+	class Simulation {
+	public:
+		Simulation() = default;
+		~Simulation() { stop(); }
+
+
+		void start(const SimState& initial, const SimParams& params, float timeStepS) {
+			assert(! thread_.joinable());
+			params_ = params;
+			timeStep_ = std::chrono::nanoseconds(static_cast<int64_t>(timeStepS * 1'000'000'000.0));
+			states_[0] = states_[1] = initial;
+			states_[0].timeNs = states_[1].timeNs = now_ns_();
+			latest_ = 1;
+			thread_ = std::jthread([this](std::stop_token stop) { run_(stop); });
+		}
+
+		void stop() {
+			if(thread_.joinable()) {
+				thread_.request_stop();
+				thread_.join();
+			}
+		}
+
+
+		/** Copies the parts of the control scheme that affect the
+		 * simulation; they will be used from the next step onward. */
+		void setInput(const CtrlSchemeContext& ctrl) {
+			auto lock = std::unique_lock(inputMutex_);
+			input_ = ctrl;
+		}
+
+
+		/** Returns the state that should be displayed at the
+		 * current time, interpolated between the last two steps. */
+		SimState sample() const {
+			SimState prev, curr;
+			{
+				auto lock = std::unique_lock(stateMutex_);
+				prev = states_[latest_ ^ 1];
+				curr = states_[latest_];
+			}
+			int64_t t = now_ns_() - timeStep_.count();
+			float alpha = (curr.timeNs > prev.timeNs)?
+				static_cast<float>(t - prev.timeNs) / static_cast<float>(curr.timeNs - prev.timeNs) :
+				1.0f;
+			alpha = std::clamp(alpha, 0.0f, 1.0f);
+			SimState r;
+			r.pointLight = glm::mix(prev.pointLight, curr.pointLight, alpha);
+			r.position = glm::mix(prev.position, curr.position, alpha);
+			r.orientation = {
+				lerp_angle(prev.orientation.x, curr.orientation.x, alpha),
+				lerp_angle(prev.orientation.y, curr.orientation.y, alpha) };
+			r.timeNs = t;
+			return r;
+		}
+
+	private:
+		static int64_t now_ns_() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()
+			).count();
+		}
+
+
+		void step_(SimState& state, const CtrlSchemeContext& ctrl, float dt) const {
+			constexpr auto rad360 = glm::radians(360.0f);
+			{ // Modify the current orientation based on the input state
+				float adjustedTurnSpeed = ctrl.speedMod?
+					params_.turnSpeedKeyMod : params_.turnSpeedKey;
+				glm::vec2 actualRotate = {
+					ctrl.rotate.x,
+					ctrl.rotate.y * YAW_TO_PITCH_RATIO };
+				state.orientation += adjustedTurnSpeed * actualRotate * dt;
+				state.orientation.x -= std::floor(state.orientation.x / rad360) * rad360;
+				state.orientation.y -= std::floor(state.orientation.y / rad360) * rad360;
+			} { // Change the current position based on the orientation
+				float adjustedMoveSpeed = ctrl.speedMod?
+					params_.moveSpeedMod : params_.moveSpeed;
+				glm::vec3 deltaPos = adjustedMoveSpeed * dt *
+					(ctrl.fwdMoveVector - ctrl.bcwMoveVector);
+				glm::vec4 deltaPosRotated =
+					glm::transpose(mk_orientation_mat(state.orientation)) * glm::vec4(deltaPos, 1.0f);
+				if(ctrl.movePointLightMod) {
+					state.pointLight -= glm::vec4(deltaPosRotated.x, deltaPosRotated.y, deltaPosRotated.z, 0.0f);
+				} else {
+					state.position -= glm::vec3(deltaPosRotated);
+				}
+			}
+		}
+
+
+		void run_(std::stop_token stop) {
+			using clock = std::chrono::steady_clock;
+			constexpr unsigned maxLateSteps = 4; // Beyond this, steps are skipped rather than caught up with
+			float dt = std::chrono::duration<float>(timeStep_).count();
+			SimState state = states_[latest_];
+			auto nextStep = clock::now() + timeStep_;
+			while(! stop.stop_requested()) {
+				std::this_thread::sleep_until(nextStep);
+				PERF_SCOPE("sim.step")
+				CtrlSchemeContext ctrl;
+				{
+					auto lock = std::unique_lock(inputMutex_);
+					ctrl = input_;
+				}
+				step_(state, ctrl, dt);
+				state.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					nextStep.time_since_epoch()).count();
+				{
+					auto lock = std::unique_lock(stateMutex_);
+					states_[latest_ ^ 1] = state;
+					latest_ ^= 1;
+				}
+				nextStep += timeStep_;
+				auto now = clock::now();
+				if(now > nextStep + (maxLateSteps * timeStep_)) {
+					nextStep = now; }
+			}
+		}
+
+
+		SimParams params_;
+		std::chrono::nanoseconds timeStep_;
+		mutable std::mutex stateMutex_;
+		std::mutex inputMutex_;
+		CtrlSchemeContext input_ = { };
+		SimState states_[2];
+		unsigned latest_ = 1;
+		std::jthread thread_;
+	};
+
+
 	/** A wrapper for vka2::Mesh, to associate it with a descriptor set.
 	 * It also references a descriptor pool, in order to create and destroy
 	 * sets. */
@@ -351,13 +533,15 @@ namespace {
 	};
 
 
+	/** An object's transformation is stored separately, in
+	 * `RenderContext::transforms`, with the same index. */
 	struct Object {
 		MeshWrapper meshWrapper;
-		glm::vec3 position;
-		glm::vec3 orientation;
-		glm::vec3 scale;
 		glm::vec4 color;
 		float rnd;
+		uint32_t materialIndex; // Relative to `RenderContext::materials`, or push_const::Object::noMaterial
+		float lodBias; // The material's, pushed with every draw
+		bool dirty; // Whether the instance needs to be reassembled; see `mark_dirty`
 	};
 
 
@@ -370,24 +554,33 @@ namespace {
 		Keymap keymap;
 		RenderPass rpass;
 		Pipeline mainPipeline, outlinePipeline;
+		RenderPass::OutlineMode outlineMode; // The requested one, see `RenderPass::outlineMode`
 		DynDescriptorPool dPool;
 		MeshInstance::TextureCache textureCache;
 		MeshInstance::MeshCache meshCache;
 		struct Shaders {
 			std::string mainVtx, mainFrg;
 			std::string outlineVtx, outlineFrg;
+			std::string edgeVtx, edgeFrg, edgeFrgMs; // Screen space outlines
 		} shaders;
 		std::minstd_rand rng;
 		std::uniform_real_distribution<float> rngDistr;
 		std::vector<Object> objects;
-		DeviceVector<Instance> instances;
-		glm::vec4 pointLight;
+		TransformStore transforms;
+		FrameVector<Instance> instances;
+		std::vector<size_t> dirtyObjects; // Indices of the objects whose instances are out of date
+		std::array<DrawStream, 2> drawStreams; // One per subpass, see `mk_draw_streams`
+		std::vector<float> drawDistances;
+		std::vector<vk::Buffer> recordedInstanceBuffers; // The instance buffer each swapchain image last used
+		std::vector<ssbo::MaterialTable::Entry> materials; // Uploaded to the render pass' material table
 		glm::vec3 lightDirection;
-		glm::vec3 position;
-		glm::vec2 orientation;
+		Simulation sim;
+		SimState initialState; // The state the simulation starts from
+		SimParams simParams;
+		float simTimeStep;
 		unsigned frameCounter;
-		float turnSpeedKey, turnSpeedKeyMod, moveSpeed, moveSpeedMod;
 		bool dPoolOutOfDate;
+		unsigned long modelUboGeneration; // The model UBO ring's generation the mesh descriptors refer to
 	};
 
 
@@ -494,7 +687,9 @@ namespace {
 		MAP_KEY(SDLK_r) { ctrlCtx->bcwMoveVector.y = pressed? 1.0f : 0.0f; };
 		MAP_KEY(SDLK_f) { ctrlCtx->fwdMoveVector.y = pressed? 1.0f : 0.0f; };
 		MAP_KEY(SDLK_n) { if(!pressed) ctrlCtx->createObj = true; };
+		MAP_KEY(SDLK_o) { if(!pressed) ctrlCtx->toggleOutlineMode = true; };
 		MAP_KEY(SDLK_LCTRL) { ctrlCtx->movePointLightMod = pressed; };
+		MAP_KEY(SDLK_t) { if(!pressed) ctrlCtx->dumpTrace = true; };
 
 		#ifndef NDEBUG
 			MAP_KEY(SDLK_c) { std::quick_exit(1); };
@@ -547,30 +742,31 @@ namespace {
 			.fwdMoveVector = { }, .bcwMoveVector = { },
 			.rotate = { },
 			.shaderSelector = 0, .speedMod = false,
-			.toggleFullscreen = false, .createObj = false,
-			.movePointLightMod = false };
+			.toggleFullscreen = false, .toggleOutlineMode = false, .createObj = false,
+			.movePointLightMod = false, .dumpTrace = false };
 		dst.keymap = mk_key_bindings(app.sdlWindow(), &dst.ctrlCtx);
 		dst.rngDistr = std::uniform_real_distribution<float>(0.0f, 1.0f);
-		dst.turnSpeedKey = opts.viewParams.viewTurnSpeedKey;
-		dst.turnSpeedKeyMod = opts.viewParams.viewTurnSpeedKeyMod;
-		dst.moveSpeed = opts.viewParams.viewMoveSpeed;
-		dst.moveSpeedMod = opts.viewParams.viewMoveSpeedMod;
-		dst.instances = DeviceVector<Instance>(app, {
-			vk::BufferUsageFlagBits::eVertexBuffer,
-			{ }, { }, VMA_MEMORY_USAGE_GPU_ONLY,
-			vk::PipelineStageFlagBits::eVertexInput,
-			vk::AccessFlagBits::eIndexRead });
+		if(app.launchParams().benchmark()) {
+			dst.rng.seed(BENCHMARK_RNG_SEED); }
+		dst.simParams = SimParams {
+			.turnSpeedKey = opts.viewParams.viewTurnSpeedKey,
+			.turnSpeedKeyMod = opts.viewParams.viewTurnSpeedKeyMod,
+			.moveSpeed = opts.viewParams.viewMoveSpeed,
+			.moveSpeedMod = opts.viewParams.viewMoveSpeedMod };
+		dst.simTimeStep = 1.0f / opts.viewParams.simFrequencyS;
+		dst.instances = FrameVector<Instance>(app, vk::BufferUsageFlagBits::eVertexBuffer);
 		dst.lightDirection = glm::normalize(glm::vec3({
 			opts.worldParams.lightDirection[0],
 			opts.worldParams.lightDirection[1],
 			opts.worldParams.lightDirection[2] }));
-		dst.position = {
+		dst.initialState.position = {
 			-opts.viewParams.initialPosition[0],
 			-opts.viewParams.initialPosition[1],
 			-opts.viewParams.initialPosition[2] };
-		dst.orientation = {
+		dst.initialState.orientation = {
 			glm::radians(opts.viewParams.initialYaw),
 			glm::radians(opts.viewParams.initialPitch) };
+		dst.outlineMode = outline_mode_from_str(opts.shaderParams.outlineMode);
 		dst.frameCounter = 0;
 	}
 
@@ -601,6 +797,9 @@ namespace {
 		dst.shaders.mainFrg = rdFile(shaderPath + "/fragment.main.spv"s);
 		dst.shaders.outlineVtx = rdFile(shaderPath + "/vertex.outline.spv"s);
 		dst.shaders.outlineFrg = rdFile(shaderPath + "/fragment.outline.spv"s);
+		dst.shaders.edgeVtx = rdFile(shaderPath + "/vertex.edge.spv"s);
+		dst.shaders.edgeFrg = rdFile(shaderPath + "/fragment.edge.spv"s);
+		dst.shaders.edgeFrgMs = rdFile(shaderPath + "/fragment.edge.ms.spv"s);
 	}
 
 
@@ -621,12 +820,29 @@ namespace {
 					dstRpass, dstMainPl, dstOutlinePl, dstShaders,
 					sampleCount
 			] () {
-				*dstMainPl = Pipeline(*dstRpass,
-					dstShaders->mainVtx, dstShaders->mainFrg, "main", 0,
-					false, dstRpass->renderExtent(), sampleCount);
-				*dstOutlinePl = Pipeline(*dstRpass,
-					dstShaders->outlineVtx, dstShaders->outlineFrg, "main", 1,
-					true, dstRpass->renderExtent(), sampleCount);
+				// The pipelines are independent, and each compilation may take a while
+				auto mainPl = std::async(std::launch::async, [=]() {
+					PERF_SCOPE("app.buildPipeline")
+					return Pipeline(*dstRpass,
+						dstShaders->mainVtx, dstShaders->mainFrg, "main", 0,
+						false, sampleCount);
+				});
+				auto outlinePl = std::async(std::launch::async, [=]() {
+					PERF_SCOPE("app.buildPipeline")
+					if(dstRpass->outlineMode() == RenderPass::OutlineMode::eScreenSpace) {
+						bool ms = sampleCount != vk::SampleCountFlagBits::e1;
+						return Pipeline(*dstRpass,
+							dstShaders->edgeVtx, ms? dstShaders->edgeFrgMs : dstShaders->edgeFrg, "main", 1,
+							false, sampleCount, Pipeline::Geometry::eFullscreen);
+					} else {
+						return Pipeline(*dstRpass,
+							dstShaders->outlineVtx, dstShaders->outlineFrg, "main", 1,
+							true, sampleCount);
+					}
+				});
+				*dstMainPl = mainPl.get();
+				*dstOutlinePl = outlinePl.get();
+				dstRpass->invalidateCommandBuffers();
 			};
 
 			RenderPass::SwapchainOutdatedCallback onSwpchnOod = [
@@ -638,13 +854,16 @@ namespace {
 				static_assert(ubo::Model::set == Texture::samplerDescriptorSet);
 				assert(rpass.swapchain()->application != nullptr);
 				auto* app = rpass.swapchain()->application;
-				dstMainPl->destroy();
-				dstOutlinePl->destroy();
 				app->rebuildSwapChain();
 				rpass.reassign(app->swapchain(), fit_extent_height(
 					app->options().windowParams.maxVerticalResolution,
 					app->swapchain().data.extent));
-				buildPipelines();
+				// The viewport is dynamic: pipelines only need to be rebuilt if the attachments changed
+				if(! (dstMainPl->isCompatibleWith(rpass) && dstOutlinePl->isCompatibleWith(rpass))) {
+					dstMainPl->destroy();
+					dstOutlinePl->destroy();
+					buildPipelines();
+				}
 				set_static_ubo(rpass, app->options());
 			};
 
@@ -653,7 +872,7 @@ namespace {
 					app.options().windowParams.maxVerticalResolution,
 					app.swapchain().data.extent),
 				MAX_CONCURRENT_FRAMES, opts.windowParams.useMultisampling,
-				onSwpchnOod);
+				dst.outlineMode, onSwpchnOod);
 			buildPipelines();
 		} { // Assign and adjust everything that depends on the render pass
 			dst.sdlCtx = {
@@ -668,6 +887,8 @@ namespace {
 			dst.dPoolOutOfDate = true;
 
 			set_static_ubo(dst.rpass, opts);
+			if(! dst.materials.empty()) {
+				dst.rpass.setMaterialTable(dst.materials); }
 		}
 	}
 
@@ -695,6 +916,17 @@ namespace {
 	}
 
 
+	/** Marks an object as modified, so that its instance will be
+	 * reassembled and uploaded before the next frame is drawn. */
+	void mark_dirty(RenderContext& ctx, size_t objIdx) {
+		auto& obj = ctx.objects[objIdx];
+		if(! obj.dirty) {
+			obj.dirty = true;
+			ctx.dirtyObjects.push_back(objIdx);
+		}
+	}
+
+
 	Object* try_mk_object_info(
 			Application& app, const vka2::MeshInstance::ObjSources& src,
 			RenderContext& dst, const vka2::Scene::Object& objInfo,
@@ -715,12 +947,17 @@ namespace {
 					MeshInstance::fromObj(app, src, found->mergeVertices, &dst.meshCache, &dst.textureCache),
 					dst.dPool
 				),
-				.position = glm::vec3(objInfo.position[0], objInfo.position[1], objInfo.position[2]),
-				.orientation = glm::vec3(objInfo.orientation[0], objInfo.orientation[1], objInfo.orientation[2]),
-				.scale = glm::vec3(objInfo.scale[0], objInfo.scale[1], objInfo.scale[2]),
 				.color = glm::vec4(objInfo.color[0], objInfo.color[1], objInfo.color[2], objInfo.color[3]),
-				.rnd = dst.rngDistr(dst.rng)
+				.rnd = dst.rngDistr(dst.rng),
+				.materialIndex = push_const::Object::noMaterial,
+				.lodBias = found->lodBias,
+				.dirty = false
 			}));
+			dst.transforms.push_back(
+				glm::vec3(objInfo.position[0], objInfo.position[1], objInfo.position[2]),
+				glm::vec3(objInfo.orientation[0], objInfo.orientation[1], objInfo.orientation[2]),
+				glm::vec3(objInfo.scale[0], objInfo.scale[1], objInfo.scale[2]) );
+			mark_dirty(dst, dst.objects.size() - 1);
 			return &dst.objects.back();
 		}
 	}
@@ -738,15 +975,20 @@ namespace {
 
 	void destroy_render_ctx(RenderContext& ctx) {
 		destroy_render_ctx_rpass(ctx);
+		ctx.instances.destroy();
 	}
 
 
 	void sync_desc_sets(RenderContext& ctx) {
-		if(ctx.dPoolOutOfDate) {
+		// Growing the model UBO ring replaces its buffer, which every mesh descriptor refers to
+		auto modelUboGeneration = ctx.rpass.swapchain()->application->modelUboRing().generation();
+		if(ctx.dPoolOutOfDate || (ctx.modelUboGeneration != modelUboGeneration)) {
 			for(auto& obj : ctx.objects) {
 				obj.meshWrapper->updateDescriptorSet(obj.meshWrapper.descSet());
 			}
 			ctx.dPoolOutOfDate = false;
+			ctx.modelUboGeneration = modelUboGeneration;
+			ctx.rpass.invalidateCommandBuffers(); // Recorded commands refer to the old descriptors
 		}
 	}
 
@@ -754,10 +996,13 @@ namespace {
 	void load_assets(Application& app, RenderContext& dst) {
 		static_assert(ubo::Model::set == Texture::samplerDescriptorSet);
 		std::map<std::string, Scene::Material*> mtlInfoMap;
+		std::map<std::string, uint32_t> mtlIndexMap;
 		std::string assetPath = get_asset_path();
 		auto& worldOpts = app.options().worldParams;
 		Scene scene;
+		PERF_SCOPE("app.loadAssets")
 		{ // Load the scene
+			PERF_SCOPE("scene")
 			std::string scenePath = assetPath + "/scene.cfg";
 			util::logDebug() << "Reading scene from \"" << scenePath << '"' << util::endl;
 			scene = Scene::fromCfg(scenePath);
@@ -770,13 +1015,29 @@ namespace {
 					<< mtlInfo.shininess << ", " << mtlInfo.celLevels << ')' << util::endl;
 				mtlInfoMap[mtlInfo.name] = &mtlInfo;
 			}
+		} { // Build the material table, shared by all objects
+			dst.materials.clear();
+			dst.materials.reserve(scene.materials.size());
+			for(auto& mtlInfo : scene.materials) {
+				mtlIndexMap[mtlInfo.name] = dst.materials.size();
+				dst.materials.push_back(ssbo::MaterialTable::Entry {
+					.ambient = mtlInfo.ambient,
+					.diffuse = mtlInfo.diffuse,
+					.specular = mtlInfo.specular,
+					.shininess = mtlInfo.shininess,
+					.rnd = dst.rngDistr(dst.rng),
+					.celLevels = mtlInfo.celLevels });
+			}
+			if(! dst.materials.empty()) {
+				dst.rpass.setMaterialTable(dst.materials); }
 		} { // Set the point light
-			dst.pointLight = glm::vec4 {
+			dst.initialState.pointLight = glm::vec4 {
 				scene.pointLight[0],
 				scene.pointLight[1],
 				scene.pointLight[2],
 				scene.pointLight[3] };
 		} { // Create objects
+			PERF_SCOPE("objects")
 			for(auto& objInfo : scene.objects) {
 				MeshInstance::ObjSources src;
 				if(objInfo.materialName.empty()) {
@@ -820,6 +1081,7 @@ namespace {
 				if(newObj != nullptr) {
 					auto matInfo = mtlInfoMap.find(src.materialName);
 					assert(matInfo != mtlInfoMap.end());
+					newObj->materialIndex = mtlIndexMap.at(src.materialName);
 					newObj->meshWrapper->viewUbo([&dst, &matInfo](MemoryView<ubo::Model> ubo) {
 						*ubo.data = ubo::Model {
 							.ambient = matInfo->second->ambient,
@@ -857,64 +1119,68 @@ namespace {
 			constexpr unsigned mod = std::numeric_limits<unsigned>::max();
 			return static_cast<float>(static_cast<unsigned>(ctx.rng()) % mod) / mod;
 		};
-		const Object& clonee = [&ctx]() -> const Object& {
-			return ctx.objects[ctx.rng() % ctx.objects.size()];
-		} ();
+		size_t cloneeIdx = ctx.rng() % ctx.objects.size();
+		const Object& clonee = ctx.objects[cloneeIdx];
+		glm::vec3 cloneePosition = ctx.transforms.position(cloneeIdx);
+		glm::vec3 cloneeOrientation = ctx.transforms.orientation(cloneeIdx);
 		ctx.objects.push_back(Object {
 			.meshWrapper = MeshWrapper(*clonee.meshWrapper, ctx.dPool),
-			.position = glm::vec3(
-				clonee.position.x + (floatRnd() * 4.0f),
-				clonee.position.y + (floatRnd() * 4.0f),
-				clonee.position.z + (floatRnd() * 4.0f) ),
-			.orientation = glm::vec3(
-				clonee.orientation.x + (floatRnd() * 15.0f),
-				clonee.orientation.x + (floatRnd() * 15.0f),
-				clonee.orientation.x + (floatRnd() * 15.0f) ),
-			.scale = clonee.scale,
 			.color = clonee.color,
-			.rnd = floatRnd()
+			.rnd = floatRnd(),
+			.materialIndex = clonee.materialIndex,
+			.lodBias = clonee.lodBias,
+			.dirty = false
 		});
+		ctx.transforms.push_back(
+			glm::vec3(
+				cloneePosition.x + (floatRnd() * 4.0f),
+				cloneePosition.y + (floatRnd() * 4.0f),
+				cloneePosition.z + (floatRnd() * 4.0f) ),
+			glm::vec3(
+				cloneeOrientation.x + (floatRnd() * 15.0f),
+				cloneeOrientation.x + (floatRnd() * 15.0f),
+				cloneeOrientation.x + (floatRnd() * 15.0f) ),
+			ctx.transforms.scale(cloneeIdx) );
+		mark_dirty(ctx, ctx.objects.size() - 1);
 		ctx.dPoolOutOfDate = true;
+		ctx.rpass.invalidateCommandBuffers();
 	}
 
 
-	void process_input(
-			RenderContext& ctx, glm::mat4& orientationMat
-	) {
-		constexpr auto rad360 = glm::radians(360.0f);
-		{ // Modify the current orientation based on the input state
-			float adjustedTurnSpeed = ctx.ctrlCtx.speedMod?
-				ctx.turnSpeedKeyMod : ctx.turnSpeedKey;
-			glm::vec2 actualRotate = {
-				ctx.ctrlCtx.rotate.x,
-				ctx.ctrlCtx.rotate.y * YAW_TO_PITCH_RATIO };
-			ctx.orientation += adjustedTurnSpeed * actualRotate * ctx.frameTiming.frameTime;
-			ctx.orientation.x -= std::floor(ctx.orientation.x / rad360) * rad360;
-			ctx.orientation.y -= std::floor(ctx.orientation.y / rad360) * rad360;
-		} { // Rotate the orientation matrix
-			orientationMat = glm::rotate(orientationMat,
-				ctx.orientation.y,
-				glm::vec3(1.0f, 0.0f, 0.0f));
-			orientationMat = glm::rotate(orientationMat,
-				ctx.orientation.x,
-				glm::vec3(0.0f, 1.0f, 0.0f));
-		} { // Change the current position based on the orientation
-			float adjustedMoveSpeed = ctx.ctrlCtx.speedMod?
-				ctx.moveSpeedMod : ctx.moveSpeed;
-			glm::vec3 deltaPos = adjustedMoveSpeed * ctx.frameTiming.frameTime *
-				(ctx.ctrlCtx.fwdMoveVector - ctx.ctrlCtx.bcwMoveVector);
-			glm::vec4 deltaPosRotated = glm::transpose(orientationMat) * glm::vec4(deltaPos, 1.0f);
-			if(ctx.ctrlCtx.movePointLightMod) {
-				ctx.pointLight -= glm::vec4(deltaPosRotated.x, deltaPosRotated.y, deltaPosRotated.z, 0.0f);
-			} else {
-				ctx.position -= glm::vec3(deltaPosRotated);
-			}
+	/** Hands the input state over to the simulation, and returns the
+	 * simulated state to be rendered; requests that involve the device
+	 * are served on the calling thread. */
+	SimState process_input(RenderContext& ctx) {
+		{ // Forward the input state to the simulation
+			ctx.sim.setInput(ctx.ctrlCtx);
 		} { // Create an object, if requested
 			if(ctx.ctrlCtx.createObj) {
 				create_object(ctx);
 				ctx.ctrlCtx.createObj = false;
 			}
 		}
+		return ctx.sim.sample();
+	}
+
+
+	bool try_change_outline_mode(
+			Application& app, const Options& opts,
+			RenderContext& ctx
+	) {
+		if(ctx.ctrlCtx.toggleOutlineMode) {
+			using Mode = RenderPass::OutlineMode;
+			ctx.outlineMode = (ctx.rpass.outlineMode() == Mode::eMesh)? Mode::eScreenSpace : Mode::eMesh;
+			util::logVkEvent() << "Using "
+				<< ((ctx.outlineMode == Mode::eMesh)? "mesh " : "screen space ")
+				<< "outlines" << util::endl;
+			// The depth attachment's usage and the subpass dependencies change with the mode
+			destroy_render_ctx_rpass(ctx);
+			create_render_ctx_rpass(app, ctx, opts);
+			ctx.ctrlCtx.toggleOutlineMode = false;
+			return true;
+		} else {
+			return false;
+		}
 	}
 
 
@@ -935,46 +1201,128 @@ namespace {
 	}
 
 
-	void mk_instances(
-			RenderPass& rpass,
-			const std::vector<Object>& objects,
-			DeviceVector<Instance>& dst
+	/** Reassembles the instances of the objects marked as dirty, and
+	 * returns the ranges of instances that have been modified.
+	 *
+	 * Close dirty instances are assembled together in contiguous ranges,
+	 * which are written directly to the frame vector's host memory. */
+	std::vector<InstanceRange> mk_instances(
+			std::vector<Object>& objects,
+			const TransformStore& transforms,
+			std::vector<size_t>& dirtyObjects,
+			FrameVector<Instance>& dst
 	) {
-		size_t i = 0;
+		assert(transforms.size() == objects.size());
 		if(dst.size() != objects.size()) {
-			dst.resize(&rpass, objects.size());
+			dst.resize(objects.size()); }
+		return assembleInstances(transforms, dirtyObjects, INSTANCE_FLUSH_MERGE_GAP, dst.data(),
+			[&objects](size_t i, Instance& inst) {
+				Object& obj = objects[i];
+				inst.colorMul = obj.color;
+				inst.rnd = obj.rnd;
+				obj.dirty = false;
+			});
+	}
+
+
+	/** Fills and sorts the draw streams of both subpasses: objects are
+	 * drawn roughly front to back, by the distance of their origin from
+	 * the view, so that hidden fragments are rejected by the depth test
+	 * before the fragment shader runs on them.
+	 * @returns Whether the order differs from the previous one. */
+	bool mk_draw_streams(RenderContext& ctx, const glm::vec3& viewPos) {
+		const size_t count = ctx.objects.size();
+		const std::array<const Pipeline*, 2> pipelines = { &ctx.mainPipeline, &ctx.outlinePipeline };
+		bool changed = false;
+		ctx.drawDistances.resize(count);
+		ctx.transforms.sqrDistances(viewPos, ctx.drawDistances.data());
+		for(unsigned s=0; s < ctx.drawStreams.size(); ++s) {
+			auto& stream = ctx.drawStreams[s];
+			stream.clear();
+			if((s == 1) && (ctx.rpass.outlineMode() == RenderPass::OutlineMode::eScreenSpace)) {
+				continue; } // Outlines are drawn with a single fullscreen triangle
+			for(size_t i=0; i < count; ++i) {
+				const Object& obj = ctx.objects[i];
+				stream.push(DrawStream::Draw {
+					.pipeline = pipelines[s]->handle(),
+					.mesh = (*obj.meshWrapper).get(),
+					.descSet = obj.meshWrapper.descSet(),
+					.objConst = {
+						.instanceIndex = uint32_t(i),
+						.materialIndex = obj.materialIndex,
+						.lodBias = obj.lodBias }
+				}, util::float_sort_key(ctx.drawDistances[i]));
+			}
+			changed = stream.sort() || changed;
 		}
-		for(const auto& obj : objects) {
-			auto timer = util::perfTracker.startTimer("app.assembleInstance");
-			Instance& inst = dst[i];
-			inst.modelTransf = glm::mat4(1.0f);
-			inst.modelTransf = glm::translate(inst.modelTransf, obj.position);
-			inst.modelTransf = glm::rotate(inst.modelTransf,
-				glm::radians(obj.orientation.y), glm::vec3(1.0f, 0.0f, 0.0f));
-			inst.modelTransf = glm::rotate(inst.modelTransf,
-				glm::radians(obj.orientation.x), glm::vec3(0.0f, 1.0f, 0.0f));
-			inst.modelTransf = glm::rotate(inst.modelTransf,
-				glm::radians(obj.orientation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-			inst.modelTransf = glm::scale(inst.modelTransf, obj.scale);
-			inst.colorMul = obj.color;
-			inst.rnd = obj.rnd;
-			++i;
-			util::perfTracker.stopTimer(timer);
+		return changed;
+	}
+
+
+	/** The state to be rendered at the given frame of a benchmark, in place
+	 * of the simulated one: the view turns around once over the whole run
+	 * while swaying sideways, so that objects are drawn from different
+	 * distances and in different orders, the same way on every run. */
+	SimState mk_benchmark_sim_state(const RenderContext& ctx, unsigned long frame, unsigned long frameCount) {
+		constexpr auto rad360 = glm::radians(360.0f);
+		float t = static_cast<float>(frame) / static_cast<float>(std::max<unsigned long>(frameCount, 1));
+		SimState r = ctx.initialState;
+		r.orientation.x += rad360 * t;
+		r.position.x += std::sin(rad360 * t) * ctx.simParams.moveSpeed;
+		r.timeNs = 0;
+		return r;
+	}
+
+
+	/** Writes a BGRA image read back from an offscreen swapchain as a
+	 * binary PPM, which needs no library to be produced or compared. */
+	void write_ppm(const std::string& path, const vk::Extent2D& ext, const std::vector<uint8_t>& bgra) {
+		assert(bgra.size() == size_t(ext.width) * size_t(ext.height) * 4);
+		std::ofstream out = std::ofstream(path, std::ios::binary | std::ios::trunc);
+		out << "P6\n" << ext.width << ' ' << ext.height << "\n255\n";
+		std::vector<char> row;
+		row.resize(size_t(ext.width) * 3);
+		for(size_t y=0; y < ext.height; ++y) {
+			const uint8_t* src = bgra.data() + (y * ext.width * 4);
+			for(size_t x=0; x < ext.width; ++x) {
+				row[(x*3) + 0] = src[(x*4) + 2];
+				row[(x*3) + 1] = src[(x*4) + 1];
+				row[(x*3) + 2] = src[(x*4) + 0];
+			}
+			out.write(row.data(), row.size());
 		}
-		assert(i == objects.size());
+		if(! out) {
+			throw std::runtime_error("failed to write the frame to \""s + path + "\""s); }
+		util::logGeneral() << "Frame written to \"" << path << '"' << util::endl;
+	}
+
+
+	/** Traces written while running are named after the frame
+	 * they end with, e.g. "trace.json" -> "trace.frame123.json". */
+	std::string mk_trace_dump_path(const std::string& path, unsigned long frame) {
+		constexpr std::string_view ext = ".json";
+		std::string stem = path;
+		if(stem.size() >= ext.size() && (0 == stem.compare(stem.size() - ext.size(), ext.size(), ext))) {
+			stem.resize(stem.size() - ext.size()); }
+		return stem + ".frame" + std::to_string(frame) + ".json";
+	}
+
+
+	void write_trace(const perf::SpanRecorder& spans, const std::string& path) {
+		spans.writeChromeTrace(path);
+		util::logGeneral() << "Trace of " << spans.size() << " spans written to \"" << path << '"' << util::endl;
 	}
 
 
 	void mk_frame_ubo(
 			RenderContext& ctx,
-			const glm::mat4& orientationMat,
+			const SimState& state,
 			ubo::Frame& dst
 	) {
-		dst.viewTransf = glm::mat4(1.0f);
-		dst.viewTransf = orientationMat * dst.viewTransf;
-		dst.viewTransf = glm::translate(dst.viewTransf, -ctx.position);
-		dst.viewPos = ctx.position;
-		dst.pointLight = ctx.pointLight;
+		dst.viewTransf = mk_orientation_mat(state.orientation);
+		dst.viewTransf = glm::translate(dst.viewTransf, -state.position);
+		dst.viewPos = state.position;
+		dst.pointLight = state.pointLight;
 		dst.lightDirection = ctx.lightDirection;
 		dst.pack0 = ctx.ctrlCtx.shaderSelector << 16;
 		dst.rnd = ctx.rngDistr(ctx.rng);
@@ -989,21 +1337,36 @@ namespace vka2 {
 	/* This is the God function. It still needs to be compartmentalized,
 	 * so documenting this mess isn't worth my time since it's going
 	 * to be torn down in the near future - I'll document it then. */
-	void Application::run() {
+	bool Application::run() {
 		using glm::vec2;
 		using glm::vec3;
 		using glm::vec4;
 		using glm::mat4;
 		const auto& opts = _data.options;
+		const bool benchmark = _data.launchParams.benchmark();
+		// Benchmarks run a few more frames than requested, see BENCHMARK_WARMUP_FRAMES
+		const unsigned long frameLimit = (_data.launchParams.frameLimit == 0)? 0 :
+			_data.launchParams.frameLimit + (benchmark? BENCHMARK_WARMUP_FRAMES : 0);
+		bool success = true;
 		RenderContext ctx = { };
-		std::vector<push_const::Object> objPushConsts;
 		create_render_ctx(*this, ctx, opts);
 		load_assets(*this, ctx);
-		util::TimeGateNs timer;
+		if(! benchmark) {
+			// Benchmarks follow a script instead, which only depends on the frame number
+			ctx.sim.start(ctx.initialState, ctx.simParams, ctx.simTimeStep); }
+		util::FramePacer pacer = util::FramePacer(
+			ctx.frameTiming.frameTime, pacing_mode_from_str(opts.viewParams.framePacing));
 		util::PerfTracker perfTracker;
 		perfTracker.movingAverageDecay =
 		util::perfTracker.movingAverageDecay = ctx.frameTiming.frameTime / 30.0f;
-		double sleepTime = ctx.frameTiming.frameTime / MAX_SLEEPS_PER_FRAME;
+		std::unique_ptr<perf::SpanRecorder> spans;
+		const auto traceThresholdNs = static_cast<perf::PerfTracker::utime_t>(
+			_data.launchParams.traceThresholdMs * 1'000'000.0);
+		unsigned long nextTraceDumpFrame = 0;
+		if(! _data.launchParams.tracePath.empty()) {
+			spans = std::make_unique<perf::SpanRecorder>(TRACE_SPAN_CAPACITY);
+			perf::SpanRecorder::setActive(spans.get());
+		}
 		bool shouldClose = false;
 		{
 			{
@@ -1014,99 +1377,213 @@ namespace vka2 {
 					util::logDebug() << "Rendering " << vtxCount << " vertices each frame" << util::endl;
 				}
 				while(! shouldClose) {
-					auto frameTimer = perfTracker.startTimer("app.frame");
+					auto frameTimer = perfTracker.startTimer(PERF_ID("app.frame"));
+					perfTracker.measure(PERF_ID("app.sleepTime"), [&pacer, benchmark]() {
+						if(! benchmark)  pacer.waitForFrame();
+					});
 
-					mat4 orientationMat = mat4(1.0f);
-					perfTracker.measure("app.userInput", [&]() {
-						process_input(ctx, orientationMat);
+					SimState simState;
+					perfTracker.measure(PERF_ID("app.userInput"), [&]() {
+						simState = benchmark?
+							mk_benchmark_sim_state(ctx, ctx.frameCounter, frameLimit) :
+							process_input(ctx);
 					});
 
 					if(try_change_fullscreen(*this, opts, ctx)) {
 						continue; }
+					if(try_change_outline_mode(*this, opts, ctx)) {
+						continue; }
 					ubo::Frame frameUbo;
-					perfTracker.measure("app.assembleFrameUbo", [&]() {
-						mk_frame_ubo(ctx, orientationMat, frameUbo);
-					});
-					perfTracker.measure("app.assembleInstances", [&]() {
-						mk_instances(ctx.rpass, ctx.objects, ctx.instances);
+					perfTracker.measure(PERF_ID("app.assembleFrameUbo"), [&]() {
+						mk_frame_ubo(ctx, simState, frameUbo);
 					});
-					perfTracker.measure("app.flushInstanceBuffer", [&]() {
-						ctx.instances.flush();
+					perfTracker.measure(PERF_ID("app.assembleInstances"), [&]() {
+						ctx.instances.markModified(mk_instances(
+							ctx.objects, ctx.transforms, ctx.dirtyObjects, ctx.instances));
 					});
 					sync_desc_sets(ctx);
+					perfTracker.measure(PERF_ID("app.sortDraws"), [&]() {
+						if(mk_draw_streams(ctx, simState.position)) {
+							ctx.rpass.invalidateCommandBuffers(); } // Recorded commands draw in the old order
+					});
 
-					auto draw = [&ctx, &perfTracker](
+					vk::Buffer instanceBuffer; // The slot used by the frame being recorded
+					auto syncInstances = [&ctx, &perfTracker, &instanceBuffer](RenderPass::FrameHandle& fh) {
+						perfTracker.measure(PERF_ID("app.syncInstanceBuffer"), [&]() {
+							instanceBuffer = ctx.instances.syncSlot(fh.imageIndex).handle;
+						});
+						auto& recorded = ctx.recordedInstanceBuffers;
+						if(recorded.size() <= fh.imageIndex) {
+							recorded.resize(fh.imageIndex + 1, nullptr); }
+						if(recorded[fh.imageIndex] != instanceBuffer) {
+							// The slot has been reallocated, and reused command buffers would bind the old one
+							recorded[fh.imageIndex] = instanceBuffer;
+							fh.rpass.invalidateCommandBuffers();
+						}
+					};
+					DrawStream::Stats drawStats = { }; // Summed over both subpasses
+					auto recordStream = [&perfTracker, &instanceBuffer, &drawStats](
 							RenderPass::FrameHandle& fh, vk::CommandBuffer cmd,
-							const Object& obj, uint32_t instanceIdx
+							const DrawStream& stream
 					) {
-						auto timer = perfTracker.startTimer("app.drawCmd");
-						cmd.bindVertexBuffers(0, obj.meshWrapper->vtxBuffer().handle, { 0 });
-						cmd.bindVertexBuffers(1, ctx.instances.devBuffer().handle, { 0 });
-						cmd.bindIndexBuffer(obj.meshWrapper->idxBuffer().handle,
-							0, Vertex::INDEX_TYPE);
-						fh.bindMeshDescriptorSet(cmd, obj.meshWrapper.descSet());
-						cmd.drawIndexed(obj.meshWrapper->idxCount(), 1, 0, 0, instanceIdx);
+						auto timer = perfTracker.startTimer(PERF_ID("app.drawCmd"));
+						auto stats = stream.record(fh, cmd, instanceBuffer);
+						drawStats.draws += stats.draws;
+						drawStats.bindsIssued += stats.bindsIssued;
+						drawStats.bindsSkipped += stats.bindsSkipped;
 						perfTracker.stopTimer(timer);
 					};
-					ctx.rpass.runRenderPass(frameUbo, { }, { }, {
+					ctx.rpass.runRenderPass(frameUbo, syncInstances, { }, {
 						std::function([&](RenderPass::FrameHandle& fh, vk::CommandBuffer cmd) {
 							assert(ctx.instances.size() == ctx.objects.size());
-							auto timer = perfTracker.startTimer("app.runSubpass0");
-							cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, ctx.mainPipeline.handle());
-							for(size_t i=0; i < ctx.objects.size(); ++i) {
-								draw(fh, cmd, ctx.objects[i], i); }
+							auto timer = perfTracker.startTimer(PERF_ID("app.runSubpass0"));
+							recordStream(fh, cmd, ctx.drawStreams[0]);
 							perfTracker.stopTimer(timer);
 						}),
 						std::function([&](RenderPass::FrameHandle& fh, vk::CommandBuffer cmd) {
 							assert(ctx.instances.size() == ctx.objects.size());
-							auto timer = perfTracker.startTimer("app.runSubpass1");
-							cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, ctx.outlinePipeline.handle());
-							for(size_t i=0; i < ctx.objects.size(); ++i) {
-								draw(fh, cmd, ctx.objects[i], i); }
+							auto timer = perfTracker.startTimer(PERF_ID("app.runSubpass1"));
+							if(ctx.rpass.outlineMode() == RenderPass::OutlineMode::eScreenSpace) {
+								// Every outline comes from the depth attachment at once
+								cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, ctx.outlinePipeline.handle());
+								cmd.draw(3, 1, 0, 0);
+							} else {
+								recordStream(fh, cmd, ctx.drawStreams[1]);
+							}
 							perfTracker.stopTimer(timer);
 						})
 					});
-
-					{ // Framerate throttle
-						auto timeMul = decltype(timer)::period_t::den / decltype(timer)::period_t::num;
-						decltype(timer)::precision_t frameTimeUnits = ctx.frameTiming.frameTime * timeMul;
-						while(! timer.forward(frameTimeUnits)) {
-							perfTracker.measure("app.sleepTime", [](decltype(sleepTime) sleepTime) {
-								util::sleep_s(sleepTime);
-							}, sleepTime);
-						}
+					if(drawStats.draws > 0) {
+						// Only frames that have been recorded count, reused command buffers issue no binds
+						perfTracker.record(PERF_ID("app.bindsIssued"), drawStats.bindsIssued);
+						perfTracker.record(PERF_ID("app.bindsSkipped"), drawStats.bindsSkipped);
 					}
-					++ctx.frameCounter;
-					perfTracker.stopTimer(frameTimer);
 
-					poll_events(ctx, shouldClose);
+					pacer.endFrame();
+					++ctx.frameCounter;
+					auto frameNs = perfTracker.stopTimer(frameTimer);
+					perf::collector().collect(); // Worker threads hand their records over lazily, see perf::ThreadTracker
+
+					if(spans) { // Write a trace if requested, or if this frame hitched
+						bool hitch =
+							(traceThresholdNs > 0) && (frameNs > traceThresholdNs) &&
+							(ctx.frameCounter >= nextTraceDumpFrame);
+						if(hitch || ctx.ctrlCtx.dumpTrace) {
+							write_trace(*spans, mk_trace_dump_path(_data.launchParams.tracePath, ctx.frameCounter)); }
+						if(hitch) {
+							nextTraceDumpFrame = ctx.frameCounter + TRACE_DUMP_COOLDOWN_FRAMES; }
+					} else if(ctx.ctrlCtx.dumpTrace) {
+						util::logGeneral() << "Tracing is disabled, launch with \"--trace PATH\" to enable it" << util::endl;
+					}
+					ctx.ctrlCtx.dumpTrace = false;
+
+					if(! _data.launchParams.headless) {
+						poll_events(ctx, shouldClose); } // There are no events without a window
+					if(frameLimit > 0) {
+						shouldClose = shouldClose || (ctx.frameCounter >= frameLimit); }
+					if(benchmark && (ctx.frameCounter == BENCHMARK_WARMUP_FRAMES)) {
+						perfTracker.reset();
+						util::perfTracker.reset();
+						perf::collector().reset();
+						util::logGeneral() << "Benchmark warm-up done, measuring "
+							<< _data.launchParams.frameLimit << " frames" << util::endl;
+					}
 				}
 			}
 		}
+		if(! _data.launchParams.readbackPath.empty()) {
+			auto lastFrame = ctx.rpass.readbackLastImage();
+			if(lastFrame.empty()) {
+				util::logError() << "No frame has been rendered, nothing to read back" << util::endl;
+			} else {
+				write_ppm(_data.launchParams.readbackPath, ctx.rpass.swapchain()->data.extent, lastFrame);
+			}
+		}
+		ctx.sim.stop();
 		destroy_render_ctx(ctx);
+		if(spans) { // No other thread can be recording spans at this point
+			perf::SpanRecorder::setActive(nullptr);
+			write_trace(*spans, _data.launchParams.tracePath);
+		}
+		{
+			auto jitter = pacer.jitter();
+			util::logGeneral()
+				<< "Frame pacing over " << jitter.frames << " frames: interval error "
+				<< (jitter.meanErrorNs / 1000.0) << "us avg, "
+				<< (jitter.stdDevNs / 1000.0) << "us stddev, "
+				<< (jitter.maxErrorNs / 1000.0) << "us max; sleep overshoot "
+				<< (jitter.sleepOvershootNs / 1000.0) << "us" << util::endl;
+		}
 		#ifdef ENABLE_PERF_TRACKER
 		{
 			util::perfTracker |= perfTracker;
 			perfTracker.reset();
-			#define PRINT_TIME_(NM_) {\
+			perf::threadTracker().publish();
+			util::perfTracker |= perf::collector().collect();
+			// Some timers may never run, e.g. `rpass.present` when headless
+			#define PRINT_TIME_(NM_) if(util::perfTracker.has(NM_)) {\
 				util::logGeneral() << "[Timer `" NM_ "`] " \
 					<< nanosToMicrosStr(util::perfTracker.ns(NM_)) << "us" << util::endl; \
 			}
 			PRINT_TIME_("app.frame")
 			PRINT_TIME_("app.assembleFrameUbo")
-			PRINT_TIME_("app.assembleInstance")
 			PRINT_TIME_("app.assembleInstances")
+			PRINT_TIME_("app.sortDraws")
 			PRINT_TIME_("app.sleepTime")
-			PRINT_TIME_("app.flushInstanceBuffer")
+			PRINT_TIME_("app.syncInstanceBuffer")
 			PRINT_TIME_("app.userInput")
 			PRINT_TIME_("app.drawCmd")
 			PRINT_TIME_("rpass.acquireImage")
 			PRINT_TIME_("rpass.recordCmd")
 			PRINT_TIME_("rpass.submitCmd")
 			PRINT_TIME_("rpass.present")
+			PRINT_TIME_("gpu.subpass0")
+			PRINT_TIME_("gpu.subpass1")
+			PRINT_TIME_("gpu.blit")
+			PRINT_TIME_("gpu.frame")
+			PRINT_TIME_("app.loadAssets")
+			PRINT_TIME_("app.buildPipeline")
+			PRINT_TIME_("sim.step")
 			#undef PRINT_TIME
+			#define PRINT_VALUE_(NM_) if(util::perfTracker.has(NM_)) {\
+				util::logGeneral() << "[Value `" NM_ "`] " \
+					<< util::perfTracker.value(NM_) << util::endl; \
+			}
+			PRINT_VALUE_("app.bindsIssued")
+			PRINT_VALUE_("app.bindsSkipped")
+			PRINT_VALUE_("gpu.subpass0.iaPrimitives")
+			PRINT_VALUE_("gpu.subpass0.vsInvocations")
+			PRINT_VALUE_("gpu.subpass0.clipPrimitives")
+			PRINT_VALUE_("gpu.subpass0.fsInvocations")
+			PRINT_VALUE_("gpu.subpass1.iaPrimitives")
+			PRINT_VALUE_("gpu.subpass1.vsInvocations")
+			PRINT_VALUE_("gpu.subpass1.clipPrimitives")
+			PRINT_VALUE_("gpu.subpass1.fsInvocations")
+			#undef PRINT_VALUE_
 		}
+		if(benchmark) { // Write the report, and compare it with the baseline
+			auto report = util::BenchReport::fromTracker(util::perfTracker, _data.launchParams.frameLimit);
+			report.writeFile(_data.launchParams.benchmarkReport);
+			util::logGeneral() << "Benchmark report written to \""
+				<< _data.launchParams.benchmarkReport << '"' << util::endl;
+			if(! _data.launchParams.benchmarkBaseline.empty()) {
+				auto baseline = util::BenchReport::fromFile(_data.launchParams.benchmarkBaseline);
+				auto regressions = report.compare(baseline, _data.launchParams.benchmarkTolerance);
+				for(const auto& reg : regressions) {
+					util::logError() << "[Regression `" << reg.id << "`] " << reg.stat << ' '
+						<< reg.baseline << " -> " << reg.current << util::endl; }
+				success = regressions.empty();
+				util::logGeneral() << "Benchmark compared to \"" << _data.launchParams.benchmarkBaseline << "\": "
+					<< regressions.size() << " regressions" << util::endl;
+			}
+		}
+		#else
+			if(benchmark) { // Unreachable through the command line, which rejects "--benchmark"
+				util::logError() << "Benchmarks require ENABLE_PERF_TRACKER" << util::endl;
+				success = false;
+			}
 		#endif
+		return success;
 	}
 
 }
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
 
 
@@ -45,25 +46,61 @@ namespace vka2 {
 
 		constexpr const char* CONFIG_FILE = "params.cfg";
 
+		/** Where compiled pipelines are cached across runs; the file
+		 * is discarded if it was created by another device or driver. */
+		constexpr const char* PIPELINE_CACHE_FILE = "pipeline.cache";
+
 		constexpr const char* SHADER_PATH_ENV_VAR_NAME = "VKA2_SHADER_PATH";
 		constexpr const char* ASSET_PATH_ENV_VAR_NAME = "VKA2_ASSET_PATH";
 
+		/** The manifest of the null Vulkan driver, used by "--null-device";
+		 * relative paths are resolved against the CWD. */
+		constexpr const char* NULL_DEVICE_ICD_ENV_VAR_NAME = "VKA2_NULL_DEVICE_ICD";
+		constexpr const char* NULL_DEVICE_ICD_DEFAULT = "nulldev/vkapp2_nulldev.json";
+
 		constexpr std::array<uint8_t, 4> MISSING_TEXTURE_COLOR = { 0xFF, 0xFF, 0xFF, 0xFF };
 
 		constexpr float LINE_WIDTH = 1.0f;
 
 		constexpr float YAW_TO_PITCH_RATIO = 2.0f / 3.0f;
 
-		/** The main thread has to sleep for an arbitrary amount of time
-		 * in order to throttle the frame rate: it is computed as
-		 * `frametime / MAX_SLEEPS_PER_FRAME`, and it's ideally slightly higher
-		 * than an integer number in order to account for non-deterministic
-		 * inaccuracies.
-		 *
-		 * Higher numbers result in more precise frame times, but causes
-		 * the main thread to trigger more context switches: one thread sleep
-		 * has a very approximate overhead of 80 microseconds. */
-		constexpr float MAX_SLEEPS_PER_FRAME = 5.05f;
+		/** Ranges of modified instances are merged together when they are
+		 * separated by no more than this many unmodified instances: uploading
+		 * a few redundant instances is cheaper than recording another copy. */
+		constexpr unsigned INSTANCE_FLUSH_MERGE_GAP = 16;
+
+		/** The maximum number of separate ranges of modified instances that
+		 * are waiting to be copied to a frame's instance buffer; ranges in
+		 * excess are merged together. */
+		constexpr unsigned INSTANCE_FLUSH_MAX_RANGES = 4;
+
+		/** The minimum number of model matrices that justify handing them
+		 * to a worker thread: smaller ranges are not worth the overhead. */
+		constexpr unsigned TRANSFORM_PARALLEL_BATCH = 16384;
+
+		/** How many model UBOs fit in the application's UBO ring before
+		 * it has to grow, which requires the device to be idle. */
+		constexpr unsigned MODEL_UBO_RING_INITIAL_SLOTS = 64;
+
+		/** Benchmarks seed the RNG with this, so that every run
+		 * creates the same scene. */
+		constexpr unsigned BENCHMARK_RNG_SEED = 0x5EED;
+
+		/** How many frames a benchmark measures, unless specified. */
+		constexpr unsigned long BENCHMARK_DEFAULT_FRAMES = 1000;
+
+		/** Frames rendered before a benchmark starts measuring, so that
+		 * first-use costs (pipeline compilation, command buffer recording,
+		 * allocations) don't end up in the report. */
+		constexpr unsigned long BENCHMARK_WARMUP_FRAMES = 60;
+
+		/** How many timer spans a trace keeps; older ones are overwritten.
+		 * Each span takes 32 bytes, and a frame records a few dozen. */
+		constexpr size_t TRACE_SPAN_CAPACITY = 1 << 16;
+
+		/** Frames that must pass after a trace is written because of a
+		 * slow frame, before another slow frame can write one. */
+		constexpr unsigned long TRACE_DUMP_COOLDOWN_FRAMES = 300;
 
 	}
 
@@ -99,8 +99,15 @@ namespace vka2 {
 			#define SPIRV_ALIGNED(_T) alignas(spirv::align<_T>) _T
 			#define ASSERT_SIZE(_T) static_assert(sizeof(_T) < MAX_PUSH_CONST_BYTES)
 
+			/** Per-draw data, pushed before every object is drawn. */
 			struct Object {
-				static constexpr bool unused = true;
+				static constexpr bool unused = false;
+				static constexpr vk::ShaderStageFlags stages =
+					vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+				static constexpr uint32_t noMaterial = UINT32_MAX; // Use the model UBO instead of the material table
+				SPIRV_ALIGNED(uint32_t)  instanceIndex; // The same as the draw's first instance
+				SPIRV_ALIGNED(uint32_t)  materialIndex; // Relative to ssbo::MaterialTable, or `noMaterial`
+				SPIRV_ALIGNED(float)     lodBias; // The material's, added to the sampler's LOD bias
 			};
 
 			ASSERT_SIZE(Object);
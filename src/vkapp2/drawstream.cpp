@@ -0,0 +1,117 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#include "vkapp2/drawstream.hpp"
+
+#include <algorithm>
+
+
+
+namespace vka2 {
+
+	void DrawStream::clear() {
+		draws_.clear();
+		pipelineIds_.clear(); // Pipelines may be rebuilt at any time, but there are few of them
+		std::swap(order_, prevOrder_);
+		order_.clear();
+	}
+
+
+	uint64_t DrawStream::_mk_key(const Draw& draw, uint32_t depthKey) {
+		constexpr auto mask = [](unsigned bits) { return (uint64_t(1) << bits) - 1; };
+		uint64_t pipelineId; {
+			auto found = std::find(pipelineIds_.begin(), pipelineIds_.end(), draw.pipeline);
+			pipelineId = found - pipelineIds_.begin();
+			if(found == pipelineIds_.end()) {
+				pipelineIds_.push_back(draw.pipeline); }
+		}
+		uint64_t meshId = meshIds_.try_emplace(draw.mesh, meshIds_.size()).first->second;
+		uint64_t layer = depthKey >> (32 - KEY_LAYER_BITS); // The sign and the exponent's high bits
+		return
+			((pipelineId & mask(KEY_PIPELINE_BITS)) << (KEY_LAYER_BITS + KEY_MESH_BITS + KEY_DEPTH_BITS)) |
+			((layer      & mask(KEY_LAYER_BITS))    << (KEY_MESH_BITS + KEY_DEPTH_BITS)) |
+			((meshId     & mask(KEY_MESH_BITS))     << KEY_DEPTH_BITS) |
+			(uint64_t(depthKey) & mask(KEY_DEPTH_BITS));
+	}
+
+
+	void DrawStream::push(const Draw& draw, uint32_t depthKey) {
+		order_.push_back({ _mk_key(draw, depthKey), uint32_t(draws_.size()) });
+		draws_.push_back(draw);
+	}
+
+
+	bool DrawStream::sort() {
+		util::radix_sort(order_, scratch_);
+		return ! std::equal(
+			order_.begin(), order_.end(),
+			prevOrder_.begin(), prevOrder_.end(),
+			[](const util::SortEntry& l, const util::SortEntry& r) { return l.index == r.index; } );
+	}
+
+
+	DrawStream::Stats DrawStream::record(
+			RenderPass::FrameHandle& fh, vk::CommandBuffer cmd,
+			vk::Buffer instanceBuffer
+	) const {
+		Stats r = { };
+		vk::Pipeline boundPipeline = nullptr;
+		const MeshInstance* boundMesh = nullptr;
+		const MeshInstance* boundDescMesh = nullptr;
+		auto countBind = [&r](bool issued) {
+			if(issued) ++ r.bindsIssued;
+			else       ++ r.bindsSkipped;
+			return issued;
+		};
+		if(! order_.empty()) {
+			cmd.bindVertexBuffers(1, instanceBuffer, { 0 });
+			++ r.bindsIssued;
+		}
+		for(const auto& entry : order_) {
+			const Draw& draw = draws_[entry.index];
+			const MeshInstance* mesh = draw.mesh;
+			if(countBind(draw.pipeline != boundPipeline)) {
+				cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, draw.pipeline);
+				boundPipeline = draw.pipeline;
+			}
+			if(countBind(mesh != boundMesh)) {
+				cmd.bindVertexBuffers(0, mesh->vtxBuffer().handle, { 0 }); }
+			if(countBind(mesh != boundMesh)) {
+				cmd.bindIndexBuffer(mesh->idxBuffer().handle, 0, Vertex::INDEX_TYPE);
+				boundMesh = mesh;
+			}
+			if(countBind(mesh != boundDescMesh)) {
+				fh.bindMeshDescriptorSet(cmd, draw.descSet, mesh->uboOffset());
+				boundDescMesh = mesh;
+			}
+			cmd.pushConstants<push_const::Object>(fh.rpass.pipelineLayout(),
+				push_const::Object::stages, 0, draw.objConst);
+			cmd.drawIndexed(mesh->idxCount(), 1, 0, 0, draw.objConst.instanceIndex);
+			++ r.draws;
+		}
+		return r;
+	}
+
+}
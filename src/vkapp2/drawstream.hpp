@@ -0,0 +1,97 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+
+#pragma once
+
+#include "vkapp2/graphics.hpp"
+#include "vkapp2/draw.hpp"
+
+#include <util/radixsort.hpp>
+
+#include <vector>
+#include <unordered_map>
+
+
+
+namespace vka2 {
+
+	/** Collects the draws of a subpass, sorts them by a 64-bit key and
+	 * records them, skipping binds that would not change any state.
+	 *
+	 * From the most to the least significant bits, the key holds the
+	 * pipeline, a coarse depth layer, the mesh and the exact depth:
+	 * draws are roughly front to back, while draws of the same mesh within
+	 * a depth layer are grouped together. Draws of the same mesh are
+	 * assumed to use descriptor sets with the same contents. */
+	class DrawStream {
+	public:
+		struct Draw {
+			vk::Pipeline pipeline;
+			const MeshInstance* mesh;
+			vk::DescriptorSet descSet;
+			push_const::Object objConst; // `instanceIndex` is also used as the draw's first instance
+		};
+
+		struct Stats {
+			size_t draws;
+			size_t bindsIssued;
+			size_t bindsSkipped;
+		};
+
+		static constexpr unsigned KEY_PIPELINE_BITS = 4;
+		static constexpr unsigned KEY_LAYER_BITS = 8;
+		static constexpr unsigned KEY_MESH_BITS = 20;
+		static constexpr unsigned KEY_DEPTH_BITS = 32;
+		static_assert(KEY_PIPELINE_BITS + KEY_LAYER_BITS + KEY_MESH_BITS + KEY_DEPTH_BITS == 64);
+
+		void clear();
+
+		/** Adds a draw; `depthKey` is usually `util::float_sort_key`
+		 * applied to the draw's (squared) distance from the view. */
+		void push(const Draw&, uint32_t depthKey);
+
+		/** Sorts the draws pushed since the last `clear`.
+		 * @returns Whether the draws are in a different order than the
+		 * previous time the stream was sorted, relative to the order they
+		 * were pushed in. */
+		bool sort();
+
+		/** Records the sorted draws, binding `instanceBuffer` as the
+		 * instance vertex buffer. */
+		Stats record(RenderPass::FrameHandle&, vk::CommandBuffer, vk::Buffer instanceBuffer) const;
+
+		size_t size() const { return draws_.size(); }
+		bool empty() const { return draws_.empty(); }
+
+	private:
+		uint64_t _mk_key(const Draw&, uint32_t depthKey);
+
+		std::vector<Draw> draws_;
+		std::vector<util::SortEntry> order_, prevOrder_, scratch_;
+		std::vector<vk::Pipeline> pipelineIds_;
+		std::unordered_map<const MeshInstance*, uint32_t> meshIds_; // Persistent, so that IDs are stable across frames
+	};
+
+}
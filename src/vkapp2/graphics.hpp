@@ -25,6 +25,7 @@
 #pragma once
 
 #include "util/util.hpp"
+#include "util/perftracker.hpp"
 
 #include "vkapp2/settings/options.hpp"
 #include "vkapp2/runtime.hpp"
@@ -154,6 +155,67 @@ namespace vka2 {
 	};
 
 
+	/** A buffer divided into equally sized UBO slots, each one aligned to
+	 * the device's `minUniformBufferOffsetAlignment`.
+	 *
+	 * The whole ring is meant to be bound through a single
+	 * `eUniformBufferDynamic` descriptor, which is written once:
+	 * a slot is then selected by using its offset as the dynamic offset.
+	 * Host visible rings are persistently mapped.
+	 *  - Copyable: no
+	 *  - Moveable: yes */
+	class UboRing {
+		Application* _app; // Dependency injection
+		BufferAlloc _buffer;
+		void* _mmapd; // nullptr if the ring is not host visible
+		vk::DeviceSize _slot_size;
+		vk::DeviceSize _slot_stride;
+		size_t _slot_count;
+		std::vector<size_t> _free_slots;
+		unsigned long _generation; // ++ every time the buffer is replaced
+		bool _host_visible;
+
+		void _alloc(size_t slotCount);
+		void _dealloc();
+
+	public:
+		UboRing();
+		UboRing(Application&, vk::DeviceSize slotSize, size_t slotCount, bool hostVisible);
+
+		UboRing(UboRing&&);
+
+		~UboRing();
+
+		UboRing& operator=(UboRing&&);
+
+		void destroy();
+
+		/** Returns the index of an unused slot.
+		 *
+		 * If there are none, the ring grows: the device is waited upon and
+		 * the buffer is replaced, so every descriptor that refers to the
+		 * ring must be written again; this can be detected by comparing the
+		 * ring's generation with a previously cached one. */
+		size_t acquireSlot();
+		void releaseSlot(size_t);
+
+		inline vk::DeviceSize slotOffset(size_t slot) const { return slot * _slot_stride; }
+
+		/** Returns the mapped address of a slot; the ring must be host visible. */
+		void* slotPtr(size_t);
+
+		/** Describes the first slot of the ring: other slots are addressed
+		 * through dynamic offsets. */
+		vk::DescriptorBufferInfo descriptorInfo() const;
+
+		GETTER_REF(_buffer,      buffer    )
+		GETTER_VAL(_slot_size,   slotSize  )
+		GETTER_VAL(_slot_stride, slotStride)
+		GETTER_VAL(_slot_count,  slotCount )
+		GETTER_VAL(_generation,  generation)
+	};
+
+
 	class MeshInstance {
 	public:
 		using ShPtr = std::shared_ptr<MeshInstance>;
@@ -165,7 +227,7 @@ namespace vka2 {
 		Application* _app; // Dependency injection
 		BufferAlloc _vtx;  Vertex::index_t _vtx_count;
 		BufferAlloc _idx;  Vertex::index_t _idx_count;
-		BufferAlloc _ubo;
+		size_t _ubo_slot; // In the application's model UBO ring
 		TextureSet::ShPtr _mat;
 
 	public:
@@ -176,6 +238,13 @@ namespace vka2 {
 			std::function<void (Vertices&, Indices&)> postAssembly;
 		};
 
+		/** How many vertices `assembleObj` has found at the same position. */
+		struct AssemblyStats {
+			size_t vertices;
+			size_t uniquePositions;
+			size_t uniqueHashes; // Less than `uniquePositions` when VertexHash collides
+		};
+
 
 		/** Load a model from OBJ format data into the specified model
 		 * caches. If `mergeVertices` is true, identical vertices will
@@ -194,6 +263,14 @@ namespace vka2 {
 			MeshCache* mdlCache = nullptr,
 			TextureCache* matCache = nullptr);
 
+		/** Assembles the vertices and indices of OBJ format data (the
+		 * contents of a file, not its path) the same way `fromObj` does,
+		 * without involving the device. */
+		static void assembleObj(
+			const std::string& objData, bool mergeVertices,
+			Vertices&, Indices&,
+			AssemblyStats* = nullptr);
+
 
 		MeshInstance();
 		MeshInstance(Application&, const Vertices&, const Indices&, TextureSet::ShPtr);
@@ -209,10 +286,13 @@ namespace vka2 {
 		GETTER_VAL(_vtx_count, vtxCount   )
 		GETTER_REF(_idx,       idxBuffer  )
 		GETTER_VAL(_idx_count, idxCount   )
-		GETTER_REF(_ubo,       uboBuffer  )
 
 		inline const TextureSet& textureSet() const { return *_mat.get(); }
 
+		/** The dynamic offset of the mesh's UBO, relative to the
+		 * application's model UBO ring. */
+		vk::DeviceSize uboOffset() const;
+
 		/** Updates the mesh's descriptor set. */
 		void updateDescriptorSet(vk::DescriptorSet);
 
@@ -227,12 +307,12 @@ namespace vka2 {
 		 * multiples of `sizeof(Vertex)` and `sizeof(Vertex::index_t)`. */
 		void viewVertices(std::function<bool (*)(MemoryView<Vertex>, MemoryView<Vertex::index_t>)>);
 
-		/** Maps the model's UBO to a range of addresses, then runs the
+		/** Exposes the model's UBO slot as a range of addresses, then runs the
 		 * given function.
 		 *
-		 * This operation may require a memory copy to a temporary host visible device buffer.
-		 * The function must return `true` if mapped data has been altered, otherwise the
-		 * changes may be discarded.
+		 * The slot is persistently mapped, and the device may be reading it:
+		 * the caller must make sure that no pending frame uses the mesh.
+		 * The function must return `true` if mapped data has been altered.
 		 *
 		 * The size (in bytes) of allocated memory is guaranteed to be a multiple of
 		 * `sizeof(UboType)`. */
@@ -290,6 +370,7 @@ namespace vka2 {
 		struct data_t {
 			vk::Extent2D extent;
 			std::vector<vk::Image> images;
+			std::vector<ImageAlloc> offscreenImages; // Owned images, only used by offscreen swapchains
 		} data;
 
 
@@ -301,6 +382,17 @@ namespace vka2 {
 			unsigned short maxConcurrentFrames,
 			vk::SwapchainKHR cached = nullptr);
 
+		/** Creates a swapchain without a surface, whose images are owned
+		 * by the application and never presented: rendering to it
+		 * leaves the images in the eTransferSrcOptimal layout, ready
+		 * to be read back. */
+		static AbstractSwapchain offscreen(
+			Application&,
+			const vk::Extent2D& extent,
+			unsigned short imageCount);
+
+		bool isOffscreen() const { return ! data.offscreenImages.empty(); }
+
 		/** Destroys the swapchain.
 		 * @param keep_handle Whether to keep the old vk::SwapchainKHR
 		 * instead of destroying it.
@@ -317,20 +409,37 @@ namespace vka2 {
 			vk::Pipeline handle;
 			vk::ShaderModule vtxShader;
 			vk::ShaderModule frgShader;
+			vk::Format colorFormat, depthFormat; // The attachment formats the pipeline was built for
+			vk::SampleCountFlagBits sampleCount;
+			bool screenSpaceOutline; // The render pass' outline mode the pipeline was built for
 		} _data;
 
 	public:
+		enum class Geometry {
+			eMesh, // Vertex and instance buffers, depth tested
+			eFullscreen // No vertex input, no depth test: one triangle covering the viewport, drawn with `draw(3, 1, 0, 0)`
+		};
+
 		Pipeline();
 
+		/** The viewport and the scissor are dynamic, so that the pipeline
+		 * can outlive render extent changes: they must be set by the
+		 * command buffers that use the pipeline. */
 		Pipeline(
 			RenderPass&,
 			const std::string& vtxShader, const std::string& frgShader,
 			const char* shaderEntryPoint, unsigned subpassIndex,
-			bool invertCullFace, vk::Extent2D extent,
-			vk::SampleCountFlagBits sampleCount);
+			bool invertCullFace,
+			vk::SampleCountFlagBits sampleCount,
+			Geometry = Geometry::eMesh);
 
 		void destroy();
 
+		/** Whether the pipeline can still be used with the given render
+		 * pass, after the latter has been reassigned: this is only false
+		 * if its attachment formats, sample count or outline mode have changed. */
+		bool isCompatibleWith(const RenderPass&) const;
+
 		inline bool isNull() const { return _rpass == nullptr; }
 		inline operator bool() const { return ! isNull(); }
 		inline bool operator!() const { return ! operator bool(); }
@@ -359,26 +468,39 @@ namespace vka2 {
 	class RenderPass {
 		friend Pipeline;
 	public:
+		/** How the second subpass draws outlines.
+		 *
+		 * With eMesh, every object is drawn again with the outline shaders;
+		 * with eScreenSpace, a single fullscreen triangle detects edges by
+		 * sampling the depth attachment, which subpass 1 uses read-only. */
+		enum class OutlineMode { eMesh, eScreenSpace };
+
+		static constexpr unsigned depthSamplerDescriptorSet = ubo::Static::set;
+		static constexpr unsigned depthSamplerDescriptorBinding = 2;
+
+		/** When rendering directly to the swapchain, the swapchain image
+		 * replaces either the render target or the resolve target (with
+		 * multisampling), and the latter is not created. */
 		struct ImageData {
-			ImageAlloc renderTarget, resolveTarget;
+			ImageAlloc renderTarget, resolveTarget; // Null if not used
 			vk::ImageView renderTargetView;
 			vk::ImageView resolveTargetView;
+			vk::ImageView swapchainImageView; // Null, unless rendering directly to the swapchain
 			vk::Framebuffer framebuffer;
 			vk::CommandPool cmdPool;
-			std::array<vk::CommandBuffer, 2> cmdBuffers; // [0] Render pass, [1] blit to present
-			BufferAlloc frameUbo;
-			BufferAlloc staticUbo;
+			std::array<vk::CommandBuffer, 2> cmdBuffers; // [0] Render pass, [1] blit to present (unused when rendering directly to the swapchain)
 			unsigned long staticUboWrCounter;
-			vk::Fence fenceStaticUboUpToDate;
+			unsigned long recordedVersion; // The RenderPass::invalidateCommandBuffers version the command buffers were recorded with; 0 if they can't be reused
 			vk::Fence fenceImgAvailable;
-			vk::DescriptorSet staticDescSet;
-			vk::DescriptorSet frameDescSet;
+			vk::QueryPool timestampPool; // Written by the command buffers around each subpass and the blit; null if timestamps aren't supported
+			vk::QueryPool statisticsPool; // One pipeline statistics query per subpass; null unless Runtime::pipelineStatistics is set
+			bool queriesPending; // Whether the last submission wrote queries that haven't been read yet
 		};
 
 		struct FrameData {
 			vk::Semaphore imgAcquiredSem; // Signaled when a swapchain image has been acquired
 			vk::Semaphore renderDoneSem; // Signaled when the render pass ended
-			vk::Semaphore blitToSurfaceDoneSem; // Signaled when the render target has been transfered to the swapchain image
+			vk::Semaphore blitToSurfaceDoneSem; // Signaled when the render target has been transfered to the swapchain image; unused when rendering directly to the swapchain
 		};
 
 		class FrameHandle {
@@ -386,9 +508,10 @@ namespace vka2 {
 			RenderPass& rpass;
 			RenderPass::FrameData& frameData;
 			RenderPass::ImageData& imageData;
+			unsigned imageIndex;
 
 			void updateMeshDescriptors(const MeshInstance&, vk::DescriptorSet);
-			void bindMeshDescriptorSet(vk::CommandBuffer, vk::DescriptorSet);
+			void bindMeshDescriptorSet(vk::CommandBuffer, vk::DescriptorSet, vk::DeviceSize uboOffset);
 		};
 		friend FrameHandle;
 
@@ -408,17 +531,35 @@ namespace vka2 {
 			vk::PipelineLayout pipelineLayout;
 			std::vector<vk::DescriptorSetLayout> descsetLayouts;
 			vk::RenderPass handle;
-			BufferAlloc staticUboBase; // Copy-on-read behavior for ImageData, only when needed
+			ubo::Static staticUboBase; // Copy-on-read behavior for ImageData, only when needed
 			unsigned long staticUboBaseWrCounter; // ++ on every staticUboBase write; ImageData should get a copy when its counter doesn't match.
+			unsigned long cmdBufferVersion; // ++ whenever recorded command buffers become invalid
 			std::vector<FrameData> frames;
+			UboRing staticUbos; // One slot per swapchain image
+			UboRing frameUbos; // One slot per swapchain image
+			BufferAlloc materialTable; // Persistently mapped, shared by all swapchain images
+			ssbo::MaterialTable::Entry* materialTablePtr;
+			size_t materialTableCapacity;
 			vk::DescriptorPool staticDescPool;
+			vk::DescriptorSet staticDescSet; // Dynamic, indexed by swapchain image
+			vk::DescriptorSet frameDescSet; // Dynamic, indexed by swapchain image
+			vk::Format colorFormat, depthFormat;
+			vk::SampleCountFlagBits sampleCount;
+			vk::ImageLayout colorFinalLayout; // ePresentSrcKHR when rendering directly to the swapchain
 			ImageAlloc depthStencilImg;
 			vk::ImageView depthStencilImgView;
+			vk::Sampler depthSampler; // Only used with OutlineMode::eScreenSpace
+			OutlineMode requestedOutlineMode;
+			OutlineMode outlineMode; // May differ from the requested one, if the depth format can't be sampled
 			bool useMultisampling;
+			bool directToSwapchain; // Whether the render extent matches the swapchain's, making the blit unnecessary
 		} _data;
 		struct rendering_t {
 			uint_fast32_t frame;
+			uint_fast32_t offscreenImage; // The next image to render to, when the swapchain is offscreen
+			uint_fast32_t lastImage; // 1 + the index of the last image a frame has been submitted for, 0 if none
 			bool skipNextFrame; // Desperate attempt to fix swapchain rebuilds causing crashes
+			util::PerfTracker perfTracker; // Emptied after every frame, keeping its storage, and merged into util::perfTracker
 		} _rendering = { };
 
 		void _assign(AbstractSwapchain&);
@@ -441,6 +582,7 @@ namespace vka2 {
 			vk::Extent2D renderExtent,
 			unsigned short maxConcurrentFrames,
 			bool useMultisampling,
+			OutlineMode,
 			SwapchainOutdatedCallback);
 
 		RenderPass& operator=(RenderPass&&) = default;
@@ -451,9 +593,18 @@ namespace vka2 {
 		GETTER_PTR      (_swapchain,           swapchain           )
 		GETTER_VAL_CONST(_data.handle,         handle              )
 		GETTER_REF      (_data.staticDescPool, staticDescriptorPool)
+		GETTER_VAL      (_data.staticDescSet,  staticDescriptorSet )
+		GETTER_VAL      (_data.frameDescSet,   frameDescriptorSet  )
+		GETTER_REF      (_data.staticUbos,     staticUboRing       )
+		GETTER_REF      (_data.frameUbos,      frameUboRing        )
 		GETTER_REF      (_data.pipelineLayout, pipelineLayout      )
 		GETTER_REF      (_data.descsetLayouts, descriptorSetLayouts)
 		GETTER_REF_CONST(_data.renderExtent,   renderExtent        )
+		GETTER_VAL_CONST(_data.colorFormat,    colorFormat         )
+		GETTER_VAL_CONST(_data.depthFormat,    depthFormat         )
+		GETTER_VAL_CONST(_data.sampleCount,    sampleCount         )
+		GETTER_VAL_CONST(_data.directToSwapchain, directToSwapchain)
+		GETTER_VAL_CONST(_data.outlineMode,    outlineMode         )
 
 		void reassign(AbstractSwapchain&);
 		void reassign(AbstractSwapchain&, const vk::Extent2D& renderExtent);
@@ -464,7 +615,27 @@ namespace vka2 {
 
 		void setStaticUbo(const ubo::Static&);
 
-		/** @returns `true` iif the render pass was executed successfully.
+		/** Replaces the contents of the material table, which shaders
+		 * index through `push_const::Object::materialIndex`.
+		 * This waits for the device to be idle. */
+		void setMaterialTable(const std::vector<ssbo::MaterialTable::Entry>&);
+
+		/** Forces every swapchain image to record its command buffers again,
+		 * the next time it's rendered; it has to be called whenever what the
+		 * render functions would record changes (e.g. objects are added,
+		 * pipelines are rebuilt, buffers are reallocated or descriptor sets
+		 * are updated).
+		 *
+		 * It only matters when `Options::ViewParams::reuseCommandBuffers` is set. */
+		inline void invalidateCommandBuffers() { ++_data.cmdBufferVersion; }
+
+		/** Renders the next swapchain image.
+		 *
+		 * The pre-render and post-render functions always run, while the
+		 * render functions may not be called at all if the image's command
+		 * buffers can be reused; see `invalidateCommandBuffers`.
+		 *
+		 * @returns `true` iif the render pass was executed successfully.
 		 * If the operation is unsuccessful, the state of the pipeline is
 		 * not necessarily invalid; most of the time, the swapchain becomes
 		 * invalid due to the surface being resized.
@@ -476,6 +647,13 @@ namespace vka2 {
 			PostRenderFunction /* Can be `{ }` */,
 			std::array<RenderFunction, 2> /* Main pipeline, outline pipeline */);
 
+		/** Copies the last rendered image to host memory, after waiting for
+		 * the device to finish rendering it; the swapchain must be offscreen.
+		 *
+		 * @returns The image's texels in the swapchain format, with tightly
+		 * packed rows; empty, if no frame has been rendered yet. */
+		std::vector<uint8_t> readbackLastImage();
+
 	};
 
 
@@ -494,7 +672,9 @@ namespace vka2 {
 			vk::Queue presentQueue;
 			vk::Device dev;
 			VmaAllocator alloc;
+			vk::PipelineCache pipelineCache; // Loaded from and saved to PIPELINE_CACHE_FILE
 			CommandPool transferCmdPool, graphicsCmdPool;
+			UboRing modelUbos;
 			SDL_Window* sdlWin;
 			vk::SurfaceKHR surface;
 			vk::SurfaceCapabilitiesKHR surfaceCapabs;
@@ -502,6 +682,7 @@ namespace vka2 {
 			AbstractSwapchain swapchain;
 			Options options;
 			Runtime runtime;
+			LaunchParams launchParams;
 		} _data;
 		struct cache_t {
 			mutable std::map<vk::Format, vk::FormatProperties> fmtProps;
@@ -509,7 +690,7 @@ namespace vka2 {
 		vk::SwapchainKHR _cached_swapchain;
 
 	public:
-		Application();
+		Application(const LaunchParams& = { });
 		void destroy();
 
 	private:
@@ -522,7 +703,10 @@ namespace vka2 {
 		void* _mmap_buffer(VmaAllocation&);
 	public:
 
-		void run();
+		/** Runs the main loop, until the window is closed or the
+		 * frame limit is reached.
+		 * @returns `false` if a benchmark regressed from its baseline. */
+		bool run();
 
 		/* After a call to this, all references to this object's
 		 * old swapchain are invalid. *//**/
@@ -575,12 +759,14 @@ namespace vka2 {
 		GETTER_VAL      (_data.pDev,            physDevice             )
 		GETTER_VAL      (_data.dev,             device                 )
 		GETTER_VAL      (_data.alloc,           allocator              )
+		GETTER_VAL      (_data.pipelineCache,   pipelineCache          )
 		GETTER_REF_CONST(_data.queues,          queues                 )
 		GETTER_REF_CONST(_data.qFamIdx,         queueFamilyIndices     )
 		GETTER_VAL      (_data.qFamIdxPresent,  presentQueueFamilyIndex)
 		GETTER_VAL      (_data.presentQueue,    presentQueue           )
 		GETTER_REF      (_data.transferCmdPool, transferCommandPool    )
 		GETTER_REF      (_data.graphicsCmdPool, graphicsCommandPool    )
+		GETTER_REF      (_data.modelUbos,       modelUboRing           )
 		GETTER_REF      (_data.sdlWin,          sdlWindow              )
 		GETTER_REF      (_data.swapchain,       swapchain              )
 		GETTER_VAL      (_data.surface,         surface                )
@@ -588,6 +774,7 @@ namespace vka2 {
 		GETTER_REF_CONST(_data.surfaceFmt,      surfaceFormat          )
 		GETTER_REF      (_data.options,         options                )
 		GETTER_REF_CONST(_data.runtime,         runtime                )
+		GETTER_REF_CONST(_data.launchParams,    launchParams           )
 	};
 
 }
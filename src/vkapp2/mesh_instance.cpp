@@ -27,6 +27,8 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
+#include <unordered_set>
+
 using namespace vka2;
 
 using util::enum_str;
@@ -147,15 +149,123 @@ namespace {
 		TextureSet::ShPtr mat;
 	};
 
+	/** Builds the vertices of parsed OBJ data: each triangle gets its own
+	 * vertices with a tangent frame, and vertices at the same position
+	 * share their smooth normal (and everything else, if `doMerge`). */
+	void assemble_obj(
+			const tinyobj::attrib_t& attrib,
+			const std::vector<tinyobj::shape_t>& shapes,
+			bool doMerge,
+			Vertices& vtxDst, Indices& idxDst,
+			MeshInstance::AssemblyStats* stats
+	) {
+		std::unordered_map<VtxIdentifier, std::vector<std::size_t>, VertexHash> identicalMap;
+		auto getVtxPosNrmTex = [&](const tinyobj::index_t index, Vertex& dst) {
+			dst.pos = glm::vec3(
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2]);
+			dst.nrm = dst.nrm_smooth = glm::vec3(
+				attrib.normals[3 * index.normal_index + 0],
+				attrib.normals[3 * index.normal_index + 1],
+				attrib.normals[3 * index.normal_index + 2]);
+			dst.tex = glm::vec2(
+				attrib.texcoords[2 * index.texcoord_index + 0],
+				attrib.texcoords[2 * index.texcoord_index + 1]);
+		};
+		auto getTriVtx = [&](const tinyobj::index_t* indicesTri) {
+			std::array<Vertex, 3> r;
+			glm::vec3 tanu;
+			for(unsigned i=0; auto& vtx : r) {
+				// Position and UV are needed beforehand, normals are already provided by the obj data
+				getVtxPosNrmTex(indicesTri[i++], vtx);
+			}
+			{ // Calculate tangent
+				auto edge1 = r[1].pos - r[0].pos;
+				auto edge2 = r[2].pos - r[0].pos;
+				auto deltaUv1 = r[1].tex - r[0].tex;
+				auto deltaUv2 = r[2].tex - r[0].tex;
+				float determinant = (deltaUv1.x * deltaUv2.y) - (deltaUv1.y * deltaUv2.x);
+				tanu = ((edge1 * deltaUv2.y) - (edge2 * deltaUv1.y)) / determinant;
+			}
+			for(auto& vtx : r) {
+				vtx.tanu = glm::normalize(tanu); }
+			return r;
+		};
+		if(shapes.empty()) {
+			throw std::runtime_error(formatVkErrorMsg("failed to read an OBJ model", "empty set"));
+		}
+		{ // Count and reserve size for the buffer, since reallocs can be really pricey
+			size_t vtxEstimate = 0;
+			for(auto& shape : shapes) {
+				vtxEstimate += shape.mesh.indices.size(); }
+			vtxDst.reserve(vtxEstimate);
+			idxDst.reserve(vtxEstimate);
+		}
+		// Put together basic data for each vertex
+		for(auto& shape : shapes) {
+			assert(shape.mesh.indices.size() % 3 == 0); // These need to be triangles
+			for(size_t i=0; i < shape.mesh.indices.size(); i += 3) {
+				auto tri = getTriVtx(&shape.mesh.indices[i]);
+				for(const auto& vtx : tri) {
+					vtxDst.emplace_back(std::move(vtx));
+					idxDst.push_back(idxDst.size());
+					identicalMap[vtxDst.back()].push_back(idxDst.back());
+				}
+			}
+		}
+		// Average out normals for vertices at the same position
+		for(auto& mapping : identicalMap) {
+			glm::vec3 nrmSum = { };
+			const glm::vec3::value_type denom = mapping.second.size();
+			for(auto idx : mapping.second) {
+				nrmSum += vtxDst[idx].nrm_smooth;
+			}
+			nrmSum /= denom;
+			for(auto idx : mapping.second) {
+				vtxDst[idx].nrm_smooth = nrmSum;
+			}
+		}
+		// Eventually average out non-smooth normals and tangents
+		if(doMerge) {
+			glm::vec3 tanuSum = { };
+			for(auto& mapping : identicalMap) {
+				glm::vec3::value_type denom = mapping.second.size();
+				for(auto idx : mapping.second) {
+					tanuSum += vtxDst[idx].tanu; }
+				tanuSum = glm::normalize(tanuSum / denom);
+				for(auto idx : mapping.second) {
+					auto& nrm = vtxDst[idx].nrm_smooth;
+					// Gram-Schmidt process
+					vtxDst[idx].tanu = glm::normalize(
+						tanuSum - glm::dot(tanuSum, nrm) * nrm);
+				}
+			}
+			for(auto& vtx : vtxDst) {
+				vtx.nrm = vtx.nrm_smooth; }
+		}
+		{ // Calculate bitangents
+			for(auto& vtx : vtxDst) {
+				vtx.tanv = glm::cross(vtx.nrm, vtx.tanu); }
+		}
+		if(stats != nullptr) { // Count how many positions VertexHash can tell apart
+			std::unordered_set<std::size_t> hashes;
+			hashes.reserve(identicalMap.size());
+			for(auto& mapping : identicalMap) {
+				hashes.insert(identicalMap.hash_function()(mapping.first)); }
+			stats->vertices = vtxDst.size();
+			stats->uniquePositions = identicalMap.size();
+			stats->uniqueHashes = hashes.size();
+		}
+	}
+
+
 	MdlData mk_model_from_obj(
 			Application& app, const MeshInstance::ObjSources& src, bool doMerge,
 			MeshInstance::TextureCache* matCache = nullptr
 	) {
 		MdlData r;
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::unordered_map<VtxIdentifier, std::vector<std::size_t>, VertexHash> identicalMap;
-		std::string warn, err;
+		tinyobj::ObjReader reader;
 		if(matCache != nullptr) {
 			// Try to find an existing material, or load it into the cache
 			auto found = matCache->find(src.materialName);
@@ -166,101 +276,11 @@ namespace {
 				(*matCache)[src.materialName] = r.mat;
 			}
 		} { // Load the data
-			tinyobj::ObjReader reader;
 			reader.ParseFromFile(src.objPath);
 			if(! reader.Error().empty()) {
 				util::logError() << "<tinyobj:error> " << reader.Error() << util::endl; }
-			shapes = reader.GetShapes();
-			attrib = reader.GetAttrib();
 		} {
-			auto getVtxPosNrmTex = [&](tinyobj::index_t index, Vertex& dst) {
-				dst.pos = glm::vec3(
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]);
-				dst.nrm = dst.nrm_smooth = glm::vec3(
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]);
-				dst.tex = glm::vec2(
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1]);
-			};
-			auto getTriVtx = [&](tinyobj::index_t* indicesTri) {
-				std::array<Vertex, 3> r;
-				glm::vec3 tanu;
-				for(unsigned i=0; auto& vtx : r) {
-					// Position and UV are needed beforehand, normals are already provided by the obj data
-					getVtxPosNrmTex(indicesTri[i++], vtx);
-				}
-				{ // Calculate tangent
-					auto edge1 = r[1].pos - r[0].pos;
-					auto edge2 = r[2].pos - r[0].pos;
-					auto deltaUv1 = r[1].tex - r[0].tex;
-					auto deltaUv2 = r[2].tex - r[0].tex;
-					float determinant = (deltaUv1.x * deltaUv2.y) - (deltaUv1.y * deltaUv2.x);
-					tanu = ((edge1 * deltaUv2.y) - (edge2 * deltaUv1.y)) / determinant;
-				}
-				for(auto& vtx : r) {
-					vtx.tanu = glm::normalize(tanu); }
-				return r;
-			};
-			if(shapes.empty()) {
-				throw std::runtime_error(formatVkErrorMsg("failed to read an OBJ model", "empty set"));
-			}
-			{ // Count and reserve size for the buffer, since reallocs can be really pricey
-				size_t vtxEstimate = 0;
-				for(auto& shape : shapes) {
-					vtxEstimate += shape.mesh.indices.size(); }
-				r.vtx.reserve(vtxEstimate);
-				r.idx.reserve(vtxEstimate);
-			}
-			// Put together basic data for each vertex
-			for(auto& shape : shapes) {
-				assert(shape.mesh.indices.size() % 3 == 0); // These need to be triangles
-				for(size_t i=0; i < shape.mesh.indices.size(); i += 3) {
-					auto tri = getTriVtx(&shape.mesh.indices[i]);
-					for(const auto& vtx : tri) {
-						r.vtx.emplace_back(std::move(vtx));
-						r.idx.push_back(r.idx.size());
-						identicalMap[r.vtx.back()].push_back(r.idx.back());
-					}
-				}
-			}
-			// Average out normals for vertices at the same position
-			for(auto& mapping : identicalMap) {
-				glm::vec3 nrmSum = { };
-				const glm::vec3::value_type denom = mapping.second.size();
-				for(auto idx : mapping.second) {
-					nrmSum += r.vtx[idx].nrm_smooth;
-				}
-				nrmSum /= denom;
-				for(auto idx : mapping.second) {
-					r.vtx[idx].nrm_smooth = nrmSum;
-				}
-			}
-			// Eventually average out non-smooth normals and tangents
-			if(doMerge) {
-				glm::vec3 tanuSum = { };
-				for(auto& mapping : identicalMap) {
-					glm::vec3::value_type denom = mapping.second.size();
-					for(auto idx : mapping.second) {
-						tanuSum += r.vtx[idx].tanu; }
-					tanuSum = glm::normalize(tanuSum / denom);
-					for(auto idx : mapping.second) {
-						auto& nrm = r.vtx[idx].nrm_smooth;
-						// Gram-Schmidt process
-						r.vtx[idx].tanu = glm::normalize(
-							tanuSum - glm::dot(tanuSum, nrm) * nrm);
-					}
-				}
-				for(auto& vtx : r.vtx) {
-					vtx.nrm = vtx.nrm_smooth; }
-			}
-			{ // Calculate bitangents
-				for(auto& vtx : r.vtx) {
-					vtx.tanv = glm::cross(vtx.nrm, vtx.tanu); }
-			}
+			assemble_obj(reader.GetAttrib(), reader.GetShapes(), doMerge, r.vtx, r.idx, nullptr);
 		} { // Eventually post-process vertices
 			if(src.postAssembly) {
 				src.postAssembly(r.vtx, r.idx); }
@@ -295,6 +315,18 @@ namespace vka2 {
 	}
 
 
+	void MeshInstance::assembleObj(
+			const std::string& objData, bool mergeVertices,
+			Vertices& vtxDst, Indices& idxDst,
+			AssemblyStats* stats
+	) {
+		tinyobj::ObjReader reader;
+		if(! reader.ParseFromString(objData, "")) {
+			throw std::runtime_error("failed to parse OBJ data: " + reader.Error()); }
+		assemble_obj(reader.GetAttrib(), reader.GetShapes(), mergeVertices, vtxDst, idxDst, stats);
+	}
+
+
 	MeshInstance::MeshInstance():
 			_app(nullptr)
 	{ }
@@ -304,21 +336,15 @@ namespace vka2 {
 			_app(&app),
 			_vtx_count(vtx.size()),
 			_idx_count(idx.size()),
-			_ubo(),
 			_mat(std::move(mat))
 	{
 		{ // Create the input buffers
 			auto r = stage_vertices(*_app, vtx, idx);
 			_vtx = r.first;
 			_idx = r.second;
-		} { // Create UBO buffer
-			static_assert(UboType::dma); // Because we're using eHostVisible | eDeviceLocal
-			vk::BufferCreateInfo bcInfo = { };
-			bcInfo.sharingMode = vk::SharingMode::eExclusive;
-			bcInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
-			bcInfo.size = sizeof(UboType);
-			_ubo = _app->createBuffer(bcInfo,
-				VMA_MEMORY_USAGE_CPU_TO_GPU);
+		} { // Acquire a slot in the model UBO ring
+			static_assert(UboType::dma); // Because the ring is host visible
+			_ubo_slot = _app->modelUboRing().acquireSlot();
 		}
 		util::alloc_tracker.alloc("Mesh");
 	}
@@ -329,7 +355,7 @@ namespace vka2 {
 			_MOV(_app),
 			_MOV(_vtx),  _MOV(_vtx_count),
 			_MOV(_idx),  _MOV(_idx_count),
-			_MOV(_ubo),
+			_MOV(_ubo_slot),
 			_MOV(_mat)
 			#undef _MOV
 	{
@@ -341,7 +367,7 @@ namespace vka2 {
 		if(_app != nullptr) {
 			_app->destroyBuffer(_vtx);
 			_app->destroyBuffer(_idx);
-			_app->destroyBuffer(_ubo);
+			_app->modelUboRing().releaseSlot(_ubo_slot);
 			_app = nullptr;
 			util::alloc_tracker.dealloc("Mesh");
 		}
@@ -354,6 +380,12 @@ namespace vka2 {
 	}
 
 
+	vk::DeviceSize MeshInstance::uboOffset() const {
+		assert(_app != nullptr);
+		return _app->modelUboRing().slotOffset(_ubo_slot);
+	}
+
+
 	void MeshInstance::updateDescriptorSet(
 			vk::DescriptorSet set
 	) {
@@ -362,10 +394,8 @@ namespace vka2 {
 		wdSet.dstSet = set;
 		wdSet.dstBinding = ubo::Model::binding;
 		{ // Update the UBO buffer descriptors
-			vk::DescriptorBufferInfo dbInfo;
-			dbInfo.buffer = _ubo.handle;
-			dbInfo.range = sizeof(ubo::Model);
-			wdSet.descriptorType = vk::DescriptorType::eUniformBuffer;
+			vk::DescriptorBufferInfo dbInfo = _app->modelUboRing().descriptorInfo();
+			wdSet.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
 			wdSet.setBufferInfo(dbInfo);
 			_app->device().updateDescriptorSets(wdSet, { });
 		} { // Update the texture sampler descriptors
@@ -402,9 +432,8 @@ namespace vka2 {
 		static_assert((UboType::dma == true) && "Without direct memory access, the UBO would need to be staged");
 		assert(_app != nullptr);
 		UboType* mmapd = reinterpret_cast<UboType*>(
-			_app->mapBuffer<void>(_ubo.alloc));
+			_app->modelUboRing().slotPtr(_ubo_slot));
 		fn(MemoryView(mmapd, sizeof(UboType)));
-		_app->unmapBuffer(_ubo.alloc);
 	}
 
 }
@@ -144,11 +144,17 @@ namespace vka2 {
 			RenderPass& rpass,
 			const std::string& vtxSpv, const std::string& frgSpv,
 			const char* shaderEntryPoint, unsigned subpassIndex,
-			bool invertCullFace, vk::Extent2D extent,
-			vk::SampleCountFlagBits sampleCount
+			bool invertCullFace,
+			vk::SampleCountFlagBits sampleCount,
+			Geometry geometry
 	): _rpass(&rpass) {
 		assert(_rpass->_swapchain != nullptr);
 		auto dev = _rpass->_swapchain->application->device();
+		bool fullscreen = geometry == Geometry::eFullscreen;
+		_data.colorFormat = _rpass->_data.colorFormat;
+		_data.depthFormat = _rpass->_data.depthFormat;
+		_data.sampleCount = sampleCount;
+		_data.screenSpaceOutline = _rpass->_data.outlineMode == RenderPass::OutlineMode::eScreenSpace;
 		{
 			_data.vtxShader = mk_shader_module(dev, vtxSpv);  util::alloc_tracker.alloc("Pipeline:_data:vtxShader");
 			_data.frgShader = mk_shader_module(dev, frgSpv);  util::alloc_tracker.alloc("Pipeline:_data:frgShader");
@@ -168,23 +174,26 @@ namespace vka2 {
 				for(const auto& attrib : Instance::ATTRIB_DESC)  viscAttribs[i++] = attrib;
 				assert(i == viscAttribs.size());
 			}
-			viscInfo.setVertexBindingDescriptions(viscBindings);
-			viscInfo.setVertexAttributeDescriptions(viscAttribs);
+			if(! fullscreen) {
+				// Fullscreen triangles are generated from the vertex index alone
+				viscInfo.setVertexBindingDescriptions(viscBindings);
+				viscInfo.setVertexAttributeDescriptions(viscAttribs);
+			}
 
 			vk::PipelineInputAssemblyStateCreateInfo iascInfo;
 			iascInfo.topology = vk::PrimitiveTopology::eTriangleList;
 
 			vk::PipelineViewportStateCreateInfo vscInfo;
-			vk::Rect2D scissor = vk::Rect2D({ 0, 0 }, extent);
-			vk::Viewport viewport = vk::Viewport(0.0f, 0.0f,
-				static_cast<float>(extent.width),
-				static_cast<float>(extent.height), 0.0f, 1.0f);
-			vscInfo.setScissors(scissor);
-			vscInfo.setViewports(viewport);
+			vscInfo.viewportCount = 1; // Dynamic
+			vscInfo.scissorCount = 1; // Dynamic
 
 			vk::PipelineRasterizationStateCreateInfo rscInfo;
-			rscInfo.setCullMode(invertCullFace?
-				vk::CullModeFlagBits::eFront : vk::CullModeFlagBits::eBack);
+			if(fullscreen) {
+				rscInfo.setCullMode(vk::CullModeFlagBits::eNone);
+			} else {
+				rscInfo.setCullMode(invertCullFace?
+					vk::CullModeFlagBits::eFront : vk::CullModeFlagBits::eBack);
+			}
 			rscInfo.frontFace = vk::FrontFace::eCounterClockwise;
 			rscInfo.lineWidth = LINE_WIDTH;
 			rscInfo.polygonMode = vk::PolygonMode::eFill;
@@ -195,8 +204,8 @@ namespace vka2 {
 			msscInfo.minSampleShading = 1.0f;
 
 			vk::PipelineDepthStencilStateCreateInfo dsscInfo;
-			dsscInfo.depthTestEnable = true;
-			dsscInfo.depthWriteEnable = true;
+			dsscInfo.depthTestEnable = ! fullscreen;
+			dsscInfo.depthWriteEnable = ! fullscreen; // The depth attachment is read-only while it's being sampled
 			dsscInfo.depthCompareOp = DEPTH_CMP_OP;
 
 			vk::PipelineColorBlendStateCreateInfo cbscInfo;
@@ -206,8 +215,10 @@ namespace vka2 {
 				vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
 			cbscInfo.setAttachments(cbaState);
 
-			auto dStates = std::array<vk::DynamicState, 1> {
-				vk::DynamicState::eLineWidth };
+			auto dStates = std::array<vk::DynamicState, 3> {
+				vk::DynamicState::eLineWidth,
+				vk::DynamicState::eViewport,
+				vk::DynamicState::eScissor };
 			vk::PipelineDynamicStateCreateInfo dscInfo;
 			dscInfo.setDynamicStates(dStates);
 
@@ -225,7 +236,7 @@ namespace vka2 {
 				gpcInfo.pDynamicState = &dscInfo;
 				gpcInfo.renderPass = _rpass->_data.handle;
 				gpcInfo.subpass = subpassIndex;
-				auto r = dev.createGraphicsPipelines(nullptr, gpcInfo);
+				auto r = dev.createGraphicsPipelines(_rpass->_swapchain->application->pipelineCache(), gpcInfo);
 				if(r.result != vk::Result::eSuccess) {
 					throw std::runtime_error(formatVkErrorMsg(
 						"failed to create a Vulkan pipeline", vk::to_string(r.result)));
@@ -248,4 +259,13 @@ namespace vka2 {
 		#endif
 	}
 
+
+	bool Pipeline::isCompatibleWith(const RenderPass& rpass) const {
+		return
+			(_data.colorFormat == rpass._data.colorFormat) &&
+			(_data.depthFormat == rpass._data.depthFormat) &&
+			(_data.sampleCount == rpass._data.sampleCount) &&
+			(_data.screenSpaceOutline == (rpass._data.outlineMode == RenderPass::OutlineMode::eScreenSpace));
+	}
+
 }
\ No newline at end of file
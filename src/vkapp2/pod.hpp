@@ -136,9 +136,11 @@ namespace vka2 {
 	namespace ubo {
 
 		/* The static Uniform Buffer Object is expected to change
-		 * very infrequently throughout the render pass' lifetime. */
+		 * very infrequently throughout the render pass' lifetime;
+		 * it is still host visible, so that it can be updated
+		 * without staging buffers or transfer queue submissions. */
 		struct Static {
-			static constexpr bool dma = false;
+			static constexpr bool dma = true;
 			static constexpr unsigned set = 0;
 			static constexpr unsigned binding = 0;
 			SPIRV_ALIGNED(glm::mat4)  projTransf;
@@ -178,6 +180,25 @@ namespace vka2 {
 
 	}
 
+
+	namespace ssbo {
+
+		/* The material table holds the shading parameters of every material,
+		 * and is indexed by `push_const::Object::materialIndex`; it shares the
+		 * descriptor set with the static UBO, as it rarely changes.
+		 * Entries have the same layout as the model UBO, which is also
+		 * valid for std430 arrays. */
+		struct MaterialTable {
+			static constexpr bool dma = true;
+			static constexpr unsigned set = 0;
+			static constexpr unsigned binding = 1;
+			using Entry = ubo::Model;
+		};
+
+		static_assert(sizeof(MaterialTable::Entry) == 6 * 4, "the material table's array stride must match the shaders'");
+
+	}
+
 	#undef SPIRV_ALIGNED
 
 }
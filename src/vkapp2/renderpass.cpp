@@ -50,12 +50,21 @@ namespace {
 			(Texture::samplerDescriptorBindings[0] < bindingCount) &&
 			(Texture::samplerDescriptorBindings[1] < bindingCount));
 		// Ordered by update frequency, ideally in ascending order
+		// UBOs live in rings, and are selected through dynamic offsets
+		static_assert(ssbo::MaterialTable::set == ubo::Static::set);
+		static_assert(RenderPass::depthSamplerDescriptorSet == ubo::Static::set);
 		r[ubo::Static::set] = {
 			vk::DescriptorSetLayoutBinding(ubo::Static::binding,
-				vk::DescriptorType::eUniformBuffer, 1, uboStages) };
+				vk::DescriptorType::eUniformBufferDynamic, 1, uboStages),
+			vk::DescriptorSetLayoutBinding(ssbo::MaterialTable::binding,
+				vk::DescriptorType::eStorageBuffer, 1,
+				vk::ShaderStageFlagBits::eFragment),
+			vk::DescriptorSetLayoutBinding(RenderPass::depthSamplerDescriptorBinding, // Depth sampler, for screen space outlines
+				vk::DescriptorType::eCombinedImageSampler, 1,
+				vk::ShaderStageFlagBits::eFragment) };
 		r[ubo::Model::set] = {
 			vk::DescriptorSetLayoutBinding(ubo::Model::binding,
-				vk::DescriptorType::eUniformBuffer, 1, uboStages),
+				vk::DescriptorType::eUniformBufferDynamic, 1, uboStages),
 			vk::DescriptorSetLayoutBinding(Texture::samplerDescriptorBindings[0], // Color sampler
 				vk::DescriptorType::eCombinedImageSampler, 1,
 				vk::ShaderStageFlagBits::eFragment),
@@ -67,7 +76,7 @@ namespace {
 				vk::ShaderStageFlagBits::eFragment) };
 		r[ubo::Frame::set] = {
 			vk::DescriptorSetLayoutBinding(ubo::Frame::binding,
-				vk::DescriptorType::eUniformBuffer, 1, uboStages) };
+				vk::DescriptorType::eUniformBufferDynamic, 1, uboStages) };
 		return r;
 	} ();
 
@@ -97,7 +106,7 @@ namespace {
 			plcInfo.setSetLayouts(dsLayouts);
 			plcInfo.setPushConstantRangeCount(0);
 		} else {
-			pcRange.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+			pcRange.stageFlags = push_const::Object::stages;
 			pcRange.offset = 0;
 			pcRange.size = sizeof(push_const::Object);
 			plcInfo.setSetLayouts(dsLayouts);
@@ -111,7 +120,8 @@ namespace {
 
 	ImageAlloc mk_depthstencil_img(
 			AbstractSwapchain& asc,
-			const Runtime& runtime, const vk::Extent2D& ext
+			const Runtime& runtime, const vk::Extent2D& ext,
+			bool sampled
 	) {
 		vk::ImageCreateInfo icInfo;
 		assert(icInfo.initialLayout == vk::ImageLayout::eUndefined);
@@ -121,6 +131,8 @@ namespace {
 		icInfo.samples = runtime.bestSampleCount;
 		icInfo.format = runtime.depthOptimalFmt;
 		icInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+		if(sampled) {
+			icInfo.usage |= vk::ImageUsageFlagBits::eSampled; }
 		icInfo.tiling = IMAGE_TILING;
 		icInfo.arrayLayers = 1;
 		icInfo.sharingMode = vk::SharingMode::eExclusive;
@@ -154,7 +166,7 @@ namespace {
 			vk::Format colorFormat, vk::Format depthFormat,
 			vk::ImageLayout colorLayout,
 			vk::SampleCountFlagBits sampleCount,
-			bool useStencil
+			bool useStencil, bool screenSpaceOutline
 	) {
 		bool useMultisampling = sampleCount != vk::SampleCountFlagBits::e1;
 		vk::ImageLayout depthLayout = useStencil?
@@ -164,13 +176,14 @@ namespace {
 		std::vector<vk::AttachmentReference> attachmentRefs;  attachmentRefs.reserve(3);
 		vk::RenderPassCreateInfo rpcInfo;
 		std::array<vk::SubpassDescription, 2> subpassDesc;
-		vk::SubpassDependency subpassDep;
+		std::array<vk::SubpassDependency, 2> subpassDeps;
 		attachmentRefs.push_back(vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal));
 		attachments.push_back(vk::AttachmentDescription({ },
 			colorFormat, sampleCount,
-			vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare,
+			// Multisampled images are only read through the resolve attachment
+			vk::AttachmentLoadOp::eClear, useMultisampling? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore,
 			vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-			vk::ImageLayout::eUndefined, colorLayout));
+			vk::ImageLayout::eUndefined, useMultisampling? vk::ImageLayout::eColorAttachmentOptimal : colorLayout));
 		attachmentRefs.push_back(vk::AttachmentReference(1, vk::ImageLayout::eDepthStencilAttachmentOptimal));
 		attachments.push_back(vk::AttachmentDescription({ },
 			depthFormat, sampleCount,
@@ -187,23 +200,45 @@ namespace {
 		}
 		subpassDesc[0].setColorAttachments(attachmentRefs[0]);
 		subpassDesc[1].setColorAttachments(attachmentRefs[0]);
+		// Screen space outlines sample the depth attachment, which must then be read-only
+		auto depthReadOnlyRef = vk::AttachmentReference(1, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
 		subpassDesc[0].setPDepthStencilAttachment(&attachmentRefs[1]);
-		subpassDesc[1].setPDepthStencilAttachment(&attachmentRefs[1]);
+		subpassDesc[1].setPDepthStencilAttachment(screenSpaceOutline? &depthReadOnlyRef : &attachmentRefs[1]);
 		subpassDesc[0].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
 		subpassDesc[1].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
 		if(useMultisampling) {
 			subpassDesc[0].setPResolveAttachments(&attachmentRefs[2]);
 			subpassDesc[1].setPResolveAttachments(&attachmentRefs[2]);
 		}
-		subpassDep.srcSubpass = 0;
-		subpassDep.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-		subpassDep.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-		subpassDep.dstSubpass = 1;
-		subpassDep.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-		subpassDep.dstAccessMask = vk::AccessFlagBits::eNoneKHR;
+		{ // The layout transition of the color attachment(s) must wait for the image to be acquired
+			auto& dep = subpassDeps[0];
+			dep.srcSubpass = VK_SUBPASS_EXTERNAL;
+			dep.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			dep.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+			dep.dstSubpass = 0;
+			dep.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			dep.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+		} {
+			auto& dep = subpassDeps[1];
+			dep.srcSubpass = 0;
+			dep.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			dep.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+			dep.dstSubpass = 1;
+			dep.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			dep.dstAccessMask = vk::AccessFlagBits::eNoneKHR;
+			if(screenSpaceOutline) {
+				// Edge detection reads neighboring depth values, so the dependency can't be by region
+				dep.srcStageMask |=
+					vk::PipelineStageFlagBits::eEarlyFragmentTests |
+					vk::PipelineStageFlagBits::eLateFragmentTests;
+				dep.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+				dep.dstStageMask |= vk::PipelineStageFlagBits::eFragmentShader;
+				dep.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+			}
+		}
 		rpcInfo.setAttachments(attachments);
 		rpcInfo.setSubpasses(subpassDesc);
-		rpcInfo.setDependencies(subpassDep);
+		rpcInfo.setDependencies(subpassDeps);
 		return asc.application->device().createRenderPass(rpcInfo);
 	}
 
@@ -226,56 +261,76 @@ namespace {
 	}
 
 
-	BufferAlloc mk_static_ubo_base(
-			VmaAllocator alloc
+	vk::DescriptorPool mk_static_desc_pool(vk::Device dev) {
+		// One "size" element represents how many descriptors of type X *across all sets* can be created;
+		// the static and frame sets are shared by all swapchain images, through dynamic offsets
+		auto sizes = std::array<vk::DescriptorPoolSize, 3> {
+			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 2),
+			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1), // Material table
+			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1) // Depth sampler
+		};
+		vk::DescriptorPoolCreateInfo dpcInfo;
+		dpcInfo.setPoolSizes(sizes);
+		dpcInfo.maxSets = 2;
+		util::logVkDebug()
+			<< "Creating static descriptor pool with max." << dpcInfo.maxSets
+			<< " descriptor sets for " << sizes[0].descriptorCount << '+' << sizes[1].descriptorCount
+			<< '+' << sizes[2].descriptorCount << " bindings" << util::endl;
+		return dev.createDescriptorPool(dpcInfo);
+	}
+
+
+	vk::Sampler mk_depth_sampler(vk::Device dev) {
+		// Depth values are only read through `texelFetch`, but a sampler is still required
+		vk::SamplerCreateInfo scInfo;
+		scInfo.magFilter = scInfo.minFilter = vk::Filter::eNearest;
+		scInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+		scInfo.addressModeU = scInfo.addressModeV = scInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+		scInfo.maxLod = 0.0f;
+		return dev.createSampler(scInfo);
+	}
+
+
+	void set_depth_sampler_descriptor(
+			vk::Device dev, vk::DescriptorSet dSet,
+			vk::ImageView depthView, vk::Sampler sampler
 	) {
-		BufferAlloc r;
-		VkBuffer cHandle;
+		vk::WriteDescriptorSet wr;
+		auto diInfo = vk::DescriptorImageInfo(sampler, depthView, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+		wr.descriptorCount = 1;
+		wr.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		wr.dstArrayElement = 0;
+		wr.dstBinding = RenderPass::depthSamplerDescriptorBinding;
+		wr.dstSet = dSet;
+		wr.setImageInfo(diInfo);
+		dev.updateDescriptorSets(wr, { });
+	}
+
+
+	BufferAlloc mk_material_table(Application& app, size_t capacity) {
+		static_assert(ssbo::MaterialTable::dma);
 		vk::BufferCreateInfo bcInfo;
-		VmaAllocationCreateInfo acInfo = { };
-		bcInfo.size = sizeof(ubo::Static);
+		bcInfo.size = capacity * sizeof(ssbo::MaterialTable::Entry);
 		bcInfo.sharingMode = vk::SharingMode::eExclusive;
-		bcInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer |
-			vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
-		if constexpr(ubo::Static::dma) {
-			acInfo.requiredFlags =
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-			acInfo.preferredFlags =
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		} else {
-			acInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-			bcInfo.sharingMode = vk::SharingMode::eExclusive;
-		}
-		VkBufferCreateInfo& cCrInfo = bcInfo;
-		{
-			auto result = vmaCreateBuffer(alloc,
-				&cCrInfo, &acInfo, &cHandle, &r.alloc, nullptr);
-			if(result != VK_SUCCESS) {
-				throw std::runtime_error(formatVkErrorMsg(
-					"failed to create a static UBO on the device", util::enum_str(result)));
-			}
-		}
-		r.handle = cHandle;
-		return r;
+		bcInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+		return app.createBuffer(bcInfo,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
 	}
 
 
-	vk::DescriptorPool mk_static_desc_pool(
-			vk::Device dev, unsigned swpChnImgCount
+	void set_material_table_descriptor(
+			vk::Device dev, vk::DescriptorSet dSet, vk::Buffer materialTable
 	) {
-		// One "size" element represents how many descriptors of type X *across all sets* can be created
-		auto sizes = std::array<vk::DescriptorPoolSize, 1> {
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 2 * swpChnImgCount)
-		};
-		vk::DescriptorPoolCreateInfo dpcInfo;
-		dpcInfo.setPoolSizes(sizes);
-		dpcInfo.maxSets = 2 * swpChnImgCount;
-		util::logVkDebug()
-			<< "Creating static descriptor pool with max." << dpcInfo.maxSets
-			<< " descriptor sets for " << sizes[0].descriptorCount
-			<< " bindings" << util::endl;
-		return dev.createDescriptorPool(dpcInfo);
+		vk::WriteDescriptorSet wr;
+		auto dbInfo = vk::DescriptorBufferInfo(materialTable, 0, VK_WHOLE_SIZE);
+		wr.descriptorCount = 1;
+		wr.descriptorType = vk::DescriptorType::eStorageBuffer;
+		wr.dstArrayElement = 0;
+		wr.dstBinding = ssbo::MaterialTable::binding;
+		wr.dstSet = dSet;
+		wr.setBufferInfo(dbInfo);
+		dev.updateDescriptorSets(wr, { });
 	}
 
 
@@ -317,6 +372,103 @@ namespace {
 
 
 
+	/** The timestamps written by each swapchain image's command buffers,
+	 * in query pool order; the blit ones are unused when rendering
+	 * directly to the swapchain. */
+	namespace timestamp {
+
+		enum Query : uint32_t {
+			eRenderBegin, eSubpass0End, eSubpass1End, eBlitBegin, eBlitEnd,
+			eCount };
+
+
+		/** Feeds the timestamps of the image's last submission to the
+		 * tracker, as "gpu.*" records; the image's fence must have been
+		 * waited on, so reading them never stalls. */
+		void read(
+				vk::Device dev, const Runtime& rt,
+				const RenderPass::ImageData& img, bool blit,
+				util::PerfTracker& perfTracker
+		) {
+			if(! img.timestampPool)  return;
+			std::array<uint64_t, eCount> ts;
+			uint32_t count = blit? eCount : eBlitBegin;
+			auto result = dev.getQueryPoolResults(img.timestampPool, 0, count,
+				count * sizeof(uint64_t), ts.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+			if(result != vk::Result::eSuccess)  return;
+			const auto elapsed = [&](Query beg, Query end) {
+				uint64_t ticks = (ts[end] - ts[beg]) & rt.timestampMask;
+				return static_cast<util::PerfTracker::utime_t>(static_cast<double>(ticks) * rt.timestampPeriodNs);
+			};
+			perfTracker.record(PERF_ID("gpu.subpass0"), elapsed(eRenderBegin, eSubpass0End));
+			perfTracker.record(PERF_ID("gpu.subpass1"), elapsed(eSubpass0End, eSubpass1End));
+			if(blit) {
+				perfTracker.record(PERF_ID("gpu.blit"), elapsed(eBlitBegin, eBlitEnd));
+				perfTracker.record(PERF_ID("gpu.frame"), elapsed(eRenderBegin, eBlitEnd));
+			} else {
+				perfTracker.record(PERF_ID("gpu.frame"), elapsed(eRenderBegin, eSubpass1End));
+			}
+		}
+
+	}
+
+
+	/** Pipeline statistics, counted by one query per subpass: queries
+	 * can't span more than one subpass. */
+	namespace statistics {
+
+		constexpr unsigned subpassCount = 2;
+
+		// Results are written in the order of the flag bits
+		constexpr auto flags =
+			vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+			vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+			vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+			vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+		constexpr unsigned counterCount = 4;
+
+
+		/** Record IDs, indexed by subpass and counter. */
+		const auto& record_ids() {
+			static const auto r = []() {
+				constexpr std::array<const char*, counterCount> counters = {
+					"iaPrimitives", "vsInvocations", "clipPrimitives", "fsInvocations" };
+				std::array<std::array<perf::TimerId, counterCount>, subpassCount> r;
+				for(unsigned s=0; s < subpassCount; ++s) {
+					for(unsigned c=0; c < counterCount; ++c) {
+						std::string name = "gpu.subpass" + std::to_string(s) + '.' + counters[c];
+						r[s][c] = perf::TimerId::intern(name.c_str());
+					}
+				}
+				return r;
+			} ();
+			return r;
+		}
+
+
+		/** Feeds the counters of the image's last submission to the tracker,
+		 * as "gpu.subpass<N>.*" records; see `timestamp::read`. */
+		void read(
+				vk::Device dev,
+				const RenderPass::ImageData& img,
+				util::PerfTracker& perfTracker
+		) {
+			if(! img.statisticsPool)  return;
+			std::array<std::array<uint64_t, counterCount>, subpassCount> counts;
+			auto result = dev.getQueryPoolResults(img.statisticsPool, 0, subpassCount,
+				sizeof(counts), counts.data(), sizeof(counts[0]), vk::QueryResultFlagBits::e64);
+			if(result != vk::Result::eSuccess)  return;
+			const auto& ids = record_ids();
+			for(unsigned s=0; s < subpassCount; ++s) {
+				for(unsigned c=0; c < counterCount; ++c) {
+					perfTracker.record(ids[s][c], counts[s][c]); }
+			}
+		}
+
+	}
+
+
+
 	namespace frame {
 
 		std::vector<RenderPass::FrameData> mk_frames(
@@ -347,92 +499,51 @@ namespace {
 
 	namespace imgref {
 
-		void update_static_ubo(
-				AbstractSwapchain& asc, RenderPass::ImageData& imgData,
-				BufferAlloc& staticUboBase,
-				decltype(RenderPass::ImageData::staticUboWrCounter) staticUboWrCounter
-		) {
-			imgData.staticUboWrCounter = staticUboWrCounter;
-			asc.application->device().resetFences(imgData.fenceStaticUboUpToDate);
-			auto cmdHandle = asc.application->transferCommandPool().runCmdsAsync(
-				asc.application->queues().transfer,
-				[&imgData, &staticUboBase](vk::CommandBuffer cmd) {
-					constexpr auto cp = vk::BufferCopy(0, 0, sizeof(ubo::Static));
-					cmd.copyBuffer(staticUboBase.handle, imgData.staticUbo.handle, cp);
-				}, imgData.fenceStaticUboUpToDate
-			);
-			vk::Result result = asc.application->device().waitForFences(
-				imgData.fenceStaticUboUpToDate, true, UINT64_MAX);
-			if(result != vk::Result::eSuccess) {
-				throw std::runtime_error(formatVkErrorMsg(
-					"failed to wait on a fence while running a render pass",
-					vk::to_string(result)));
-			}
-		}
-
-
 		RenderPass::ImageData mk_data(
 				AbstractSwapchain& asc, vk::RenderPass rpass,
-				vk::DescriptorPool staticDsPool,
-				std::vector<vk::DescriptorSetLayout> dsLayouts,
+				vk::Image swapchainImage,
 				vk::Extent2D renderExtent, vk::ImageView depthStencilImgView,
-				unsigned graphicsQueueFamily, bool useMultisampling
+				unsigned graphicsQueueFamily, bool useMultisampling,
+				bool directToSwapchain
 		) {
-			constexpr auto allocUbo = [](
-					AbstractSwapchain& asc, vk::DeviceSize size, bool dma
-			) -> BufferAlloc {
-				vk::BufferCreateInfo bcInfo;
-				vk::MemoryPropertyFlags reqMemProps;
-				vk::MemoryPropertyFlags prfMemProps = vk::MemoryPropertyFlags(0);
-				bcInfo.size = size;
-				bcInfo.sharingMode = vk::SharingMode::eExclusive;
-				bcInfo.usage =
-					vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst;
-				bcInfo.sharingMode = vk::SharingMode::eExclusive;
-				if(dma) {
-					reqMemProps =
-						vk::MemoryPropertyFlagBits::eHostVisible |
-						vk::MemoryPropertyFlagBits::eHostCoherent;
-					prfMemProps = vk::MemoryPropertyFlagBits::eDeviceLocal;
-				} else {
-					reqMemProps = vk::MemoryPropertyFlagBits::eDeviceLocal;
-				}
-				return asc.application->createBuffer(bcInfo, reqMemProps, prfMemProps);
-			};
 			auto dev = asc.application->device();
 			RenderPass::ImageData r;
-			{ // Create the UBOs
-				r.staticUbo = allocUbo(asc, sizeof(ubo::Static), ubo::Static::dma);
-				r.frameUbo = allocUbo(asc, sizeof(ubo::Frame), ubo::Frame::dma);
+			{ // Initialize the static UBO state tracker
 				r.staticUboWrCounter = 0; // Set the state tracker to the initial state: the static UBO copied *always* has to be "updated" here
-			} { // Create the render target
-				r.renderTarget = mk_render_target_img(asc, renderExtent);  util::alloc_tracker.alloc("RenderPass:ImageData:renderTarget");
+				r.recordedVersion = 0; // Nothing has been recorded yet
+			} { // Create the render target, the resolve target, or neither
 				vk::ImageViewCreateInfo ivcInfo;
 				vk::ImageSubresourceRange subresRange;
 				subresRange.aspectMask = vk::ImageAspectFlagBits::eColor;
 				subresRange.layerCount = subresRange.levelCount = 1;
 				ivcInfo.components = vk::ComponentMapping(vk::ComponentSwizzle::eIdentity);
 				ivcInfo.format = asc.application->surfaceFormat().format;
-				ivcInfo.image = r.renderTarget.handle;
 				ivcInfo.subresourceRange = subresRange;
 				ivcInfo.viewType = vk::ImageViewType::e2D;
-				r.renderTargetView = asc.application->device().createImageView(ivcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:renderTargetView");
-				if(useMultisampling) {
-					// Optionally create the resolve attachment
+				// Initialize the unused attachments, so we know not to destroy them
+				r.renderTarget = r.resolveTarget = ImageAlloc { nullptr, nullptr };
+				r.renderTargetView = r.resolveTargetView = r.swapchainImageView = nullptr;
+				if(directToSwapchain) {
+					ivcInfo.image = swapchainImage;
+					r.swapchainImageView = dev.createImageView(ivcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:swapchainImageView");
+				}
+				if(useMultisampling || ! directToSwapchain) {
+					r.renderTarget = mk_render_target_img(asc, renderExtent);  util::alloc_tracker.alloc("RenderPass:ImageData:renderTarget");
+					ivcInfo.image = r.renderTarget.handle;
+					r.renderTargetView = dev.createImageView(ivcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:renderTargetView");
+				}
+				if(useMultisampling && ! directToSwapchain) {
 					r.resolveTarget = mk_resolve_target_img(asc, renderExtent);  util::alloc_tracker.alloc("RenderPass:ImageData:resolveTarget");
 					ivcInfo.image = r.resolveTarget.handle;
-					subresRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-					r.resolveTargetView = asc.application->device().createImageView(ivcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:resolveTargetView");
-				} else { // If the resolve attachment is not to be created, initialize it so we know not to destroy it
-					r.resolveTarget = ImageAlloc { nullptr, nullptr };
-					r.resolveTargetView = nullptr;
+					r.resolveTargetView = dev.createImageView(ivcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:resolveTargetView");
 				}
 			} { // Create the framebuffer
 				vk::FramebufferCreateInfo fbcInfo;
 				std::vector<vk::ImageView> attachmentViews = {
-					r.renderTargetView, depthStencilImgView };
-				if(r.resolveTargetView != vk::ImageView(nullptr)) {
-					attachmentViews.push_back(r.resolveTargetView); }
+					(directToSwapchain && ! useMultisampling)? r.swapchainImageView : r.renderTargetView,
+					depthStencilImgView };
+				if(useMultisampling) {
+					attachmentViews.push_back(directToSwapchain? r.swapchainImageView : r.resolveTargetView); }
 				fbcInfo.layers = 1;
 				fbcInfo.renderPass = rpass;
 				fbcInfo.width = renderExtent.width;
@@ -440,9 +551,8 @@ namespace {
 				fbcInfo.setAttachments(attachmentViews);
 				r.framebuffer = asc.application->device().createFramebuffer(fbcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:framebuffer");
 			} { // Create the image's synchronization objects
-				r.fenceStaticUboUpToDate = dev.createFence({ });
 				r.fenceImgAvailable = dev.createFence({ vk::FenceCreateFlagBits::eSignaled });
-				util::alloc_tracker.alloc("vk::Fence", 2);
+				util::alloc_tracker.alloc("vk::Fence", 1);
 				util::alloc_tracker.alloc("RenderPass:ImageData:[sync_objects]");
 			} { // Allocate the command pool and buffer
 				r.cmdPool = dev.createCommandPool(vk::CommandPoolCreateInfo({ },
@@ -451,18 +561,22 @@ namespace {
 					vk::CommandBufferAllocateInfo(r.cmdPool, vk::CommandBufferLevel::ePrimary, 2));
 				assert(cmdBufferVector.size() == r.cmdBuffers.size());
 				std::move(cmdBufferVector.begin(), cmdBufferVector.end(), r.cmdBuffers.begin());
-			} { // Create the descriptor sets
-				auto mkDescSet = [staticDsPool, dev](
-						vk::DescriptorSetLayout layout
-				) {
-					vk::DescriptorSetAllocateInfo dsaInfo;
-					dsaInfo.descriptorPool = staticDsPool;
-					dsaInfo.descriptorSetCount = 1;
-					dsaInfo.setSetLayouts(layout);
-					return dev.allocateDescriptorSets(dsaInfo).front();
-				};
-				r.staticDescSet = mkDescSet(dsLayouts[ubo::Static::set]);
-				r.frameDescSet = mkDescSet(dsLayouts[ubo::Frame::set]);
+			} { // Create the query pools, if they're supported
+				r.timestampPool = r.statisticsPool = nullptr;
+				r.queriesPending = false;
+				if(asc.application->runtime().timestampPeriodNs > 0.0f) {
+					vk::QueryPoolCreateInfo qpcInfo;
+					qpcInfo.queryType = vk::QueryType::eTimestamp;
+					qpcInfo.queryCount = timestamp::eCount;
+					r.timestampPool = dev.createQueryPool(qpcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:timestampPool");
+				}
+				if(asc.application->runtime().pipelineStatistics) {
+					vk::QueryPoolCreateInfo qpcInfo;
+					qpcInfo.queryType = vk::QueryType::ePipelineStatistics;
+					qpcInfo.queryCount = statistics::subpassCount;
+					qpcInfo.pipelineStatistics = statistics::flags;
+					r.statisticsPool = dev.createQueryPool(qpcInfo);  util::alloc_tracker.alloc("RenderPass:ImageData:statisticsPool");
+				}
 			}
 			return r;
 		}
@@ -473,8 +587,13 @@ namespace {
 				RenderPass::ImageData& imgData
 		) {
 			auto dev = asc.application->device();
-			dev.destroyImageView(imgData.renderTargetView);  util::alloc_tracker.dealloc("RenderPass:ImageData:renderTargetView");
-			asc.application->destroyImage(imgData.renderTarget);  util::alloc_tracker.dealloc("RenderPass:ImageData:renderTarget");
+			if(imgData.swapchainImageView != vk::ImageView(nullptr)) {
+				dev.destroyImageView(imgData.swapchainImageView);  util::alloc_tracker.dealloc("RenderPass:ImageData:swapchainImageView");
+			}
+			if(imgData.renderTargetView != vk::ImageView(nullptr)) {
+				dev.destroyImageView(imgData.renderTargetView);  util::alloc_tracker.dealloc("RenderPass:ImageData:renderTargetView");
+				asc.application->destroyImage(imgData.renderTarget);  util::alloc_tracker.dealloc("RenderPass:ImageData:renderTarget");
+			}
 			if(imgData.resolveTargetView != vk::ImageView(nullptr)) {
 				dev.destroyImageView(imgData.resolveTargetView);  util::alloc_tracker.dealloc("RenderPass:ImageData:resolveTargetView");
 				asc.application->destroyImage(imgData.resolveTarget);  util::alloc_tracker.dealloc("RenderPass:ImageData:resolveTarget");
@@ -484,14 +603,17 @@ namespace {
 			}
 			{
 				dev.destroyFence(imgData.fenceImgAvailable);
-				dev.destroyFence(imgData.fenceStaticUboUpToDate);
 				util::alloc_tracker.dealloc("RenderPass:ImageData:[sync_objects]");
-				util::alloc_tracker.dealloc("vk::Fence", 2);
+				util::alloc_tracker.dealloc("vk::Fence", 1);
+			}
+			if(imgData.timestampPool != vk::QueryPool(nullptr)) {
+				dev.destroyQueryPool(imgData.timestampPool);  util::alloc_tracker.dealloc("RenderPass:ImageData:timestampPool");
+			}
+			if(imgData.statisticsPool != vk::QueryPool(nullptr)) {
+				dev.destroyQueryPool(imgData.statisticsPool);  util::alloc_tracker.dealloc("RenderPass:ImageData:statisticsPool");
 			}
 			dev.destroyCommandPool(imgData.cmdPool);  util::alloc_tracker.dealloc("RenderPass:ImageData:cmdPool");
 			dev.destroyFramebuffer(imgData.framebuffer);  util::alloc_tracker.dealloc("RenderPass:ImageData:framebuffer");
-			asc.application->destroyBuffer(imgData.frameUbo);
-			asc.application->destroyBuffer(imgData.staticUbo);
 		}
 
 	}
@@ -502,12 +624,9 @@ namespace {
 			const MeshInstance& mdl, vk::DescriptorSet dSet
 	) {
 		vk::WriteDescriptorSet wdSet;
-		vk::DescriptorBufferInfo dbInfo;
-		dbInfo.buffer = mdl.uboBuffer().handle;
-		dbInfo.offset = 0;
-		dbInfo.range = sizeof(ubo::Model);
+		vk::DescriptorBufferInfo dbInfo = mdl.application()->modelUboRing().descriptorInfo();
 		wdSet.descriptorCount = 1;
-		wdSet.descriptorType = vk::DescriptorType::eUniformBuffer;
+		wdSet.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
 		wdSet.dstBinding = ubo::Model::binding;
 		wdSet.dstSet = dSet;
 		wdSet.pBufferInfo = &dbInfo;
@@ -538,41 +657,49 @@ namespace {
 
 	void record_render_cmds(
 			RenderPass& rPass,
-			RenderPass::PreRenderFunction& preRender,
-			RenderPass::PostRenderFunction& postRender,
 			std::array<RenderPass::RenderFunction, 2>& renderFunctions,
-			RenderPass::ImageData& img, RenderPass::FrameData& frame,
+			RenderPass::FrameHandle& fh,
 			vk::CommandBuffer primaryCmd
 	) {
 		assert(renderFunctions.size() == /* the number of subpasses */ 2);
-		vk::CommandBufferInheritanceInfo cbiInfo;
-		vk::CommandBufferBeginInfo cbbInfo;
+		auto& img = fh.imageData;
+		auto& frame = fh.frameData;
+		unsigned imgIndex = fh.imageIndex;
 		unsigned subpass = 0;
 		unsigned iterations = renderFunctions.size() - 1; // Last iteration does not .nextSubpass(...)
-		RenderPass::FrameHandle fh = { rPass, frame, img };
+		const uint32_t frameUboOffset = rPass.frameUboRing().slotOffset(imgIndex);
+		const uint32_t staticUboOffset = rPass.staticUboRing().slotOffset(imgIndex);
 		const auto runSubpass = [
-				primaryCmd, img,
+				primaryCmd, img, frameUboOffset, staticUboOffset,
 				&rPass, &frame, &fh
 		] (unsigned subpass, RenderPass::RenderFunction& fn) {
 			const auto& drawBuffer = img.cmdBuffers[0];
 			drawBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
 				rPass.pipelineLayout(), ubo::Frame::set,
-				img.frameDescSet,
-				{ });
+				rPass.frameDescriptorSet(),
+				frameUboOffset);
 			drawBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
 				rPass.pipelineLayout(), ubo::Static::set,
-				img.staticDescSet,
-				{ });
+				rPass.staticDescriptorSet(),
+				staticUboOffset);
+			if(img.statisticsPool)  drawBuffer.beginQuery(img.statisticsPool, subpass, { });
 			fn(fh, drawBuffer);
+			if(img.statisticsPool)  drawBuffer.endQuery(img.statisticsPool, subpass);
+		};
+		const auto writeSubpassEnd = [primaryCmd, &img](unsigned subpass) {
+			static_assert(timestamp::eSubpass1End == timestamp::eSubpass0End + 1);
+			if(img.timestampPool) {
+				primaryCmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+					img.timestampPool, timestamp::eSubpass0End + subpass); }
 		};
-		if(preRender)  preRender(fh);
 		for(unsigned i=0; i < iterations; ++i) {
 			runSubpass(subpass, renderFunctions[i]);
+			writeSubpassEnd(subpass);
 			primaryCmd.nextSubpass(vk::SubpassContents::eInline);
 			++subpass;
 		}
 		runSubpass(subpass, renderFunctions.back());
-		if(postRender)  postRender(fh);
+		writeSubpassEnd(subpass);
 	}
 
 }
@@ -596,14 +723,15 @@ namespace vka2 {
 
 
 	void RenderPass::FrameHandle::bindMeshDescriptorSet(
-			vk::CommandBuffer cmd, vk::DescriptorSet dSet
+			vk::CommandBuffer cmd, vk::DescriptorSet dSet, vk::DeviceSize uboOffset
 	) {
 		static_assert(ubo::Model::set == Texture::samplerDescriptorSet);
 		constexpr auto descSetIdx = ubo::Model::set;
 		assert(cmd != vk::CommandBuffer());
 		assert(dSet != vk::DescriptorSet());
+		uint32_t dynOffset = uboOffset;
 		cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-			rpass.pipelineLayout(), descSetIdx, dSet, { });
+			rpass.pipelineLayout(), descSetIdx, dSet, dynOffset);
 	}
 
 
@@ -613,25 +741,87 @@ namespace vka2 {
 		++_data.staticUboBaseWrCounter; // Force the static UBO copies to be invalid (this counter should never be 0)
 		_swapchain = &asc;
 		dev.waitIdle();
-		{ // Create depth/stencil image
+		_data.colorFormat = asc.application->surfaceFormat().format;
+		_data.depthFormat = asc.application->runtime().depthOptimalFmt;
+		_data.sampleCount = asc.application->runtime().bestSampleCount;
+		{ // Screen space outlines sample the depth attachment, which not every depth format allows
+			const auto& depthFmtProps = asc.application->getFormatProperties(_data.depthFormat);
+			_data.outlineMode = _data.requestedOutlineMode;
+			if(
+					(_data.outlineMode == OutlineMode::eScreenSpace) &&
+					! (depthFmtProps.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)
+			) {
+				util::logGeneral()
+					<< "The depth format " << vk::to_string(_data.depthFormat)
+					<< " can't be sampled: falling back to mesh outlines" << util::endl;
+				_data.outlineMode = OutlineMode::eMesh;
+			}
+		} { // Create depth/stencil image
 			_data.depthStencilImg = mk_depthstencil_img(*_swapchain,
-				_swapchain->application->runtime(), _data.renderExtent);  util::alloc_tracker.alloc("RenderPass:_data:depthStencilImg");
+				_swapchain->application->runtime(), _data.renderExtent,
+				_data.outlineMode == OutlineMode::eScreenSpace);  util::alloc_tracker.alloc("RenderPass:_data:depthStencilImg");
 			_data.depthStencilImgView = mk_depthstencil_img_view(
 				*_swapchain, _data.depthStencilImg.handle, false);  util::alloc_tracker.alloc("RenderPass:_data:depthStencilImgView");
 		}
 		_data.swpchnImages.reserve(imgs.size());
+		// The render target has the surface format, so only the extents need to match
+		_data.directToSwapchain = (_data.renderExtent == asc.data.extent);
+		_data.colorFinalLayout = (_data.directToSwapchain && ! asc.isOffscreen())?
+			vk::ImageLayout::ePresentSrcKHR :
+			vk::ImageLayout::eTransferSrcOptimal; // Offscreen images are left ready to be read back
+		_rendering.offscreenImage = 0;
+		_rendering.lastImage = 0;
+		util::logVkDebug() << "Rendering "
+			<< (_data.directToSwapchain? "directly to the swapchain" : "to an intermediate image")
+			<< util::endl;
 		_data.handle = mk_render_pass(asc,
-			asc.application->surfaceFormat().format,
-			asc.application->runtime().depthOptimalFmt, vk::ImageLayout::eTransferSrcOptimal,
-			asc.application->runtime().bestSampleCount, false);  util::alloc_tracker.alloc("RenderPass:_data:handle");
-		_data.staticDescPool = mk_static_desc_pool(dev, imgs.size());  util::alloc_tracker.alloc("RenderPass:_data:staticDescPool");
+			_data.colorFormat, _data.depthFormat, _data.colorFinalLayout,
+			_data.sampleCount, false,
+			_data.outlineMode == OutlineMode::eScreenSpace);  util::alloc_tracker.alloc("RenderPass:_data:handle");
+		{ // Create the UBO rings, and the descriptor sets that address them
+			_data.staticUbos = UboRing(*asc.application, sizeof(ubo::Static), imgs.size(), ubo::Static::dma);
+			_data.frameUbos = UboRing(*asc.application, sizeof(ubo::Frame), imgs.size(), ubo::Frame::dma);
+			for(size_t i=0; i < imgs.size(); ++i) {
+				// Each swapchain image permanently owns the slot with its own index
+				[[maybe_unused]] size_t staticSlot = _data.staticUbos.acquireSlot();
+				[[maybe_unused]] size_t frameSlot = _data.frameUbos.acquireSlot();
+				assert(staticSlot == i && frameSlot == i);
+			}
+			_data.staticDescPool = mk_static_desc_pool(dev);  util::alloc_tracker.alloc("RenderPass:_data:staticDescPool");
+			auto mkDescSet = [this, dev](
+					vk::DescriptorSetLayout layout, unsigned binding, const UboRing& ring
+			) {
+				vk::DescriptorSetAllocateInfo dsaInfo;
+				dsaInfo.descriptorPool = _data.staticDescPool;
+				dsaInfo.descriptorSetCount = 1;
+				dsaInfo.setSetLayouts(layout);
+				vk::DescriptorSet r = dev.allocateDescriptorSets(dsaInfo).front();
+				vk::DescriptorBufferInfo dbInfo = ring.descriptorInfo();
+				vk::WriteDescriptorSet wr;
+				wr.descriptorCount = 1;
+				wr.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+				wr.dstArrayElement = 0;
+				wr.dstBinding = binding;
+				wr.dstSet = r;
+				wr.setBufferInfo(dbInfo);
+				dev.updateDescriptorSets(wr, { });
+				return r;
+			};
+			_data.staticDescSet = mkDescSet(_data.descsetLayouts[ubo::Static::set],
+				ubo::Static::binding, _data.staticUbos);
+			_data.frameDescSet = mkDescSet(_data.descsetLayouts[ubo::Frame::set],
+				ubo::Frame::binding, _data.frameUbos);
+			set_material_table_descriptor(dev, _data.staticDescSet, _data.materialTable.handle);
+			if(_data.outlineMode == OutlineMode::eScreenSpace) {
+				set_depth_sampler_descriptor(dev, _data.staticDescSet,
+					_data.depthStencilImgView, _data.depthSampler); }
+		}
 		for(auto img : imgs) {
 			_data.swpchnImages.emplace_back(img, imgref::mk_data(
-				asc, _data.handle,
-				_data.staticDescPool, _data.descsetLayouts,
+				asc, _data.handle, img,
 				_data.renderExtent, _data.depthStencilImgView,
 				asc.application->queueFamilyIndices().graphics,
-				_data.useMultisampling));
+				_data.useMultisampling, _data.directToSwapchain));
 		}  util::alloc_tracker.alloc("RenderPass:_data:swpchnImages[...]", imgs.size());
 	}
 
@@ -640,6 +830,8 @@ namespace vka2 {
 		auto dev = _swapchain->application->device();
 		dev.waitIdle();
 		dev.destroyDescriptorPool(_data.staticDescPool);  util::alloc_tracker.dealloc("RenderPass:_data:staticDescPool");
+		_data.frameUbos.destroy();
+		_data.staticUbos.destroy();
 		_swapchain->application->device().destroyRenderPass(_data.handle);  util::alloc_tracker.dealloc("RenderPass:_data:handle");
 		for(auto& img : _data.swpchnImages) {
 			imgref::destroy_data(*_swapchain, img.second); }  util::alloc_tracker.dealloc("RenderPass:_data:swpchnImages[...]", _data.swpchnImages.size());
@@ -660,19 +852,29 @@ namespace vka2 {
 			vk::Extent2D renderExtent,
 			unsigned short maxConcurrentFrames,
 			bool useMultisampling,
+			OutlineMode outlineMode,
 			SwapchainOutdatedCallback onOod
 	) {
 		auto dev = asc.application->device();
 		_rendering = { };
 		_data.useMultisampling = useMultisampling;
+		_data.requestedOutlineMode = outlineMode;
 		_data.renderExtent = renderExtent;
 		swapchainOutdatedCallback = onOod;
 		_data.descsetLayouts = mk_descset_layouts(asc.application->device());  util::alloc_tracker.alloc("RenderPass:_data:descsetLayouts", _data.descsetLayouts.size());
 		_data.pipelineLayout = mk_pipeline_layout(asc.application->device(),
 			_data.descsetLayouts);  util::alloc_tracker.alloc("RenderPass:_data:pipelineLayout");
 		_data.staticUboBaseWrCounter = 0; // Initial state, *must* be 0
-		_data.staticUboBase = mk_static_ubo_base(asc.application->allocator());  util::alloc_tracker.alloc("RenderPass:_data:staticUboBase");
+		_data.cmdBufferVersion = 1; // Never 0, which marks command buffers that can't be reused
+		_data.staticUboBase = { };
+		{ // Create a material table with a single blank entry, so that its descriptor is always valid
+			_data.materialTableCapacity = 1;
+			_data.materialTable = mk_material_table(*asc.application, _data.materialTableCapacity);  util::alloc_tracker.alloc("RenderPass:_data:materialTable");
+			_data.materialTablePtr = asc.application->mapBuffer<ssbo::MaterialTable::Entry>(_data.materialTable.alloc);
+			_data.materialTablePtr[0] = { };
+		}
 		_data.frames = frame::mk_frames(dev, maxConcurrentFrames);
+		_data.depthSampler = mk_depth_sampler(dev);  util::alloc_tracker.alloc("RenderPass:_data:depthSampler");
 		_assign(asc);
 		util::alloc_tracker.alloc("RenderPass");
 	}
@@ -683,8 +885,9 @@ namespace vka2 {
 		dev.waitIdle();
 		_unassign();
 		frame::destroy_frames(*this, _data.frames);
-		vmaDestroyBuffer(_swapchain->application->allocator(),
-			_data.staticUboBase.handle, _data.staticUboBase.alloc);  util::alloc_tracker.dealloc("RenderPass:_data:staticUboBase");
+		dev.destroySampler(_data.depthSampler);  util::alloc_tracker.dealloc("RenderPass:_data:depthSampler");
+		_swapchain->application->unmapBuffer(_data.materialTable.alloc);
+		_swapchain->application->destroyBuffer(_data.materialTable);  util::alloc_tracker.dealloc("RenderPass:_data:materialTable");
 		dev.destroyPipelineLayout(_data.pipelineLayout);  util::alloc_tracker.dealloc("RenderPass:_data:pipelineLayout");
 		for(auto& layout : _data.descsetLayouts) {
 			dev.destroyDescriptorSetLayout(layout);
@@ -715,7 +918,7 @@ namespace vka2 {
 
 		DynDescriptorPool::PoolConstructor constructor = [app](size_t sets) {
 			auto sizes = std::array<vk::DescriptorPoolSize, 2> {
-				vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, sets),
+				vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, sets),
 				vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 3 * sets)
 			};
 			vk::DescriptorPoolCreateInfo dpcInfo;
@@ -767,12 +970,26 @@ namespace vka2 {
 
 	void RenderPass::setStaticUbo(const ubo::Static& ubo) {
 		assert((_swapchain != nullptr) && (_swapchain->application != nullptr));
-		auto& app = *_swapchain->application;
+		// Each swapchain image copies the UBO to its own slot, after waiting on its own fence
+		_data.staticUboBase = ubo;
 		++_data.staticUboBaseWrCounter;
-		app.stageBufferData(
-			_data.staticUboBase.handle,
-			reinterpret_cast<const void*>(&ubo),
-			sizeof(ubo::Static));
+	}
+
+
+	void RenderPass::setMaterialTable(const std::vector<ssbo::MaterialTable::Entry>& entries) {
+		assert((_swapchain != nullptr) && (_swapchain->application != nullptr));
+		auto& app = *_swapchain->application;
+		app.device().waitIdle(); // The table is shared by all frames
+		if(entries.size() > _data.materialTableCapacity) {
+			app.unmapBuffer(_data.materialTable.alloc);
+			app.destroyBuffer(_data.materialTable);
+			_data.materialTableCapacity = entries.size();
+			_data.materialTable = mk_material_table(app, _data.materialTableCapacity);
+			_data.materialTablePtr = app.mapBuffer<ssbo::MaterialTable::Entry>(_data.materialTable.alloc);
+			set_material_table_descriptor(app.device(), _data.staticDescSet, _data.materialTable.handle);
+			invalidateCommandBuffers();
+		}
+		std::copy(entries.begin(), entries.end(), _data.materialTablePtr);
 	}
 
 
@@ -782,11 +999,12 @@ namespace vka2 {
 			PostRenderFunction postRender,
 			std::array<RenderFunction, 2> renderFunctions
 	) {
-		util::PerfTracker perfTracker;
+		auto& perfTracker = _rendering.perfTracker;
 		perfTracker.movingAverageDecay = util::perfTracker.movingAverageDecay;
-		#define PERF_BEG_(NM_) auto timer_ ## NM_ = perfTracker.startTimer("rpass." #NM_);
+		#define PERF_BEG_(NM_) auto timer_ ## NM_ = perfTracker.startTimer(PERF_ID("rpass." #NM_));
 		#define PERF_END_(NM_) perfTracker.stopTimer(timer_ ## NM_);
 		vk::Device dev = _swapchain->application->device();
+		const bool offscreen = _swapchain->isOffscreen();
 		unsigned imgIndex; // Swapchain image
 		auto& frame = _data.frames[_rendering.frame];
 		ImageRef* img;
@@ -814,12 +1032,18 @@ namespace vka2 {
 			if(_rendering.skipNextFrame) {
 				return _rendering.skipNextFrame = false;
 			}
-			auto acquired = tryAcquireSwpchnImage(dev, _swapchain->handle,
-				frame.imgAcquiredSem, nullptr);
-			imgIndex = acquired.value;
-			if(acquired.result == vk::Result::eErrorOutOfDateKHR) {
-				onSwpChnOutOfDate(imgIndex);
-				return false;
+			if(offscreen) {
+				// Offscreen images are cycled through in order, and are available as soon as their fence is signaled
+				imgIndex = _rendering.offscreenImage;
+				_rendering.offscreenImage = (_rendering.offscreenImage + 1) % _data.swpchnImages.size();
+			} else {
+				auto acquired = tryAcquireSwpchnImage(dev, _swapchain->handle,
+					frame.imgAcquiredSem, nullptr);
+				imgIndex = acquired.value;
+				if(acquired.result == vk::Result::eErrorOutOfDateKHR) {
+					onSwpChnOutOfDate(imgIndex);
+					return false;
+				}
 			}
 			img = &_data.swpchnImages[imgIndex];
 			PERF_END_(acquireImage)
@@ -828,128 +1052,142 @@ namespace vka2 {
 			auto blitCmd = img->second.cmdBuffers[1];
 			auto colorSubresRange = vk::ImageSubresourceRange(
 				vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
-			PERF_BEG_(recordCmd)
-			{ // Begin recording the cmd buffer
-				{ // Wait for the swapchain image to be available first
-					tryWaitForFences(dev, img->second.fenceImgAvailable, true, UINT64_MAX);
-					dev.resetFences(img->second.fenceImgAvailable);
-				} {
-					dev.resetCommandPool(img->second.cmdPool);
-					renderCmd.begin(vk::CommandBufferBeginInfo(
-						vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+			RenderPass::FrameHandle fh = { *this, frame, img->second, imgIndex };
+			{ // Wait for the swapchain image to be available first
+				tryWaitForFences(dev, img->second.fenceImgAvailable, true, UINT64_MAX);
+				dev.resetFences(img->second.fenceImgAvailable);
+			} { // Read the queries of the image's previous frame, now that they're available
+				if(img->second.queriesPending) {
+					timestamp::read(dev, _swapchain->application->runtime(), img->second,
+						! _data.directToSwapchain, perfTracker);
+					statistics::read(dev, img->second, perfTracker);
+					img->second.queriesPending = false;
 				}
-			} { // Transition the render target image to a drawable layout
-				auto barrier = mk_img_barrier(img->second.renderTarget.handle, colorSubresRange,
-					vk::ImageLayout::eUndefined,               vk::AccessFlagBits::eNoneKHR,
-					vk::ImageLayout::eColorAttachmentOptimal,  vk::AccessFlagBits::eColorAttachmentWrite);
-				renderCmd.pipelineBarrier(
-					vk::PipelineStageFlagBits::eTopOfPipe,
-					vk::PipelineStageFlagBits::eColorAttachmentOutput,
-					vk::DependencyFlagBits(0), { }, { }, barrier);
-			} { // Begin the render pass
-				const auto clearValues = std::array<vk::ClearValue, 2>{
-					vk::ClearColorValue(
-						_swapchain->application->options().worldParams.clearColor),
-					vk::ClearDepthStencilValue(1.0f, 0.0f) };
-				vk::RenderPassBeginInfo rpbInfo;
-				rpbInfo.renderPass = _data.handle;
-				rpbInfo.framebuffer = img->second.framebuffer;
-				rpbInfo.setClearValues(clearValues);
-				rpbInfo.renderArea = vk::Rect2D({ 0, 0 }, _data.renderExtent);
-				renderCmd.beginRenderPass(rpbInfo, vk::SubpassContents::eInline);
-			} { // Update the UBO descriptors
-				vk::WriteDescriptorSet wr;
-				vk::DescriptorBufferInfo dbInfo;
-				wr.pBufferInfo = &dbInfo;
-				wr.descriptorCount = 1;
-				wr.descriptorType = vk::DescriptorType::eUniformBuffer;
-				wr.dstArrayElement = 0;
-				{ // Begin to update the image's static UBO, if necessary
-					if(_data.staticUboBaseWrCounter != img->second.staticUboWrCounter) {
-						imgref::update_static_ubo(*_swapchain,
-							img->second, _data.staticUboBase, _data.staticUboBaseWrCounter);
-						dbInfo.buffer = img->second.staticUbo.handle;
-						dbInfo.range = sizeof(ubo::Static);
-						wr.dstBinding = ubo::Static::binding;
-						wr.dstSet = img->second.staticDescSet;
-						dev.updateDescriptorSets(wr, { });
-					}
-				} { // Update the frame UBO's descriptor set
-					dbInfo.buffer = img->second.frameUbo.handle;
-					dbInfo.range = sizeof(ubo::Frame);
-					wr.dstBinding = ubo::Frame::binding;
-					wr.dstSet = img->second.frameDescSet;
-					dev.updateDescriptorSets(wr, { });
+			} { // Update the image's static UBO slot, if necessary
+				static_assert(ubo::Static::dma);
+				if(_data.staticUboBaseWrCounter != img->second.staticUboWrCounter) {
+					// The image's fence has been waited on, so the device isn't reading the slot
+					memcpy(_data.staticUbos.slotPtr(imgIndex), &_data.staticUboBase, sizeof(ubo::Static));
+					img->second.staticUboWrCounter = _data.staticUboBaseWrCounter;
 				}
-			} { // Mmap the frame UBO, wait for fences, then run the passed function
-				void* frameUboPtr;
+			} { // Write the frame UBO to its persistently mapped slot
 				static_assert(ubo::Frame::dma);
-				{
-					VkResult result = vmaMapMemory(_swapchain->application->allocator(),
-						img->second.frameUbo.alloc, &frameUboPtr);
-					if(result != VK_SUCCESS) {
-						throw std::runtime_error(formatVkErrorMsg(
-							"failed to mmap a frame UBO buffer", util::enum_str(result)));
-					}
-					memcpy(frameUboPtr, &frameUbo, sizeof(ubo::Frame));  static_assert(std::is_same_v<ubo::Frame, std::remove_const_t<std::remove_reference_t<decltype(frameUbo)>>>);
-					vmaUnmapMemory(_swapchain->application->allocator(), img->second.frameUbo.alloc);
-				} {
-					record_render_cmds(*this,
-						preRender, postRender, renderFunctions,
-						img->second, frame, renderCmd);
+				memcpy(_data.frameUbos.slotPtr(imgIndex), &frameUbo, sizeof(ubo::Frame));  static_assert(std::is_same_v<ubo::Frame, std::remove_const_t<std::remove_reference_t<decltype(frameUbo)>>>);
+			}
+			// The pre-render function always runs, as it may invalidate the recorded commands
+			if(preRender)  preRender(fh);
+			bool reuseCmds = _swapchain->application->options().viewParams.reuseCommandBuffers;
+			if((! reuseCmds) || (img->second.recordedVersion != _data.cmdBufferVersion)) {
+				PERF_BEG_(recordCmd)
+				auto cmdUsage = reuseCmds?
+					vk::CommandBufferUsageFlags() :
+					vk::CommandBufferUsageFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+				{ // Begin recording the cmd buffer
+					dev.resetCommandPool(img->second.cmdPool);
+					renderCmd.begin(vk::CommandBufferBeginInfo(cmdUsage));
 				}
-			} { // End the render pass
-				renderCmd.endRenderPass();
-				renderCmd.end();
-			} { // Record the blit-to-present cmd buffer
-				blitCmd.begin(vk::CommandBufferBeginInfo(
-					vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
-				{ // Transition the src and dst image layouts
-					std::array<vk::ImageMemoryBarrier, 2> imgBarriers = {
-						mk_img_barrier(img->first, colorSubresRange,
-							vk::ImageLayout::eUndefined,           vk::AccessFlagBits::eNoneKHR,
-							vk::ImageLayout::eTransferDstOptimal,  vk::AccessFlagBits::eTransferWrite),
-						mk_img_barrier(img->second.renderTarget.handle, colorSubresRange,
-							vk::ImageLayout::eUndefined,           vk::AccessFlagBits::eNoneKHR,
-							vk::ImageLayout::eTransferSrcOptimal,  vk::AccessFlagBits::eTransferRead) };
-					blitCmd.pipelineBarrier(
+				// Queries must be reset before every use, which includes reused cmd buffers
+				if(img->second.statisticsPool) {
+					renderCmd.resetQueryPool(img->second.statisticsPool, 0, statistics::subpassCount); }
+				if(img->second.timestampPool) {
+					renderCmd.resetQueryPool(img->second.timestampPool, 0, timestamp::eCount);
+					renderCmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+						img->second.timestampPool, timestamp::eRenderBegin);
+				}
+				if(img->second.renderTarget.handle) { // Transition the render target image to a drawable layout
+					auto barrier = mk_img_barrier(img->second.renderTarget.handle, colorSubresRange,
+						vk::ImageLayout::eUndefined,               vk::AccessFlagBits::eNoneKHR,
+						vk::ImageLayout::eColorAttachmentOptimal,  vk::AccessFlagBits::eColorAttachmentWrite);
+					renderCmd.pipelineBarrier(
+						vk::PipelineStageFlagBits::eTopOfPipe,
 						vk::PipelineStageFlagBits::eColorAttachmentOutput,
-						vk::PipelineStageFlagBits::eTransfer,
-						vk::DependencyFlagBits(0), { }, { }, imgBarriers);
-				} { // Blit the image
-					vk::ImageBlit blit;
-					auto& options = _swapchain->application->options();
-					blit.srcOffsets[0] = vk::Offset3D { };
-					blit.srcOffsets[1] = vk::Offset3D {
-						(int32_t) _data.renderExtent.width,
-						(int32_t) _data.renderExtent.height, 1 };
-					blit.dstOffsets[0] = vk::Offset3D { };
-					blit.dstOffsets[1] = vk::Offset3D {
-						(int32_t) _swapchain->data.extent.width,
-						(int32_t) _swapchain->data.extent.height, 1 };
-					blit.srcSubresource = blit.dstSubresource = vk::ImageSubresourceLayers(
-						vk::ImageAspectFlagBits::eColor, 0, 0, 1);
-					blitCmd.blitImage(
-						_data.useMultisampling?
-							img->second.resolveTarget.handle :
-							img->second.renderTarget.handle,
-						vk::ImageLayout::eTransferSrcOptimal,
-						img->first, vk::ImageLayout::eTransferDstOptimal,
-						blit, options.viewParams.upscaleNearestFilter?
-							vk::Filter::eNearest : vk::Filter::eLinear);
-				} { // Transition the dst image layout to present
-					auto imgBarrier = {
-						mk_img_barrier(img->first, colorSubresRange,
-							vk::ImageLayout::eTransferDstOptimal,  vk::AccessFlagBits::eTransferWrite,
-							vk::ImageLayout::ePresentSrcKHR,       vk::AccessFlagBits::eNoneKHR) };
-					blitCmd.pipelineBarrier(
-						vk::PipelineStageFlagBits::eTransfer,
-						vk::PipelineStageFlagBits::eTransfer,
-						vk::DependencyFlagBits(0), { }, { }, imgBarrier);
+						vk::DependencyFlagBits(0), { }, { }, barrier);
+				}
+				{ // Begin the render pass
+					const auto clearValues = std::array<vk::ClearValue, 2>{
+						vk::ClearColorValue(
+							_swapchain->application->options().worldParams.clearColor),
+						vk::ClearDepthStencilValue(1.0f, 0.0f) };
+					vk::RenderPassBeginInfo rpbInfo;
+					rpbInfo.renderPass = _data.handle;
+					rpbInfo.framebuffer = img->second.framebuffer;
+					rpbInfo.setClearValues(clearValues);
+					rpbInfo.renderArea = vk::Rect2D({ 0, 0 }, _data.renderExtent);
+					renderCmd.beginRenderPass(rpbInfo, vk::SubpassContents::eInline);
+				} { // Set the dynamic state, which lasts for the whole command buffer
+					renderCmd.setLineWidth(LINE_WIDTH);
+					renderCmd.setViewport(0, vk::Viewport(0.0f, 0.0f,
+						static_cast<float>(_data.renderExtent.width),
+						static_cast<float>(_data.renderExtent.height), 0.0f, 1.0f));
+					renderCmd.setScissor(0, vk::Rect2D({ 0, 0 }, _data.renderExtent));
+				} { // Run the passed functions
+					record_render_cmds(*this, renderFunctions, fh, renderCmd);
+				} { // End the render pass
+					renderCmd.endRenderPass();
+					renderCmd.end();
+				}
+				if(! _data.directToSwapchain) { // Record the blit-to-present cmd buffer
+					blitCmd.begin(vk::CommandBufferBeginInfo(cmdUsage));
+					{ // Transition the src and dst image layouts
+						std::array<vk::ImageMemoryBarrier, 2> imgBarriers = {
+							mk_img_barrier(img->first, colorSubresRange,
+								vk::ImageLayout::eUndefined,           vk::AccessFlagBits::eNoneKHR,
+								vk::ImageLayout::eTransferDstOptimal,  vk::AccessFlagBits::eTransferWrite),
+							mk_img_barrier(img->second.renderTarget.handle, colorSubresRange,
+								vk::ImageLayout::eUndefined,           vk::AccessFlagBits::eNoneKHR,
+								vk::ImageLayout::eTransferSrcOptimal,  vk::AccessFlagBits::eTransferRead) };
+						blitCmd.pipelineBarrier(
+							vk::PipelineStageFlagBits::eColorAttachmentOutput,
+							vk::PipelineStageFlagBits::eTransfer,
+							vk::DependencyFlagBits(0), { }, { }, imgBarriers);
+						if(img->second.timestampPool) { // After the barrier, so that it doesn't count the wait for the render pass
+							blitCmd.writeTimestamp(vk::PipelineStageFlagBits::eTransfer,
+								img->second.timestampPool, timestamp::eBlitBegin); }
+					} { // Blit the image
+						vk::ImageBlit blit;
+						auto& options = _swapchain->application->options();
+						blit.srcOffsets[0] = vk::Offset3D { };
+						blit.srcOffsets[1] = vk::Offset3D {
+							(int32_t) _data.renderExtent.width,
+							(int32_t) _data.renderExtent.height, 1 };
+						blit.dstOffsets[0] = vk::Offset3D { };
+						blit.dstOffsets[1] = vk::Offset3D {
+							(int32_t) _swapchain->data.extent.width,
+							(int32_t) _swapchain->data.extent.height, 1 };
+						blit.srcSubresource = blit.dstSubresource = vk::ImageSubresourceLayers(
+							vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+						blitCmd.blitImage(
+							_data.useMultisampling?
+								img->second.resolveTarget.handle :
+								img->second.renderTarget.handle,
+							vk::ImageLayout::eTransferSrcOptimal,
+							img->first, vk::ImageLayout::eTransferDstOptimal,
+							blit, options.viewParams.upscaleNearestFilter?
+								vk::Filter::eNearest : vk::Filter::eLinear);
+					} { // Transition the dst image layout to present, or to be read back
+						auto imgBarrier = {
+							_swapchain->isOffscreen()?
+								mk_img_barrier(img->first, colorSubresRange,
+									vk::ImageLayout::eTransferDstOptimal,  vk::AccessFlagBits::eTransferWrite,
+									vk::ImageLayout::eTransferSrcOptimal,  vk::AccessFlagBits::eTransferRead) :
+								mk_img_barrier(img->first, colorSubresRange,
+									vk::ImageLayout::eTransferDstOptimal,  vk::AccessFlagBits::eTransferWrite,
+									vk::ImageLayout::ePresentSrcKHR,       vk::AccessFlagBits::eNoneKHR) };
+						blitCmd.pipelineBarrier(
+							vk::PipelineStageFlagBits::eTransfer,
+							vk::PipelineStageFlagBits::eTransfer,
+							vk::DependencyFlagBits(0), { }, { }, imgBarrier);
+					}
+					if(img->second.timestampPool) {
+						blitCmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+							img->second.timestampPool, timestamp::eBlitEnd); }
+					blitCmd.end();
 				}
-				blitCmd.end();
+				img->second.recordedVersion = reuseCmds? _data.cmdBufferVersion : 0;
 				PERF_END_(recordCmd)
-			} { // Submit the cmd buffers
+			}
+			if(postRender)  postRender(fh);
+			{ // Submit the cmd buffers
 				PERF_BEG_(submitCmd)
 				std::array<vk::PipelineStageFlags, 1> waitStages =
 					{ vk::PipelineStageFlagBits::eColorAttachmentOutput };
@@ -957,12 +1195,25 @@ namespace vka2 {
 				auto sInfo = std::array<vk::SubmitInfo, 2> {
 					vk::SubmitInfo(frame.imgAcquiredSem, waitStages, renderCmd, frame.renderDoneSem),
 					vk::SubmitInfo(frame.renderDoneSem, waitStages, blitCmd, frame.blitToSurfaceDoneSem) };
-				graphicsQueue.submit(sInfo, img->second.fenceImgAvailable);
+				// The render pass leaves the swapchain image ready to be presented, when rendering to it directly
+				uint32_t sInfoCount = _data.directToSwapchain? 1 : 2;
+				if(offscreen) {
+					// Nothing signals the acquire semaphore, and nothing would wait for the last signal
+					sInfo[0].setWaitSemaphores({ });
+					sInfo[0].setWaitDstStageMask({ });
+					sInfo[sInfoCount - 1].setSignalSemaphores({ });
+				}
+				graphicsQueue.submit(
+					vk::ArrayProxy<const vk::SubmitInfo>(sInfoCount, sInfo.data()),
+					img->second.fenceImgAvailable);
+				_rendering.lastImage = imgIndex + 1;
+				img->second.queriesPending = img->second.timestampPool || img->second.statisticsPool;
 				PERF_END_(submitCmd)
-			} { // Here's a present!
+			} if(! offscreen) { // Here's a present!
 				PERF_BEG_(present)
 				vk::PresentInfoKHR pInfo = { };
-				pInfo.setWaitSemaphores(frame.blitToSurfaceDoneSem);
+				pInfo.setWaitSemaphores(_data.directToSwapchain?
+					frame.renderDoneSem : frame.blitToSurfaceDoneSem);
 				pInfo.setSwapchains(_swapchain->handle);
 				pInfo.setImageIndices(imgIndex);
 				auto result = _swapchain->application->presentQueue().presentKHR(&pInfo);
@@ -982,9 +1233,62 @@ namespace vka2 {
 		}
 		_rendering.frame = (_rendering.frame + 1) % _data.frames.size();
 		util::perfTracker |= perfTracker;
+		perfTracker.reset();
 		return true;
 		#undef PERF_BEG_
 		#undef PERF_END_
 	}
 
+
+	std::vector<uint8_t> RenderPass::readbackLastImage() {
+		assert(_swapchain != nullptr);
+		assert(_swapchain->isOffscreen() && "Only offscreen images are left in a readable layout");
+		if(_rendering.lastImage == 0)  return { };
+		auto& app = *_swapchain->application;
+		auto& img = _data.swpchnImages[_rendering.lastImage - 1];
+		const vk::Extent2D& ext = _swapchain->data.extent;
+		constexpr size_t texelSize = 4; // The offscreen format is always 8-bit BGRA
+		std::vector<uint8_t> r;
+		BufferAlloc buffer;
+		{ // Create a host visible buffer for the image
+			vk::BufferCreateInfo bcInfo;
+			bcInfo.size = size_t(ext.width) * size_t(ext.height) * texelSize;
+			bcInfo.sharingMode = vk::SharingMode::eExclusive;
+			bcInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+			buffer = app.createBuffer(bcInfo,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				vk::MemoryPropertyFlagBits::eHostCached);
+			r.resize(bcInfo.size);
+		} { // Wait for the frame, then copy the image
+			tryWaitForFences(app.device(), img.second.fenceImgAvailable, true, UINT64_MAX);
+			app.graphicsCommandPool().runCmds(app.queues().graphics, [&](vk::CommandBuffer cmd) {
+				{ // The fence doesn't make the frame's writes visible to other submissions
+					vk::ImageMemoryBarrier barrier;
+					barrier.image = img.first;
+					barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+					barrier.srcQueueFamilyIndex = barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.oldLayout = barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+					barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eTransferWrite;
+					barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+					cmd.pipelineBarrier(
+						vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer,
+						vk::PipelineStageFlagBits::eTransfer,
+						vk::DependencyFlagBits(0), { }, { }, barrier);
+				}
+				vk::BufferImageCopy cp;
+				cp.bufferOffset = 0;
+				cp.bufferRowLength = cp.bufferImageHeight = 0; // Tightly packed
+				cp.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+				cp.imageExtent = vk::Extent3D(ext.width, ext.height, 1);
+				cmd.copyImageToBuffer(img.first, vk::ImageLayout::eTransferSrcOptimal, buffer.handle, cp);
+			});
+		} { // Copy the buffer to host memory
+			auto* mmapd = app.mapBuffer<uint8_t>(buffer.alloc);
+			memcpy(r.data(), mmapd, r.size());
+			app.unmapBuffer(buffer.alloc);
+			app.destroyBuffer(buffer);
+		}
+		return r;
+	}
+
 }
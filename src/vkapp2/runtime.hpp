@@ -39,10 +39,32 @@ namespace vka2 {
 		vk::Format depthOptimalFmt = vk::Format::eD32Sfloat;
 		vk::SampleCountFlagBits bestSampleCount = vk::SampleCountFlagBits::e1;
 		unsigned samplerAnisotropy = 1;
+		float timestampPeriodNs = 0.0f; // How long a timestamp tick is; 0 if the graphics queue can't write timestamps
+		uint64_t timestampMask = 0; // The valid bits of a timestamp written by the graphics queue
+		bool pipelineStatistics = false; // Whether pipeline statistics queries are enabled
 		bool fullscreen = false;
 	};
 
 
+	/** Parameters that come from the command line, rather than from the
+	 * configuration file: they describe how the application is being run,
+	 * not how it looks. */
+	struct LaunchParams {
+		bool headless = false; // Render to offscreen images, without a window, a surface or a swapchain
+		unsigned long frameLimit = 0; // Quit after rendering this many frames; 0 means no limit
+		std::string readbackPath; // Headless only: the last frame is written here as a PPM image, if not empty
+		std::string benchmarkReport; // Run the scripted benchmark, and write its report here; empty means no benchmark
+		std::string benchmarkBaseline; // A CSV report the benchmark is compared against, if not empty
+		double benchmarkTolerance = 0.1; // How much a statistic may grow relative to the baseline
+		std::string tracePath; // Record timer spans, and write them here as a Chrome trace on exit; empty means no tracing
+		double traceThresholdMs = 0.0; // Also write a trace after any frame slower than this, if positive
+		bool pipelineStatistics = false; // Count the primitives and shader invocations of each subpass
+		bool nullDevice = false; // Headless only: load the null Vulkan driver instead of the system's ones
+
+		bool benchmark() const { return ! benchmarkReport.empty(); }
+	};
+
+
 	template<typename Param>
 	std::string formatVkErrorMsg(
 			const std::string& message, Param param
@@ -135,6 +135,7 @@ namespace vka2 {
 		GET_SETTING(shaderParams, outlineSize, float);
 		GET_SETTING(shaderParams, outlineDepth, float);
 		GET_SETTING(shaderParams, outlineRndMorph, float);
+		GET_SETTING(shaderParams, outlineMode, std::string);
 		GET_SETTING_ARRAY(worldParams, clearColor, float);
 		GET_SETTING_ARRAY(worldParams, lightDirection, float);
 		GET_SETTING(worldParams, diffuseNearestFilter, bool);
@@ -154,7 +155,10 @@ namespace vka2 {
 		GET_SETTING(viewParams, viewMoveSpeed, float);
 		GET_SETTING(viewParams, viewMoveSpeedMod, float);
 		GET_SETTING(viewParams, frameFrequencyS, float);
+		GET_SETTING(viewParams, framePacing, std::string);
+		GET_SETTING(viewParams, simFrequencyS, float);
 		GET_SETTING(viewParams, upscaleNearestFilter, bool);
+		GET_SETTING(viewParams, reuseCommandBuffers, bool);
 		#undef GET_SETTING
 		#undef GET_SETTING_ARRAY
 		cfg.writeFile(path.c_str());
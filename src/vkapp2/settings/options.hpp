@@ -46,6 +46,8 @@ namespace vka2 {
 			float outlineDepth = 1.0f / 20.0f;
 			// The maximum variation of an outline vertex (relative to outlineSize, should be >= 0).
 			float outlineRndMorph = 1.0f / 10.0f;
+			// How outlines are drawn: "mesh" (objects are drawn again, extruded) or "screen" (edge detection on the depth buffer).
+			std::string outlineMode = "screen";
 		} shaderParams;
 		struct WorldParams {
 			// The default color for unused pixels.
@@ -90,8 +92,14 @@ namespace vka2 {
 			float viewMoveSpeedMod = 12.0f;
 			// How frequently to render frames (1 / seconds).
 			float frameFrequencyS = 60.0f;
+			// How to wait between frames: "sleep", "hybrid" (sleep, then spin) or "deadline" (begin frames as late as possible).
+			std::string framePacing = "hybrid";
+			// How frequently the view and the light are moved, independently of the frame rate (1 / seconds).
+			float simFrequencyS = 120.0f;
 			// Whether to use the nearest neighbor filter instead of the linear filter when upscaling the rendered image.
 			bool upscaleNearestFilter:1 = true;
+			// Whether to keep recorded command buffers across frames, re-recording them only when the scene's structure changes.
+			bool reuseCommandBuffers:1 = false;
 		} viewParams;
 
 
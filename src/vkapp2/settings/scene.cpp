@@ -76,6 +76,7 @@ namespace vka2 {
 				GET_VALUE(specular,      float)
 				GET_VALUE(shininess,     float)
 				GET_VALUE(celLevels,     unsigned)
+				GET_VALUE(lodBias,       float)
 				GET_VALUE(mergeVertices, bool)
 				r.materials.emplace_back(std::move(mtl));
 			}
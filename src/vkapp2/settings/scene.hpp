@@ -50,6 +50,7 @@ namespace vka2 {
 			float specular = 0.3f;
 			float shininess = 16.0f;
 			uint_least16_t celLevels = 6;
+			float lodBias = 0.0f;
 			bool mergeVertices:1 = false;
 		};
 
@@ -204,6 +204,49 @@ namespace vka2 {
 	}
 
 
+	AbstractSwapchain AbstractSwapchain::offscreen(
+			Application& app,
+			const vk::Extent2D& extent,
+			unsigned short imageCount
+	) {
+		AbstractSwapchain r;
+		r.application = &app;
+		r.handle = nullptr;
+		r.data.extent = extent;
+		app.device().waitIdle();
+		util::alloc_tracker.alloc("AbstractSwapchain");
+		{ // Create the images that would otherwise be owned by the presentation engine
+			vk::ImageCreateInfo icInfo;
+			icInfo.imageType = vk::ImageType::e2D;
+			icInfo.format = app.surfaceFormat().format;
+			icInfo.extent = vk::Extent3D(extent.width, extent.height, 1);
+			icInfo.mipLevels = 1;
+			icInfo.arrayLayers = 1;
+			icInfo.samples = vk::SampleCountFlagBits::e1;
+			icInfo.tiling = IMAGE_TILING;
+			icInfo.usage =
+				vk::ImageUsageFlagBits::eColorAttachment |
+				vk::ImageUsageFlagBits::eTransferDst |
+				vk::ImageUsageFlagBits::eTransferSrc; // Read back
+			icInfo.sharingMode = vk::SharingMode::eExclusive;
+			icInfo.initialLayout = vk::ImageLayout::eUndefined;
+			r.data.offscreenImages.reserve(imageCount);
+			r.data.images.reserve(imageCount);
+			for(unsigned i=0; i < imageCount; ++i) {
+				r.data.offscreenImages.push_back(app.createImage(icInfo,
+					vk::MemoryPropertyFlagBits::eDeviceLocal));
+				r.data.images.push_back(r.data.offscreenImages.back().handle);
+			}
+			util::alloc_tracker.alloc("AbstractSwapchain:data:offscreenImages[...]", imageCount);
+			util::alloc_tracker.alloc("AbstractSwapchain:data:images[...]", 5);
+		}
+		util::logVkDebug()
+			<< "Created offscreen swapchain (" << imageCount << " images, "
+			<< extent.width << 'x' << extent.height << ')' << util::endl;
+		return r;
+	}
+
+
 	vk::SwapchainKHR AbstractSwapchain::destroy(bool keep) {
 		// Destroy all the owned swapchain "images"
 		/* NOP, since the only field in Image is not owned by the application
@@ -213,6 +256,17 @@ namespace vka2 {
 		data.images.clear();
 		util::alloc_tracker.dealloc("AbstractSwapchain:data:images[...]", 5);
 
+		if(isOffscreen()) {
+			// There is no handle to keep
+			for(auto& img : data.offscreenImages) {
+				application->destroyImage(img); }
+			util::alloc_tracker.dealloc("AbstractSwapchain:data:offscreenImages[...]", data.offscreenImages.size());
+			data.offscreenImages.clear();
+			util::logVkDebug() << "Destroyed offscreen swapchain" << util::endl;
+			util::alloc_tracker.dealloc("AbstractSwapchain");
+			return nullptr;
+		}
+
 		if(keep) {
 			util::logVkDebug()
 				<< "Destroyed swapchain " << static_cast<VkSwapchainKHR>(handle)
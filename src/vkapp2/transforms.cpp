@@ -0,0 +1,329 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+#include "vkapp2/transforms.hpp"
+
+#include "vkapp2/constants.hpp"
+
+#include <experimental/simd>
+#include <numbers>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include <util/perfcollector.hpp>
+
+
+
+namespace {
+
+	namespace stdx = std::experimental;
+
+	using simd_t = stdx::native_simd<float>;
+
+	constexpr float DEG_TO_RAD = std::numbers::pi_v<float> / 180.0f;
+
+
+	/** Computes the first three rows of `T * Rpitch * Ryaw * Rroll * S`,
+	 * in column major order; `T` may either be `float` or `simd_t`. */
+	template<typename T>
+	void compose_3x4(
+			const T& posX, const T& posY, const T& posZ,
+			const T& yaw, const T& pitch, const T& roll,
+			const T& sclX, const T& sclY, const T& sclZ,
+			T (&dst)[12]
+	) {
+		using std::sin;
+		using std::cos;
+		T sa = sin(pitch * DEG_TO_RAD);  T ca = cos(pitch * DEG_TO_RAD);
+		T sb = sin(yaw * DEG_TO_RAD);    T cb = cos(yaw * DEG_TO_RAD);
+		T sc = sin(roll * DEG_TO_RAD);   T cc = cos(roll * DEG_TO_RAD);
+		T sasb = sa * sb;
+		T casb = ca * sb;
+		dst[ 0] = sclX * (cb * cc);
+		dst[ 1] = sclX * ((ca * sc) + (sasb * cc));
+		dst[ 2] = sclX * ((sa * sc) - (casb * cc));
+		dst[ 3] = sclY * -(cb * sc);
+		dst[ 4] = sclY * ((ca * cc) - (sasb * sc));
+		dst[ 5] = sclY * ((sa * cc) + (casb * sc));
+		dst[ 6] = sclZ * sb;
+		dst[ 7] = sclZ * -(sa * cb);
+		dst[ 8] = sclZ * (ca * cb);
+		dst[ 9] = posX;
+		dst[10] = posY;
+		dst[11] = posZ;
+	}
+
+
+	void write_3x4(glm::mat4& dst, const float (&src)[12]) {
+		dst[0] = glm::vec4(src[0], src[ 1], src[ 2], 0.0f);
+		dst[1] = glm::vec4(src[3], src[ 4], src[ 5], 0.0f);
+		dst[2] = glm::vec4(src[6], src[ 7], src[ 8], 0.0f);
+		dst[3] = glm::vec4(src[9], src[10], src[11], 1.0f);
+	}
+
+
+	void compose_range(
+			const float* const (&src)[9],
+			size_t beg, size_t end, vka2::Instance* dst
+	) {
+		constexpr size_t width = simd_t::size();
+		size_t i = beg;
+		for(; i + width <= end; i += width) {
+			simd_t in[9];
+			simd_t out[12];
+			alignas(stdx::memory_alignment_v<simd_t>) float lanes[12][width];
+			for(size_t c=0; c < 9; ++c) {
+				in[c].copy_from(src[c] + i, stdx::element_aligned); }
+			compose_3x4(
+				in[0], in[1], in[2],
+				in[3], in[4], in[5],
+				in[6], in[7], in[8],
+				out );
+			for(size_t c=0; c < 12; ++c) {
+				out[c].copy_to(lanes[c], stdx::vector_aligned); }
+			for(size_t l=0; l < width; ++l) {
+				float mat[12];
+				for(size_t c=0; c < 12; ++c) mat[c] = lanes[c][l];
+				write_3x4(dst[i + l].modelTransf, mat);
+			}
+		}
+		for(; i < end; ++i) {
+			float mat[12];
+			compose_3x4(
+				src[0][i], src[1][i], src[2][i],
+				src[3][i], src[4][i], src[5][i],
+				src[6][i], src[7][i], src[8][i],
+				mat );
+			write_3x4(dst[i].modelTransf, mat);
+		}
+	}
+
+}
+
+
+
+namespace vka2 {
+
+	/** Threads that compose the batches of `composeMatrices` other than
+	 * the first one, which the calling thread composes; between calls,
+	 * they wait for the next one. */
+	class TransformStore::Workers {
+	public:
+		struct Job {
+			const TransformStore* store;
+			size_t beg, end, batch;
+			Instance* dst;
+			unsigned workers; // How many workers have a batch, in order
+		};
+
+		Workers(unsigned count) {
+			threads_.reserve(count);
+			for(unsigned i=0; i < count; ++i) {
+				threads_.emplace_back([this, i](std::stop_token stop) { run_(stop, i); }); }
+		}
+
+		unsigned size() const noexcept { return threads_.size(); }
+
+		void compose(const Job& job) {
+			assert(job.workers <= size());
+			{
+				auto lock = std::unique_lock(mutex_);
+				job_ = job;
+				pending_ = job.workers;
+				++ generation_;
+			}
+			wake_.notify_all();
+			job.store->composeMatricesSt(job.beg, std::min(job.beg + job.batch, job.end), job.dst);
+			auto lock = std::unique_lock(mutex_);
+			done_.wait(lock, [this]() { return pending_ == 0; });
+		}
+
+	private:
+		void run_(std::stop_token stop, unsigned index) {
+			uint64_t seenGeneration = 0;
+			auto lock = std::unique_lock(mutex_);
+			while(wake_.wait(lock, stop, [&]() { return generation_ != seenGeneration; })) {
+				seenGeneration = generation_;
+				if(index >= job_.workers)  continue;
+				Job job = job_;
+				lock.unlock();
+				{
+					PERF_SCOPE("transforms.composeBatch")
+					size_t b = job.beg + ((index + 1) * job.batch);
+					job.store->composeMatricesSt(b, std::min(b + job.batch, job.end), job.dst);
+				}
+				lock.lock();
+				if(-- pending_ == 0)  done_.notify_one();
+			}
+		}
+
+		std::mutex mutex_;
+		std::condition_variable_any wake_;
+		std::condition_variable done_;
+		Job job_ = { };
+		uint64_t generation_ = 0;
+		unsigned pending_ = 0;
+		std::vector<std::jthread> threads_; // Last, so that they're stopped before anything else is destroyed
+	};
+
+
+	TransformStore::TransformStore() = default;
+	TransformStore::TransformStore(TransformStore&&) = default;
+	TransformStore::~TransformStore() = default;
+	TransformStore& TransformStore::operator=(TransformStore&&) = default;
+
+
+	void TransformStore::reserve(size_t n) {
+		for(auto* array : {
+				&posX_, &posY_, &posZ_,
+				&rotX_, &rotY_, &rotZ_,
+				&sclX_, &sclY_, &sclZ_ }) {
+			array->reserve(n); }
+	}
+
+
+	void TransformStore::resize(size_t n) {
+		for(auto* array : { &posX_, &posY_, &posZ_, &rotX_, &rotY_, &rotZ_ }) {
+			array->resize(n, 0.0f); }
+		for(auto* array : { &sclX_, &sclY_, &sclZ_ }) {
+			array->resize(n, 1.0f); }
+	}
+
+
+	void TransformStore::push_back(
+			const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale
+	) {
+		posX_.push_back(position.x);     posY_.push_back(position.y);     posZ_.push_back(position.z);
+		rotX_.push_back(orientation.x);  rotY_.push_back(orientation.y);  rotZ_.push_back(orientation.z);
+		sclX_.push_back(scale.x);        sclY_.push_back(scale.y);        sclZ_.push_back(scale.z);
+	}
+
+
+	glm::vec3 TransformStore::position(size_t i) const {
+		assert(i < size());
+		return glm::vec3(posX_[i], posY_[i], posZ_[i]);
+	}
+
+	glm::vec3 TransformStore::orientation(size_t i) const {
+		assert(i < size());
+		return glm::vec3(rotX_[i], rotY_[i], rotZ_[i]);
+	}
+
+	glm::vec3 TransformStore::scale(size_t i) const {
+		assert(i < size());
+		return glm::vec3(sclX_[i], sclY_[i], sclZ_[i]);
+	}
+
+
+	void TransformStore::setPosition(size_t i, const glm::vec3& v) {
+		assert(i < size());
+		posX_[i] = v.x;  posY_[i] = v.y;  posZ_[i] = v.z;
+	}
+
+	void TransformStore::setOrientation(size_t i, const glm::vec3& v) {
+		assert(i < size());
+		rotX_[i] = v.x;  rotY_[i] = v.y;  rotZ_[i] = v.z;
+	}
+
+	void TransformStore::setScale(size_t i, const glm::vec3& v) {
+		assert(i < size());
+		sclX_[i] = v.x;  sclY_[i] = v.y;  sclZ_[i] = v.z;
+	}
+
+
+	void TransformStore::composeMatricesSt(size_t beg, size_t end, Instance* dst) const {
+		assert(beg <= end);
+		assert(end <= size());
+		const float* const src[9] = {
+			posX_.data(), posY_.data(), posZ_.data(),
+			rotX_.data(), rotY_.data(), rotZ_.data(),
+			sclX_.data(), sclY_.data(), sclZ_.data() };
+		compose_range(src, beg, end, dst);
+	}
+
+
+	void TransformStore::composeMatrices(size_t beg, size_t end, Instance* dst) const {
+		assert(beg <= end);
+		assert(end <= size());
+		size_t count = end - beg;
+		size_t threadCount = std::min<size_t>(
+			std::thread::hardware_concurrency(),
+			count / TRANSFORM_PARALLEL_BATCH );
+		if(threadCount < 2) {
+			composeMatricesSt(beg, end, dst);
+		} else {
+			// Batches are aligned to the SIMD width, so that only the last one has a scalar tail
+			constexpr size_t width = simd_t::size();
+			size_t batch = (count + threadCount - 1) / threadCount;
+			batch = ((batch + width - 1) / width) * width;
+			if(! workers_) {
+				workers_ = std::make_unique<Workers>(std::thread::hardware_concurrency() - 1); }
+			unsigned batchCount = (count + batch - 1) / batch;
+			workers_->compose(Workers::Job {
+				.store = this,
+				.beg = beg, .end = end, .batch = batch,
+				.dst = dst,
+				.workers = batchCount - 1 });
+		}
+	}
+
+
+	std::vector<InstanceRange> coalesceRanges(std::vector<size_t>& indices, size_t maxGap) {
+		std::vector<InstanceRange> r;
+		std::sort(indices.begin(), indices.end());
+		for(size_t idx : indices) {
+			if(r.empty() || (idx > r.back().second + maxGap)) {
+				r.push_back(InstanceRange(idx, idx + 1));
+			} else {
+				r.back().second = std::max<uint64_t>(r.back().second, idx + 1);
+			}
+		}
+		return r;
+	}
+
+
+	void TransformStore::sqrDistances(const glm::vec3& from, float* dst) const {
+		constexpr size_t width = simd_t::size();
+		const size_t count = size();
+		size_t i = 0;
+		for(; i + width <= count; i += width) {
+			simd_t x, y, z;
+			x.copy_from(posX_.data() + i, stdx::element_aligned);
+			y.copy_from(posY_.data() + i, stdx::element_aligned);
+			z.copy_from(posZ_.data() + i, stdx::element_aligned);
+			x -= from.x;  y -= from.y;  z -= from.z;
+			simd_t d = (x * x) + (y * y) + (z * z);
+			d.copy_to(dst + i, stdx::element_aligned);
+		}
+		for(; i < count; ++i) {
+			float x = posX_[i] - from.x;
+			float y = posY_[i] - from.y;
+			float z = posZ_[i] - from.z;
+			dst[i] = (x * x) + (y * y) + (z * z);
+		}
+	}
+
+}
@@ -0,0 +1,122 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+#pragma once
+
+#include "vkapp2/pod.hpp"
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+
+
+namespace vka2 {
+
+	/** Stores object transformations as a structure of arrays: each
+	 * component of positions, Euler angles (in degrees) and scales has its
+	 * own array, so that model matrices can be composed several at a time
+	 * with SIMD instructions.
+	 *
+	 * The X and Y Euler angles are respectively the yaw and pitch, the
+	 * resulting matrix is `T * Rpitch * Ryaw * Rroll * S`. */
+	class TransformStore {
+	private:
+		class Workers;
+
+		std::vector<float> posX_, posY_, posZ_;
+		std::vector<float> rotX_, rotY_, rotZ_;
+		std::vector<float> sclX_, sclY_, sclZ_;
+		mutable std::unique_ptr<Workers> workers_; // Started by the first parallel `composeMatrices` call
+
+	public:
+		TransformStore();
+		TransformStore(TransformStore&&);
+		~TransformStore();
+		TransformStore& operator=(TransformStore&&);
+
+		size_t size() const { return posX_.size(); }
+		void reserve(size_t);
+		void resize(size_t);
+		void push_back(const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale);
+
+		glm::vec3 position(size_t) const;
+		glm::vec3 orientation(size_t) const;
+		glm::vec3 scale(size_t) const;
+		void setPosition(size_t, const glm::vec3&);
+		void setOrientation(size_t, const glm::vec3&);
+		void setScale(size_t, const glm::vec3&);
+
+		/** Composes the model matrices of the transformations in the range
+		 * `[beg, end)`, and writes them into `dst[beg]` to `dst[end-1]`;
+		 * other members of the instances are not modified.
+		 *
+		 * Large ranges are split among worker threads, see
+		 * `TRANSFORM_PARALLEL_BATCH`; the workers are kept alive with
+		 * the store, and only one call may use them at a time. */
+		void composeMatrices(size_t beg, size_t end, Instance* dst) const;
+
+		/** Same as `composeMatrices`, but never uses more than one thread. */
+		void composeMatricesSt(size_t beg, size_t end, Instance* dst) const;
+
+		/** Writes the squared distance between `from` and every
+		 * position into `dst[0]` to `dst[size()-1]`. */
+		void sqrDistances(const glm::vec3& from, float* dst) const;
+	};
+
+
+	/** A range of elements, in the form `[first, last)`. */
+	using InstanceRange = std::pair<uint64_t, uint64_t>;
+
+
+	/** Sorts the given indices, and merges them into ranges: two indices
+	 * end up in the same range when they are separated by at most `maxGap`
+	 * other indices. */
+	std::vector<InstanceRange> coalesceRanges(std::vector<size_t>& indices, size_t maxGap);
+
+
+	/** Reassembles the instances at the given (dirty) indices, which are
+	 * cleared, and returns the ranges of instances that have been modified.
+	 *
+	 * Close indices are assembled together in contiguous ranges, see
+	 * `coalesceRanges`: model matrices are composed for whole ranges,
+	 * then `fill(index, instance)` sets the other members of each instance. */
+	template<typename FillFn>
+	std::vector<InstanceRange> assembleInstances(
+			const TransformStore& transforms,
+			std::vector<size_t>& dirty, size_t maxGap,
+			Instance* dst, FillFn&& fill
+	) {
+		std::vector<InstanceRange> r = coalesceRanges(dirty, maxGap);
+		dirty.clear();
+		for(const auto& range : r) {
+			transforms.composeMatrices(range.first, range.second, dst);
+			for(size_t i = range.first; i < range.second; ++i) {
+				fill(i, dst[i]); }
+		}
+		return r;
+	}
+
+}
@@ -0,0 +1,192 @@
+/* MIT License
+ *
+ * Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+
+
+#include "vkapp2/graphics.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace vka2;
+
+
+
+namespace {
+
+	vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+		if(alignment <= 1)  return value;
+		return ((value + alignment - 1) / alignment) * alignment;
+	}
+
+}
+
+
+
+namespace vka2 {
+
+	void UboRing::_alloc(size_t slotCount) {
+		vk::BufferCreateInfo bcInfo;
+		bcInfo.size = _slot_stride * slotCount;
+		bcInfo.sharingMode = vk::SharingMode::eExclusive;
+		bcInfo.usage =
+			vk::BufferUsageFlagBits::eUniformBuffer |
+			vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+		if(_host_visible) {
+			_buffer = _app->createBuffer(bcInfo,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				vk::MemoryPropertyFlagBits::eDeviceLocal);
+			_mmapd = _app->mapBuffer<void>(_buffer.alloc);
+		} else {
+			_buffer = _app->createBuffer(bcInfo,
+				vk::MemoryPropertyFlagBits::eDeviceLocal);
+			_mmapd = nullptr;
+		}
+		for(size_t i = slotCount; i > _slot_count; --i) {
+			_free_slots.push_back(i - 1); }
+		_slot_count = slotCount;
+		++_generation;
+		util::alloc_tracker.alloc("UboRing:_buffer");
+	}
+
+
+	void UboRing::_dealloc() {
+		if(_mmapd != nullptr) {
+			_app->unmapBuffer(_buffer.alloc);
+			_mmapd = nullptr;
+		}
+		_app->destroyBuffer(_buffer);
+		util::alloc_tracker.dealloc("UboRing:_buffer");
+	}
+
+
+	UboRing::UboRing():
+			_app(nullptr)
+	{ }
+
+
+	UboRing::UboRing(
+			Application& app,
+			vk::DeviceSize slotSize, size_t slotCount,
+			bool hostVisible
+	):
+			_app(&app),
+			_mmapd(nullptr),
+			_slot_size(slotSize),
+			_slot_count(0),
+			_generation(0),
+			_host_visible(hostVisible)
+	{
+		assert(slotCount > 0);
+		_slot_stride = align_up(slotSize,
+			app.physDevice().getProperties().limits.minUniformBufferOffsetAlignment);
+		_free_slots.reserve(slotCount);
+		_alloc(slotCount);
+	}
+
+
+	UboRing::UboRing(UboRing&& mov):
+			#define _MOV(_F) _F(std::move(mov._F))
+			_MOV(_app),
+			_MOV(_buffer), _MOV(_mmapd),
+			_MOV(_slot_size), _MOV(_slot_stride), _MOV(_slot_count),
+			_MOV(_free_slots),
+			_MOV(_generation),
+			_MOV(_host_visible)
+			#undef _MOV
+	{
+		mov._app = nullptr;
+	}
+
+
+	UboRing::~UboRing() {
+		destroy();
+	}
+
+
+	UboRing& UboRing::operator=(UboRing&& mov) {
+		this->~UboRing();
+		return *(new (this) UboRing(std::move(mov)));
+	}
+
+
+	void UboRing::destroy() {
+		if(_app != nullptr) {
+			_dealloc();
+			_free_slots.clear();
+			_app = nullptr;
+		}
+	}
+
+
+	size_t UboRing::acquireSlot() {
+		assert(_app != nullptr);
+		if(_free_slots.empty()) {
+			// Grow the ring, carrying over the contents of the slots in use
+			BufferAlloc oldBuffer = _buffer;
+			void* oldMmapd = _mmapd;
+			vk::DeviceSize oldSize = _slot_stride * _slot_count;
+			util::logVkDebug()
+				<< "Growing a UBO ring from " << _slot_count << " to "
+				<< (_slot_count * 2) << " slots" << util::endl;
+			_alloc(_slot_count * 2);
+			if(_mmapd != nullptr) {
+				memcpy(_mmapd, oldMmapd, oldSize);
+			} else {
+				vk::Buffer src = oldBuffer.handle;
+				vk::Buffer dst = _buffer.handle;
+				_app->transferCommandPool().runCmds(_app->queues().transfer,
+					[src, dst, oldSize](vk::CommandBuffer cmd) {
+						cmd.copyBuffer(src, dst, vk::BufferCopy(0, 0, oldSize)); });
+			}
+			_app->device().waitIdle(); // The old buffer may still be bound to pending commands
+			if(oldMmapd != nullptr) {
+				_app->unmapBuffer(oldBuffer.alloc); }
+			_app->destroyBuffer(oldBuffer);
+			util::alloc_tracker.dealloc("UboRing:_buffer");
+		}
+		size_t r = _free_slots.back();
+		_free_slots.pop_back();
+		return r;
+	}
+
+
+	void UboRing::releaseSlot(size_t slot) {
+		assert(slot < _slot_count);
+		assert(std::find(_free_slots.begin(), _free_slots.end(), slot) == _free_slots.end());
+		if(_app != nullptr) {
+			_free_slots.push_back(slot); }
+	}
+
+
+	void* UboRing::slotPtr(size_t slot) {
+		assert(slot < _slot_count);
+		assert(_mmapd != nullptr && "Only host visible UBO rings can be accessed directly");
+		return reinterpret_cast<char*>(_mmapd) + slotOffset(slot);
+	}
+
+
+	vk::DescriptorBufferInfo UboRing::descriptorInfo() const {
+		return vk::DescriptorBufferInfo(_buffer.handle, 0, _slot_size);
+	}
+
+}
@@ -1,4 +1,5 @@
 #include "cmdpool.cpp"
+#include "drawstream.cpp"
 #include "dyndescriptorpool.cpp"
 #include "mem.cpp"
 #include "mesh_instance.cpp"
@@ -6,4 +7,6 @@
 #include "renderpass.cpp"
 #include "swapchain.cpp"
 #include "texture.cpp"
+#include "transforms.cpp"
+#include "uboring.cpp"
 #include "vk_utils.cpp"